@@ -0,0 +1,130 @@
+#include "allocator.h"
+
+#include <algorithm>
+#include <mutex>
+
+using namespace std;
+
+namespace Runtime {
+
+namespace {
+
+constexpr size_t kGranularity = 16;
+constexpr size_t kClassCount = kMaxSlabBlock / kGranularity;
+// Blocks a thread takes from its slab at once
+constexpr size_t kBatchSize = 32;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+size_t SizeClass(size_t size) {
+  return (max<size_t>(size, 1) - 1) / kGranularity;
+}
+
+// Free blocks of exited threads
+struct SharedPool {
+  mutex lock;
+  FreeBlock* free[kClassCount] = {};
+  size_t slabs = 0;
+};
+
+// Never destroyed, threads may exit during static destruction
+SharedPool& Shared() {
+  static SharedPool& pool = *new SharedPool;
+  return pool;
+}
+
+// Trivially destructible, so that objects destroyed by the thread's
+// destructors can still be freed; after the flush they go to the shared pool
+struct ThreadCache {
+  FreeBlock* free[kClassCount];
+  char* slab_position;
+  char* slab_end;
+  bool flushed;
+};
+
+thread_local ThreadCache cache{};
+
+struct ThreadCacheFlusher {
+  ~ThreadCacheFlusher() {
+    SharedPool& shared = Shared();
+    lock_guard guard(shared.lock);
+    for (size_t i = 0; i < kClassCount; ++i) {
+      while (FreeBlock* block = cache.free[i]) {
+        cache.free[i] = block->next;
+        block->next = shared.free[i];
+        shared.free[i] = block;
+      }
+    }
+    cache.flushed = true;
+  }
+};
+
+void Refill(size_t size_class) {
+  if (!cache.flushed) {
+    static thread_local ThreadCacheFlusher flusher;
+  }
+
+  SharedPool& shared = Shared();
+  const size_t block_size = (size_class + 1) * kGranularity;
+  {
+    lock_guard guard(shared.lock);
+    if (FreeBlock* blocks = shared.free[size_class]) {
+      // A flushed cache is not flushed again, so it only takes one block
+      shared.free[size_class] = cache.flushed ? blocks->next : nullptr;
+      if (cache.flushed) {
+        blocks->next = nullptr;
+      }
+      cache.free[size_class] = blocks;
+      return;
+    }
+    if (static_cast<size_t>(cache.slab_end - cache.slab_position) < block_size) {
+      cache.slab_position = static_cast<char*>(::operator new(kSlabSize));
+      cache.slab_end = cache.slab_position + kSlabSize;
+      ++shared.slabs;
+    }
+  }
+
+  const size_t count = min<size_t>(cache.flushed ? 1 : kBatchSize, (cache.slab_end - cache.slab_position) / block_size);
+  for (size_t i = 0; i < count; ++i) {
+    auto block = reinterpret_cast<FreeBlock*>(cache.slab_position);
+    block->next = cache.free[size_class];
+    cache.free[size_class] = block;
+    cache.slab_position += block_size;
+  }
+}
+
+} /* namespace */
+
+void* SlabAllocate(size_t size) {
+  const size_t size_class = SizeClass(size);
+  if (!cache.free[size_class]) {
+    Refill(size_class);
+  }
+  FreeBlock* block = cache.free[size_class];
+  cache.free[size_class] = block->next;
+  return block;
+}
+
+void SlabDeallocate(void* block, size_t size) noexcept {
+  const size_t size_class = SizeClass(size);
+  auto free_block = static_cast<FreeBlock*>(block);
+  if (cache.flushed) {
+    SharedPool& shared = Shared();
+    lock_guard guard(shared.lock);
+    free_block->next = shared.free[size_class];
+    shared.free[size_class] = free_block;
+    return;
+  }
+  free_block->next = cache.free[size_class];
+  cache.free[size_class] = free_block;
+}
+
+size_t SlabCount() {
+  SharedPool& shared = Shared();
+  lock_guard guard(shared.lock);
+  return shared.slabs;
+}
+
+} /* namespace Runtime */
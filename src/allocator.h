@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+class TestRunner;
+
+namespace Runtime {
+
+// Size-class allocator for runtime objects and their control blocks. Blocks
+// of up to kMaxSlabBlock bytes are carved from 64 KB slabs and recycled
+// through free lists of the calling thread, so allocating and freeing an
+// object takes no lock and no malloc call. A thread returns its free blocks
+// to a shared pool when it exits; the slabs are kept for the process.
+constexpr size_t kMaxSlabBlock = 256;
+constexpr size_t kSlabSize = 64 << 10;
+
+void* SlabAllocate(size_t size);
+void SlabDeallocate(void* block, size_t size) noexcept;
+
+// Slabs taken from the system so far
+size_t SlabCount();
+
+template <typename T>
+class SlabAllocator {
+public:
+  using value_type = T;
+
+  SlabAllocator() = default;
+
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U>&) {
+  }
+
+  T* allocate(size_t n) {
+    if (n > kMaxSlabBlock / sizeof(T)) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(SlabAllocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* block, size_t n) noexcept {
+    if (n > kMaxSlabBlock / sizeof(T)) {
+      ::operator delete(block);
+    } else {
+      SlabDeallocate(block, n * sizeof(T));
+    }
+  }
+
+  template <typename U>
+  bool operator==(const SlabAllocator<U>&) const {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const SlabAllocator<U>&) const {
+    return false;
+  }
+};
+
+void RunAllocatorTests(TestRunner& tr);
+
+} /* namespace Runtime */
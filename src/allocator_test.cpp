@@ -0,0 +1,104 @@
+#include "allocator.h"
+#include "object.h"
+#include "object_holder.h"
+#include "statement.h"
+#include "test_runner.h"
+
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Runtime {
+
+void TestSlabBlocksAreReused() {
+  void* first = SlabAllocate(40);
+  SlabDeallocate(first, 40);
+  // Same size class
+  void* second = SlabAllocate(48);
+  ASSERT_EQUAL(first, second);
+
+  void* other = SlabAllocate(200);
+  ASSERT(other != second);
+  SlabDeallocate(second, 48);
+  SlabDeallocate(other, 200);
+}
+
+void TestSlabAllocatorInContainers() {
+  vector<int, SlabAllocator<int>> small;
+  for (int i = 0; i < 1000; ++i) {
+    small.push_back(i);
+  }
+  ASSERT_EQUAL(small.size(), 1000u);
+  ASSERT_EQUAL(small[999], 999);
+
+  Closure closure;
+  for (int i = 0; i < 100; ++i) {
+    closure["field" + to_string(i)] = ObjectHolder::Own(Number(i));
+  }
+  ASSERT_EQUAL(closure.size(), 100u);
+}
+
+void TestObjectChurnReusesSlabs() {
+  Class cls("Point", {}, nullptr);
+  for (int i = 0; i < 1000; ++i) {
+    ObjectHolder instance = ObjectHolder::Make<ClassInstance>(cls);
+    instance.TryAs<ClassInstance>()->Fields()["x"] = ObjectHolder::Own(Number(i));
+  }
+
+  const size_t slabs = SlabCount();
+  for (int i = 0; i < 100000; ++i) {
+    ObjectHolder instance = ObjectHolder::Make<ClassInstance>(cls);
+    Closure& fields = instance.TryAs<ClassInstance>()->Fields();
+    fields["x"] = ObjectHolder::Own(Number(i));
+    fields["y"] = ObjectHolder::Own(String("label"));
+  }
+  ASSERT_EQUAL(SlabCount(), slabs);
+}
+
+void TestBlocksFreedByOtherThreads() {
+  vector<ObjectHolder> objects;
+  thread producer([&objects] {
+    for (int i = 0; i < 1000; ++i) {
+      objects.push_back(ObjectHolder::Own(Number(i)));
+    }
+  });
+  producer.join();
+
+  int sum = 0;
+  for (auto& object : objects) {
+    sum += object.TryAs<Number>()->GetValue();
+  }
+  objects.clear();
+  ASSERT_EQUAL(sum, 999 * 1000 / 2);
+}
+
+void TestBlocksOfExitedThreadsAreReused() {
+  thread first([] {
+    vector<ObjectHolder> numbers;
+    for (int i = 0; i < 500; ++i) {
+      numbers.push_back(ObjectHolder::Own(Number(i)));
+    }
+  });
+  first.join();
+
+  const size_t slabs = SlabCount();
+  thread second([] {
+    vector<ObjectHolder> numbers;
+    for (int i = 0; i < 500; ++i) {
+      numbers.push_back(ObjectHolder::Own(Number(i)));
+    }
+  });
+  second.join();
+  ASSERT_EQUAL(SlabCount(), slabs);
+}
+
+void RunAllocatorTests(TestRunner& tr) {
+  RUN_TEST(tr, Runtime::TestSlabBlocksAreReused);
+  RUN_TEST(tr, Runtime::TestSlabAllocatorInContainers);
+  RUN_TEST(tr, Runtime::TestObjectChurnReusesSlabs);
+  RUN_TEST(tr, Runtime::TestBlocksFreedByOtherThreads);
+  RUN_TEST(tr, Runtime::TestBlocksOfExitedThreadsAreReused);
+}
+
+} /* namespace Runtime */
@@ -0,0 +1,795 @@
+#include "aot.h"
+#include "object.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace Aot {
+
+namespace {
+
+const char* const kPrelude = R"prelude(// Generated by mythonc, do not edit
+#include "object.h"
+#include "object_holder.h"
+#include "comparators.h"
+#include "statement.h"
+
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Runtime;
+
+namespace {
+
+ObjectHolder Box(int value) {
+  return ObjectHolder::Own(Number(value));
+}
+
+ObjectHolder BoxBool(bool value) {
+  return ObjectHolder::Own(Bool(value));
+}
+
+int Divide(int left, int right) {
+  if (right == 0) {
+    throw std::runtime_error("Division by zero");
+  }
+  return left / right;
+}
+
+int Unbox(const ObjectHolder& object) {
+  if (auto number = object.TryAs<Number>()) {
+    return number->GetValue();
+  }
+  throw std::runtime_error("Not number");
+}
+
+ClassInstance& AsInstance(const ObjectHolder& object) {
+  if (auto instance = object.TryAs<ClassInstance>()) {
+    return *instance;
+  }
+  throw std::runtime_error("Not a class instance");
+}
+
+ObjectHolder Missing(const char* name) {
+  throw std::runtime_error(std::string("Not found: ") + name);
+}
+
+ObjectHolder Field(const ObjectHolder& object, const char* name) {
+  Closure& fields = AsInstance(object).Fields();
+  if (auto it = fields.find(name); it != fields.end()) {
+    return it->second;
+  }
+  return Missing(name);
+}
+
+ObjectHolder CallMethod(const ObjectHolder& object, const char* method, std::initializer_list<ObjectHolder> args) {
+  return AsInstance(object).Call(method, Arguments(args.begin(), args.size()));
+}
+
+void PrintObject(const ObjectHolder& object) {
+  if (object) {
+    object->Print(std::cout);
+  } else {
+    std::cout << "None";
+  }
+}
+
+ObjectHolder Stringify(const ObjectHolder& object) {
+  std::ostringstream out;
+  if (object) {
+    object->Print(out);
+  } else {
+    out << "None";
+  }
+  return ObjectHolder::Own(String(out.str()));
+}
+
+ObjectHolder AddObjects(const ObjectHolder& left, const ObjectHolder& right) {
+  if (!left || !right) {
+    throw std::runtime_error("Add None");
+  }
+  if (auto object = left.TryAs<ClassInstance>()) {
+    if (const Method* add = object->GetClass().GetSlots().add) {
+      return object->Call(*add, {right});
+    }
+    throw std::runtime_error("Not found __add__");
+  }
+  if (auto object = right.TryAs<ClassInstance>()) {
+    if (const Method* add = object->GetClass().GetSlots().add) {
+      return object->Call(*add, {left});
+    }
+    throw std::runtime_error("Not found __add__");
+  }
+  if (auto l = left.TryAs<Number>()) {
+    if (auto r = right.TryAs<Number>()) {
+      return Box(l->GetValue() + r->GetValue());
+    }
+    throw std::runtime_error("Not number");
+  }
+  if (auto l = left.TryAs<String>()) {
+    if (auto r = right.TryAs<String>()) {
+      return ObjectHolder::Own(String::Concat(*l, *r));
+    }
+    throw std::runtime_error("Not string");
+  }
+  throw std::runtime_error("Error add operation");
+}
+
+} // namespace
+)prelude";
+
+enum class Type {
+  Unknown,
+  Int,
+  Bool,
+  Object,
+};
+
+Type Join(Type lhs, Type rhs) {
+  if (lhs == Type::Unknown) {
+    return rhs;
+  } else if (rhs == Type::Unknown || lhs == rhs) {
+    return lhs;
+  }
+  return Type::Object;
+}
+
+const char* CppType(Type type) {
+  switch (type) {
+    case Type::Int: return "int";
+    case Type::Bool: return "bool";
+    default: return "ObjectHolder";
+  }
+}
+
+struct Value {
+  Type type;
+  string code;
+};
+
+string Quote(const string& value) {
+  ostringstream out;
+  out << '"';
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20 || c >= 0x7f) {
+      out << '\\' << char('0' + (c >> 6)) << char('0' + ((c >> 3) & 7)) << char('0' + (c & 7));
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+struct ComparatorInfo {
+  const char* op;
+  const char* function;
+};
+
+ComparatorInfo ClassifyComparator(const Ast::Comparison& comparison) {
+  using Kind = Ast::Comparison::Kind;
+
+  switch (comparison.GetKind()) {
+    case Kind::Equal: return {"==", "Runtime::Equal"};
+    case Kind::NotEqual: return {"!=", "Runtime::NotEqual"};
+    case Kind::Less: return {"<", "Runtime::Less"};
+    case Kind::Greater: return {">", "Runtime::Greater"};
+    case Kind::LessOrEqual: return {"<=", "Runtime::LessOrEqual"};
+    case Kind::GreaterOrEqual: return {">=", "Runtime::GreaterOrEqual"};
+    case Kind::Custom: break;
+  }
+  throw logic_error("mythonc: comparison with a custom comparator can't be compiled");
+}
+
+class ProgramEmitter;
+
+// Emits the body of one method or of main(). Every operation with an effect
+// or which can throw (calls, field reads, allocations of instances, unboxing,
+// division) is materialized in a temporary in evaluation order, arithmetic
+// which can't fail is left inline.
+//
+// A local read where it may not be assigned yet has a flag set by its
+// assignments and checked by the read, which fails as in the interpreter.
+// Statements are emitted in execution order and there are no loops, so the
+// locals assigned on every path are known at each point.
+class FunctionEmitter {
+public:
+  FunctionEmitter(ProgramEmitter& program, bool in_method)
+    : program(program)
+    , in_method(in_method)
+  {
+  }
+
+  string EmitMethod(const Runtime::Method& method, const string& function_name);
+  string EmitMain(Ast::Statement& program_body, const string& prologue);
+
+private:
+  ProgramEmitter& program;
+  bool in_method;
+  ostringstream body;
+  int indent = 1;
+  int temp_count = 0;
+  map<string, Type> variables;
+  map<string, bool> is_parameter;
+  // Locals assigned on every path to the statement being emitted
+  set<string> assigned;
+  // Locals read where they may not be assigned, which need the flag
+  set<string> flagged;
+
+  ostream& Line() {
+    return body << string(indent * 2, ' ');
+  }
+
+  void InferTypes(Ast::Statement& statement);
+  Type TypeOf(Ast::Statement& expression) const;
+  void FindUnassignedReads(Ast::Statement& statement, set<string>& assigned_before);
+  void FindUnassignedReadsIn(Ast::Statement& expression, set<string>& assigned_before);
+  string DeclareLocals() const;
+
+  Value Temp(Type type, const string& code) {
+    string name = "t" + to_string(temp_count++);
+    Line() << CppType(type) << ' ' << name << " = " << code << ";\n";
+    return {type, name};
+  }
+
+  static string AsObject(const Value& value) {
+    switch (value.type) {
+      case Type::Int: return "Box(" + value.code + ")";
+      case Type::Bool: return "BoxBool(" + value.code + ")";
+      default: return value.code;
+    }
+  }
+
+  static string AsInt(const Value& value) {
+    return value.type == Type::Int ? value.code : "Unbox(" + AsObject(value) + ")";
+  }
+
+  // Unboxing throws, so it's hoisted where the interpreter would fail
+  Value ToInt(const Value& value) {
+    return value.type == Type::Int ? value : Temp(Type::Int, AsInt(value));
+  }
+
+  static string AsBool(const Value& value) {
+    switch (value.type) {
+      case Type::Int: return "(" + value.code + " != 0)";
+      case Type::Bool: return value.code;
+      default: return "IsTrue(" + value.code + ")";
+    }
+  }
+
+  void EmitStatement(Ast::Statement& statement);
+  void EmitPrint(Ast::Print& print);
+  Value EmitExpression(Ast::Statement& expression);
+  Value EmitVariable(const Ast::VariableValue& variable);
+  Value EmitNewInstance(Ast::NewInstance& new_instance);
+};
+
+class ProgramEmitter {
+public:
+  explicit ProgramEmitter(ostream& out) : out(out) {
+  }
+
+  void Emit(Ast::Statement& program) {
+    CollectClasses(program);
+
+    ostringstream functions;
+    ostringstream prologue;
+    for (size_t i = 0; i < classes.size(); ++i) {
+      const Runtime::Class& cls = *classes[i];
+
+      vector<const Runtime::Method*> methods;
+      for (const auto& [name, method] : cls.GetMethods()) {
+        methods.push_back(&method);
+      }
+      sort(begin(methods), end(methods), [](auto lhs, auto rhs) { return lhs->name < rhs->name; });
+
+      prologue << "  {\n";
+      prologue << "    std::vector<Method> methods;\n";
+      for (size_t j = 0; j < methods.size(); ++j) {
+        const string function_name = "method_" + to_string(i) + "_" + to_string(j);
+        functions << "// " << cls.GetName() << '.' << methods[j]->name << '\n';
+        functions << FunctionEmitter(*this, true).EmitMethod(*methods[j], function_name) << '\n';
+
+        prologue << "    methods.push_back({" << Quote(methods[j]->name) << ", {";
+        for (size_t k = 0; k < methods[j]->formal_params.size(); ++k) {
+          prologue << (k > 0 ? ", " : "") << Quote(methods[j]->formal_params[k]);
+        }
+        prologue << "}, nullptr});\n";
+        prologue << "    methods.back().native = " << function_name << ";\n";
+      }
+      prologue << "    " << ClassVariable(cls) << " = std::make_unique<Class>("
+               << Quote(cls.GetName()) << ", std::move(methods), "
+               << (cls.GetParent() ? ClassVariable(*cls.GetParent()) + ".get()" : "nullptr") << ");\n";
+      prologue << "  }\n";
+    }
+
+    string main_function = FunctionEmitter(*this, false).EmitMain(program, prologue.str());
+
+    out << kPrelude << '\n';
+    for (size_t i = 0; i < classes.size(); ++i) {
+      out << "std::unique_ptr<Class> class_" << i << "; // " << classes[i]->GetName() << '\n';
+    }
+    for (size_t i = 0; i < strings.size(); ++i) {
+      out << "String string_" << i << "(" << Quote(strings[i]) << ");\n";
+    }
+    out << '\n' << functions.str() << main_function;
+  }
+
+  string ClassVariable(const Runtime::Class& cls) const {
+    auto it = class_index.find(&cls);
+    if (it == class_index.end()) {
+      throw logic_error("mythonc: class " + cls.GetName() + " is not defined in the program");
+    }
+    return "class_" + to_string(it->second);
+  }
+
+  string StringConstant(const string& value) {
+    auto [it, inserted] = string_index.emplace(value, strings.size());
+    if (inserted) {
+      strings.push_back(value);
+    }
+    return "string_" + to_string(it->second);
+  }
+
+private:
+  ostream& out;
+  vector<const Runtime::Class*> classes;
+  unordered_map<const Runtime::Class*, size_t> class_index;
+  vector<string> strings;
+  unordered_map<string, size_t> string_index;
+
+  void CollectClasses(Ast::Statement& statement) {
+    if (auto compound = dynamic_cast<Ast::Compound*>(&statement)) {
+      for (const auto& stmt : compound->GetStatements()) {
+        CollectClasses(*stmt);
+      }
+    } else if (auto if_else = dynamic_cast<Ast::IfElse*>(&statement)) {
+      CollectClasses(*if_else->GetIfBody());
+      if (if_else->GetElseBody()) {
+        CollectClasses(*if_else->GetElseBody());
+      }
+    } else if (auto definition = dynamic_cast<Ast::ClassDefinition*>(&statement)) {
+      class_index[&definition->GetClass()] = classes.size();
+      classes.push_back(&definition->GetClass());
+    }
+  }
+};
+
+string FunctionEmitter::EmitMethod(const Runtime::Method& method, const string& function_name) {
+  variables["self"] = Type::Object;
+  is_parameter["self"] = true;
+  for (const auto& param : method.formal_params) {
+    variables[param] = Type::Object;
+    is_parameter[param] = true;
+  }
+  method.ParseBody();
+  InferTypes(*method.body);
+
+  for (const auto& [name, parameter] : is_parameter) {
+    assigned.insert(name);
+  }
+  set<string> assigned_before = assigned;
+  FindUnassignedReads(*method.body, assigned_before);
+
+  if (dynamic_cast<Ast::Compound*>(method.body.get()) || dynamic_cast<Ast::Return*>(method.body.get())) {
+    EmitStatement(*method.body);
+    Line() << "return ObjectHolder::None();\n";
+  } else {
+    // A body which is a single node returns the value of that node
+    Line() << "return " << AsObject(EmitExpression(*method.body)) << ";\n";
+  }
+
+  ostringstream parameters;
+  parameters << "  ObjectHolder l_self = ObjectHolder::Share(self);\n";
+  for (size_t i = 0; i < method.formal_params.size(); ++i) {
+    parameters << "  ObjectHolder l_" << method.formal_params[i] << " = args[" << i << "];\n";
+  }
+
+  return "ObjectHolder " + function_name
+    + "(ClassInstance& self, [[maybe_unused]] Arguments args) {\n"
+    + parameters.str() + DeclareLocals() + body.str() + "}\n";
+}
+
+string FunctionEmitter::EmitMain(Ast::Statement& program_body, const string& prologue) {
+  InferTypes(program_body);
+  set<string> assigned_before;
+  FindUnassignedReads(program_body, assigned_before);
+  EmitStatement(program_body);
+  Line() << "return 0;\n";
+
+  // Errors end the program with the message, as in mython
+  return "int Run() {\n" + prologue + DeclareLocals() + body.str() + "}\n\n"
+    "int main() {\n"
+    "  try {\n"
+    "    return Run();\n"
+    "  } catch (const std::exception& e) {\n"
+    "    std::cout.flush();\n"
+    "    std::cerr << e.what() << std::endl;\n"
+    "    return 1;\n"
+    "  }\n"
+    "}\n";
+}
+
+void FunctionEmitter::InferTypes(Ast::Statement& statement) {
+  vector<Ast::Assignment*> assignments;
+  vector<Ast::Statement*> pending = {&statement};
+  while (!pending.empty()) {
+    Ast::Statement* current = pending.back();
+    pending.pop_back();
+    if (auto compound = dynamic_cast<Ast::Compound*>(current)) {
+      for (const auto& stmt : compound->GetStatements()) {
+        pending.push_back(stmt.get());
+      }
+    } else if (auto if_else = dynamic_cast<Ast::IfElse*>(current)) {
+      pending.push_back(if_else->GetIfBody());
+      if (if_else->GetElseBody()) {
+        pending.push_back(if_else->GetElseBody());
+      }
+    } else if (auto assignment = dynamic_cast<Ast::Assignment*>(current)) {
+      if (is_parameter.count(assignment->var_name) == 0) {
+        variables.emplace(assignment->var_name, Type::Unknown);
+        assignments.push_back(assignment);
+      }
+    }
+  }
+
+  // Types only grow from Unknown to Int/Bool and then to Object, so this stops
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (auto assignment : assignments) {
+      Type& type = variables[assignment->var_name];
+      Type joined = Join(type, TypeOf(*assignment->right_value));
+      if (joined != type) {
+        type = joined;
+        changed = true;
+      }
+    }
+  }
+
+  for (auto& [name, type] : variables) {
+    if (type == Type::Unknown) {
+      type = Type::Object;
+    }
+  }
+}
+
+Type FunctionEmitter::TypeOf(Ast::Statement& expression) const {
+  if (dynamic_cast<Ast::NumericConst*>(&expression)
+      || dynamic_cast<Ast::Sub*>(&expression)
+      || dynamic_cast<Ast::Mult*>(&expression)
+      || dynamic_cast<Ast::Div*>(&expression)) {
+    return Type::Int;
+  } else if (dynamic_cast<Ast::BoolConst*>(&expression)
+      || dynamic_cast<Ast::Comparison*>(&expression)
+      || dynamic_cast<Ast::Not*>(&expression)
+      || dynamic_cast<Ast::And*>(&expression)
+      || dynamic_cast<Ast::Or*>(&expression)) {
+    return Type::Bool;
+  } else if (auto add = dynamic_cast<Ast::Add*>(&expression)) {
+    Type lhs = TypeOf(*add->GetLhs());
+    Type rhs = TypeOf(*add->GetRhs());
+    if (lhs == Type::Int && rhs == Type::Int) {
+      return Type::Int;
+    } else if ((lhs == Type::Int || lhs == Type::Unknown) && (rhs == Type::Int || rhs == Type::Unknown)) {
+      return Type::Unknown;
+    }
+    return Type::Object;
+  } else if (auto variable = dynamic_cast<Ast::VariableValue*>(&expression);
+             variable && variable->dotted_ids.size() == 1) {
+    auto it = variables.find(variable->dotted_ids.front());
+    return it != variables.end() ? it->second : Type::Object;
+  }
+  return Type::Object;
+}
+
+// Follows the paths of EmitStatement and EmitExpression without emitting
+void FunctionEmitter::FindUnassignedReads(Ast::Statement& statement, set<string>& assigned_before) {
+  if (auto compound = dynamic_cast<Ast::Compound*>(&statement)) {
+    for (const auto& stmt : compound->GetStatements()) {
+      FindUnassignedReads(*stmt, assigned_before);
+    }
+  } else if (auto if_else = dynamic_cast<Ast::IfElse*>(&statement)) {
+    FindUnassignedReadsIn(*if_else->GetCondition(), assigned_before);
+    set<string> after_if = assigned_before;
+    FindUnassignedReads(*if_else->GetIfBody(), after_if);
+    if (if_else->GetElseBody()) {
+      FindUnassignedReads(*if_else->GetElseBody(), assigned_before);
+    }
+    set<string> after_else = move(assigned_before);
+    assigned_before.clear();
+    set_intersection(
+      begin(after_if), end(after_if), begin(after_else), end(after_else),
+      inserter(assigned_before, end(assigned_before))
+    );
+  } else if (auto ret = dynamic_cast<Ast::Return*>(&statement)) {
+    if (in_method) {
+      FindUnassignedReadsIn(*ret->GetStatement(), assigned_before);
+    }
+  } else if (auto assignment = dynamic_cast<Ast::Assignment*>(&statement)) {
+    FindUnassignedReadsIn(*assignment->right_value, assigned_before);
+    assigned_before.insert(assignment->var_name);
+  } else if (auto field_assignment = dynamic_cast<Ast::FieldAssignment*>(&statement)) {
+    FindUnassignedReadsIn(field_assignment->object, assigned_before);
+    FindUnassignedReadsIn(*field_assignment->right_value, assigned_before);
+  } else if (auto print = dynamic_cast<Ast::Print*>(&statement)) {
+    for (const auto& arg : print->GetArgs()) {
+      FindUnassignedReadsIn(*arg, assigned_before);
+    }
+  } else if (!dynamic_cast<Ast::ClassDefinition*>(&statement)) {
+    FindUnassignedReadsIn(statement, assigned_before);
+  }
+}
+
+void FunctionEmitter::FindUnassignedReadsIn(Ast::Statement& expression, set<string>& assigned_before) {
+  if (auto variable = dynamic_cast<Ast::VariableValue*>(&expression)) {
+    const string& name = variable->dotted_ids.front();
+    if (variables.count(name) > 0 && assigned_before.insert(name).second) {
+      flagged.insert(name);
+    }
+  } else if (auto unary = dynamic_cast<Ast::UnaryOperation*>(&expression)) {
+    FindUnassignedReadsIn(*unary->GetArgument(), assigned_before);
+  } else if (auto binary = dynamic_cast<Ast::BinaryOperation*>(&expression)) {
+    FindUnassignedReadsIn(*binary->GetLhs(), assigned_before);
+    FindUnassignedReadsIn(*binary->GetRhs(), assigned_before);
+  } else if (auto comparison = dynamic_cast<Ast::Comparison*>(&expression)) {
+    FindUnassignedReadsIn(*comparison->GetLeft(), assigned_before);
+    FindUnassignedReadsIn(*comparison->GetRight(), assigned_before);
+  } else if (auto call = dynamic_cast<Ast::MethodCall*>(&expression)) {
+    for (const auto& arg : call->args) {
+      FindUnassignedReadsIn(*arg, assigned_before);
+    }
+    FindUnassignedReadsIn(*call->object, assigned_before);
+  } else if (auto new_instance = dynamic_cast<Ast::NewInstance*>(&expression)) {
+    // The arguments may not be evaluated
+    set<string> with_init = assigned_before;
+    for (const auto& arg : new_instance->args) {
+      FindUnassignedReadsIn(*arg, with_init);
+    }
+  }
+}
+
+string FunctionEmitter::DeclareLocals() const {
+  ostringstream out;
+  for (const auto& [name, type] : variables) {
+    if (is_parameter.count(name) > 0) {
+      continue;
+    }
+    out << "  " << CppType(type) << " l_" << name;
+    if (type == Type::Int) {
+      out << " = 0";
+    } else if (type == Type::Bool) {
+      out << " = false";
+    }
+    out << ";\n";
+    if (flagged.count(name) > 0) {
+      out << "  bool d_" << name << " = false;\n";
+    }
+  }
+  return out.str();
+}
+
+void FunctionEmitter::EmitStatement(Ast::Statement& statement) {
+  if (auto compound = dynamic_cast<Ast::Compound*>(&statement)) {
+    for (const auto& stmt : compound->GetStatements()) {
+      EmitStatement(*stmt);
+    }
+  } else if (auto if_else = dynamic_cast<Ast::IfElse*>(&statement)) {
+    Value condition = EmitExpression(*if_else->GetCondition());
+    const set<string> before = assigned;
+    Line() << "if (" << AsBool(condition) << ") {\n";
+    ++indent;
+    EmitStatement(*if_else->GetIfBody());
+    --indent;
+    set<string> after_if = move(assigned);
+    assigned = before;
+    if (if_else->GetElseBody()) {
+      Line() << "} else {\n";
+      ++indent;
+      EmitStatement(*if_else->GetElseBody());
+      --indent;
+    }
+    Line() << "}\n";
+
+    // Assigned after the statement if assigned on both paths
+    set<string> after_else = move(assigned);
+    assigned.clear();
+    set_intersection(
+      begin(after_if), end(after_if), begin(after_else), end(after_else), inserter(assigned, end(assigned))
+    );
+  } else if (auto ret = dynamic_cast<Ast::Return*>(&statement)) {
+    if (!in_method) {
+      // As in the interpreter, the value isn't evaluated
+      Line() << "throw std::runtime_error(\"Return outside of a method\");\n";
+      return;
+    }
+    Value value = EmitExpression(*ret->GetStatement());
+    Line() << "return " << AsObject(value) << ";\n";
+  } else if (auto assignment = dynamic_cast<Ast::Assignment*>(&statement)) {
+    Value value = EmitExpression(*assignment->right_value);
+    Line() << "l_" << assignment->var_name << " = ";
+    switch (variables.at(assignment->var_name)) {
+      case Type::Int: body << AsInt(value); break;
+      case Type::Bool: body << AsBool(value); break;
+      default: body << AsObject(value); break;
+    }
+    body << ";\n";
+    if (assigned.insert(assignment->var_name).second && flagged.count(assignment->var_name) > 0) {
+      Line() << "d_" << assignment->var_name << " = true;\n";
+    }
+  } else if (auto field_assignment = dynamic_cast<Ast::FieldAssignment*>(&statement)) {
+    Value object = EmitVariable(field_assignment->object);
+    Value value = EmitExpression(*field_assignment->right_value);
+    Line() << "AsInstance(" << AsObject(object) << ").Fields()[" << Quote(field_assignment->field_name)
+           << "] = " << AsObject(value) << ";\n";
+  } else if (auto print = dynamic_cast<Ast::Print*>(&statement)) {
+    EmitPrint(*print);
+  } else if (dynamic_cast<Ast::ClassDefinition*>(&statement)) {
+    // Classes are created at the start of main()
+  } else {
+    Value value = EmitExpression(statement);
+    Line() << "(void)" << value.code << ";\n";
+  }
+}
+
+void FunctionEmitter::EmitPrint(Ast::Print& print) {
+  bool first = true;
+  for (const auto& arg : print.GetArgs()) {
+    if (!first) {
+      Line() << "std::cout << ' ';\n";
+    }
+    first = false;
+
+    Value value = EmitExpression(*arg);
+    switch (value.type) {
+      case Type::Int:
+        Line() << "std::cout << " << value.code << ";\n";
+        break;
+      case Type::Bool:
+        Line() << "std::cout << (" << value.code << " ? \"True\" : \"False\");\n";
+        break;
+      default:
+        Line() << "PrintObject(" << value.code << ");\n";
+        break;
+    }
+  }
+  Line() << "std::cout << '\\n';\n";
+}
+
+Value FunctionEmitter::EmitVariable(const Ast::VariableValue& variable) {
+  const string& name = variable.dotted_ids.front();
+  Value value;
+  if (auto it = variables.find(name); it != variables.end()) {
+    if (assigned.insert(name).second) {
+      // Assigned after the check, which fails otherwise
+      Line() << "if (!d_" << name << ") {\n";
+      Line() << "  Missing(" << Quote(name) << ");\n";
+      Line() << "}\n";
+    }
+    value = {it->second, "l_" + name};
+  } else {
+    value = Temp(Type::Object, "Missing(" + Quote(name) + ")");
+  }
+  for (size_t i = 1; i < variable.dotted_ids.size(); ++i) {
+    value = Temp(Type::Object, "Field(" + AsObject(value) + ", " + Quote(variable.dotted_ids[i]) + ")");
+  }
+  return value;
+}
+
+Value FunctionEmitter::EmitNewInstance(Ast::NewInstance& new_instance) {
+  Value instance = Temp(
+    Type::Object, "ObjectHolder::Make<ClassInstance>(*" + program.ClassVariable(new_instance.class_) + ")"
+  );
+
+  // As in the interpreter, arguments are evaluated only if there is a matching __init__
+  Line() << "if (AsInstance(" << instance.code << ").HasMethod(\"__init__\", "
+         << new_instance.args.size() << ")) {\n";
+  ++indent;
+  // Reads of the arguments check locals which stay unchecked without them
+  const set<string> before = assigned;
+  vector<string> args;
+  for (const auto& arg : new_instance.args) {
+    args.push_back(AsObject(EmitExpression(*arg)));
+  }
+  Line() << "CallMethod(" << instance.code << ", \"__init__\", {";
+  for (size_t i = 0; i < args.size(); ++i) {
+    body << (i > 0 ? ", " : "") << args[i];
+  }
+  body << "});\n";
+  --indent;
+  Line() << "}\n";
+  assigned = before;
+
+  return instance;
+}
+
+Value FunctionEmitter::EmitExpression(Ast::Statement& expression) {
+  if (auto number = dynamic_cast<Ast::NumericConst*>(&expression)) {
+    return {Type::Int, "(" + to_string(number->value.GetValue()) + ")"};
+  } else if (auto str = dynamic_cast<Ast::StringConst*>(&expression)) {
+    return {Type::Object, "ObjectHolder::Share(" + program.StringConstant(string(str->value.GetValue())) + ")"};
+  } else if (auto boolean = dynamic_cast<Ast::BoolConst*>(&expression)) {
+    return {Type::Bool, boolean->value.GetValue() ? "true" : "false"};
+  } else if (dynamic_cast<Ast::None*>(&expression)) {
+    return {Type::Object, "ObjectHolder::None()"};
+  } else if (auto variable = dynamic_cast<Ast::VariableValue*>(&expression)) {
+    return EmitVariable(*variable);
+  } else if (auto add = dynamic_cast<Ast::Add*>(&expression)) {
+    Value lhs = EmitExpression(*add->GetLhs());
+    Value rhs = EmitExpression(*add->GetRhs());
+    if (lhs.type == Type::Int && rhs.type == Type::Int) {
+      return {Type::Int, "(" + lhs.code + " + " + rhs.code + ")"};
+    }
+    return Temp(Type::Object, "AddObjects(" + AsObject(lhs) + ", " + AsObject(rhs) + ")");
+  } else if (auto operation = dynamic_cast<Ast::BinaryOperation*>(&expression);
+             operation && (dynamic_cast<Ast::Sub*>(operation)
+                           || dynamic_cast<Ast::Mult*>(operation)
+                           || dynamic_cast<Ast::Div*>(operation))) {
+    Value lhs = ToInt(EmitExpression(*operation->GetLhs()));
+    Value rhs = ToInt(EmitExpression(*operation->GetRhs()));
+    if (dynamic_cast<Ast::Div*>(operation)) {
+      return Temp(Type::Int, "Divide(" + lhs.code + ", " + rhs.code + ")");
+    }
+    const char* op = dynamic_cast<Ast::Sub*>(operation) ? " - " : " * ";
+    return {Type::Int, "(" + lhs.code + op + rhs.code + ")"};
+  } else if (auto operation = dynamic_cast<Ast::BinaryOperation*>(&expression);
+             operation && (dynamic_cast<Ast::And*>(operation) || dynamic_cast<Ast::Or*>(operation))) {
+    // Both operands are always evaluated, as in the interpreter
+    const char* op = dynamic_cast<Ast::And*>(operation) ? " && " : " || ";
+    Value lhs = EmitExpression(*operation->GetLhs());
+    Value rhs = EmitExpression(*operation->GetRhs());
+    return {Type::Bool, "(" + AsBool(lhs) + op + AsBool(rhs) + ")"};
+  } else if (auto negation = dynamic_cast<Ast::Not*>(&expression)) {
+    return {Type::Bool, "!" + AsBool(EmitExpression(*negation->GetArgument()))};
+  } else if (auto comparison = dynamic_cast<Ast::Comparison*>(&expression)) {
+    ComparatorInfo info = ClassifyComparator(*comparison);
+    Value lhs = EmitExpression(*comparison->GetLeft());
+    Value rhs = EmitExpression(*comparison->GetRight());
+    if (lhs.type == Type::Int && rhs.type == Type::Int) {
+      return {Type::Bool, "(" + lhs.code + " " + info.op + " " + rhs.code + ")"};
+    }
+    return Temp(Type::Bool, string(info.function) + "(" + AsObject(lhs) + ", " + AsObject(rhs) + ")");
+  } else if (auto stringify = dynamic_cast<Ast::Stringify*>(&expression)) {
+    Value value = EmitExpression(*stringify->GetArgument());
+    return Temp(Type::Object, "Stringify(" + AsObject(value) + ")");
+  } else if (auto call = dynamic_cast<Ast::MethodCall*>(&expression)) {
+    vector<string> args;
+    for (const auto& arg : call->args) {
+      args.push_back(AsObject(EmitExpression(*arg)));
+    }
+    Value object = EmitExpression(*call->object);
+    string code = "CallMethod(" + AsObject(object) + ", " + Quote(call->method) + ", {";
+    for (size_t i = 0; i < args.size(); ++i) {
+      code += (i > 0 ? ", " : "") + args[i];
+    }
+    return Temp(Type::Object, code + "})");
+  } else if (auto new_instance = dynamic_cast<Ast::NewInstance*>(&expression)) {
+    return EmitNewInstance(*new_instance);
+  }
+
+  throw logic_error("mythonc: unsupported statement in expression position");
+}
+
+} /* namespace */
+
+void EmitProgram(Ast::Statement& program, ostream& out) {
+  ProgramEmitter(out).Emit(program);
+}
+
+} /* namespace Aot */
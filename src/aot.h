@@ -0,0 +1,29 @@
+#pragma once
+
+#include <iosfwd>
+
+namespace Ast {
+  class Statement;
+}
+
+class TestRunner;
+
+namespace Aot {
+
+// Translates a parsed program into a standalone C++ translation unit that
+// links against the runtime (object.h, object_holder.h, comparators.h and
+// statement.h, which Runtime::Method needs to be destroyed).
+// Every method becomes a C++ function installed as Runtime::Method::native,
+// variables become C++ locals, and variables and expressions whose type is
+// statically known to be a number or a boolean are kept unboxed.
+void EmitProgram(Ast::Statement& program, std::ostream& out);
+
+// The sources of the runtime the generated translation unit is built with
+inline constexpr const char* kRuntimeSources[] = {
+  "allocator.cpp", "object.cpp", "object_holder.cpp", "comparators.cpp", "statement.cpp",
+  "jit.cpp", "trace.cpp", "memo.cpp", "profile.cpp", "metrics.cpp",
+};
+
+void RunAotTests(TestRunner& tr);
+
+} /* namespace Aot */
@@ -0,0 +1,286 @@
+#include "aot.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace Aot {
+
+string EmitFromString(const string& program) {
+  istringstream input(program);
+  Parse::Lexer lexer(input);
+  auto tree = ParseProgram(lexer);
+
+  ostringstream output;
+  EmitProgram(*tree, output);
+  return output.str();
+}
+
+bool Contains(const string& text, const string& fragment) {
+  return text.find(fragment) != string::npos;
+}
+
+void TestMethodsBecomeFunctions() {
+  const string code = EmitFromString(R"(
+class Shape:
+  def area():
+    return 0
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+r = Rect(2, 3)
+print r.area()
+)");
+
+  ASSERT(Contains(code, "// Shape.area\nObjectHolder method_0_0(ClassInstance& self"));
+  ASSERT(Contains(code, "// Rect.__init__\nObjectHolder method_1_0("));
+  ASSERT(Contains(code, "// Rect.area\nObjectHolder method_1_1("));
+  ASSERT(Contains(code, "methods.back().native = method_1_1;"));
+  ASSERT(Contains(code, "class_1 = std::make_unique<Class>(\"Rect\", std::move(methods), class_0.get());"));
+  ASSERT(Contains(code, "int main() {"));
+}
+
+void TestStaticallyKnownTypesAreUnboxed() {
+  const string code = EmitFromString(R"(
+class Calc:
+  def run(n):
+    x = 2 * 3
+    y = x + 4
+    ok = y > x
+    z = n
+    return x + y
+
+x = 5
+y = x * 2
+s = 'text'
+print x + y, s
+)");
+
+  ASSERT(Contains(code, "int l_x = 0;"));
+  ASSERT(Contains(code, "int l_y = 0;"));
+  ASSERT(Contains(code, "bool l_ok = false;"));
+  ASSERT(Contains(code, "ObjectHolder l_z;"));
+  ASSERT(Contains(code, "ObjectHolder l_s;"));
+  ASSERT(Contains(code, "l_y = (l_x + (4));"));
+  ASSERT(Contains(code, "l_ok = (l_y > l_x);"));
+  ASSERT(Contains(code, "return Box((l_x + l_y));"));
+  ASSERT(Contains(code, "std::cout << (l_x + l_y);"));
+}
+
+void TestStringLiteralsAreEscaped() {
+  const string code = EmitFromString(R"(
+print "say \"hi\"", 'back\slash'
+)");
+
+  ASSERT(Contains(code, R"(String string_0("say \\\"hi\\\"");)"));
+  ASSERT(Contains(code, R"(String string_1("back\\slash");)"));
+}
+
+void TestThrowingOperationsAreHoisted() {
+  const string code = EmitFromString(R"(
+class A:
+  def f():
+    return 1
+
+a = A()
+x = 6 / a.f() + a.f()
+)");
+
+  // The division and the unboxing happen before the second call
+  const size_t unbox = code.find("int t2 = Unbox(t1);");
+  const size_t divide = code.find("int t3 = Divide((6), t2);");
+  const size_t call = code.find("ObjectHolder t4 = CallMethod(l_a, \"f\", {});");
+  ASSERT(unbox != string::npos && unbox < divide && divide < call);
+}
+
+void TestReturnOutsideMethod() {
+  const string code = EmitFromString("x = 1\nreturn x\nprint x\n");
+  ASSERT(Contains(code, "throw std::runtime_error(\"Return outside of a method\");"));
+  ASSERT(!Contains(code, "return 0;\n  std::cout"));
+}
+
+void TestUnassignedLocals() {
+  const string code = EmitFromString(R"(
+class A:
+  def f(c):
+    if c:
+      y = 1
+    else:
+      y = 2
+    z = y
+    if c:
+      w = 1
+    return w
+
+x = 1
+print x
+a = A()
+a.f(True)
+)");
+
+  // Assigned on every path
+  ASSERT(!Contains(code, "d_x"));
+  ASSERT(!Contains(code, "d_y"));
+  ASSERT(!Contains(code, "d_z"));
+  // Assigned on one path only
+  ASSERT(Contains(code, "bool d_w = false;"));
+  ASSERT(Contains(code, "d_w = true;"));
+  ASSERT(Contains(code, "if (!d_w) {\n    Missing(\"w\");"));
+}
+
+namespace {
+
+string ReadFile(const filesystem::path& path) {
+  ifstream input(path);
+  return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+// Builds the generated code with the runtime sources next to this file and
+// runs it. The compiler is $CXX or c++. No result if the sources are missing.
+struct CompiledRun {
+  string build_log;
+  int status;
+  string output;
+};
+
+optional<CompiledRun> CompileAndRun(const string& program) {
+  const filesystem::path sources = filesystem::absolute(__FILE__).parent_path();
+  if (!filesystem::exists(sources / "aot.h")) {
+    cerr << "no sources at " << sources << ", compiled code isn't checked" << endl;
+    return nullopt;
+  }
+
+  static int runs = 0;
+  const filesystem::path dir = filesystem::temp_directory_path()
+    / ("mython-aot-test-" + to_string(getpid()) + "-" + to_string(runs++));
+  filesystem::create_directories(dir);
+  {
+    ofstream code(dir / "program.cpp");
+    code << EmitFromString(program);
+  }
+
+  const char* compiler = getenv("CXX");
+  string command = string(compiler ? compiler : "c++") + " -std=c++17 -O0 -I" + sources.string()
+    + " -o " + (dir / "program").string() + " " + (dir / "program.cpp").string();
+  for (const char* source : kRuntimeSources) {
+    command += " " + (sources / source).string();
+  }
+  CompiledRun run;
+  const int built = system((command + " 2>" + (dir / "build.log").string()).c_str());
+  run.build_log = ReadFile(dir / "build.log");
+  run.status = built == 0
+    ? system(((dir / "program").string() + " >" + (dir / "output.txt").string() + " 2>&1").c_str())
+    : -1;
+  run.output = ReadFile(dir / "output.txt");
+  filesystem::remove_all(dir);
+  return run;
+}
+
+// The compiled program prints what mython prints and then the error which
+// ends it, which is only printed by mython itself
+void CheckFailsAsInterpreter(const string& program, const string& error) {
+  istringstream input(program);
+  ostringstream expected;
+  try {
+    RunMythonProgram(input, expected);
+    ASSERT(false);
+  } catch (const runtime_error& e) {
+    ASSERT_EQUAL(string(e.what()), error);
+  }
+
+  if (auto run = CompileAndRun(program)) {
+    ASSERT_EQUAL(run->build_log, "");
+    ASSERT(run->status != 0);
+    ASSERT_EQUAL(run->output, expected.str() + error + "\n");
+  }
+}
+
+}
+
+void TestGeneratedCodeMatchesInterpreter() {
+  CheckFailsAsInterpreter(R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+  def area():
+    return 0
+  def __str__():
+    return self.name + ' of area ' + str(self.area())
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'rect'
+    self.w = w
+    self.h = h
+  def area():
+    return self.w * self.h
+
+class Noisy:
+  def value():
+    print 'noisy'
+    return 1
+
+class Fact:
+  def of(n):
+    if n < 2:
+      return 1
+    return n * self.of(n - 1)
+
+r = Rect(3, 4)
+print r, r.area() > 10, r.area() == 12
+f = Fact()
+print f.of(10), 7 / 2, 'a' + 'b', not True or 1 < 2, None
+zero = 0
+n = Noisy()
+print 1 / zero + n.value()
+)", "Division by zero");
+}
+
+void TestCompiledUnassignedLocals() {
+  CheckFailsAsInterpreter("print 'start'\nprint x\nx = 1\n", "Not found: x");
+  CheckFailsAsInterpreter(R"(
+class A:
+  def f(c):
+    if c:
+      y = 1
+    return y
+
+a = A()
+print a.f(True)
+print a.f(False)
+)", "Not found: y");
+}
+
+void RunAotTests(TestRunner& tr) {
+  RUN_TEST(tr, Aot::TestMethodsBecomeFunctions);
+  RUN_TEST(tr, Aot::TestStaticallyKnownTypesAreUnboxed);
+  RUN_TEST(tr, Aot::TestStringLiteralsAreEscaped);
+  RUN_TEST(tr, Aot::TestThrowingOperationsAreHoisted);
+  RUN_TEST(tr, Aot::TestReturnOutsideMethod);
+  RUN_TEST(tr, Aot::TestUnassignedLocals);
+  RUN_TEST(tr, Aot::TestGeneratedCodeMatchesInterpreter);
+  RUN_TEST(tr, Aot::TestCompiledUnassignedLocals);
+}
+
+} /* namespace Aot */
@@ -0,0 +1,565 @@
+#include "cache.h"
+#include "comparators.h"
+#include "lexer.h"
+#include "object.h"
+#include "parse.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Cache {
+
+namespace {
+
+const char kMagic[4] = {'M', 'Y', 'C', '\0'};
+const uint32_t kVersion = 3;
+
+enum class Tag : uint8_t {
+  Null,
+  NumericConst,
+  StringConst,
+  BoolConst,
+  None,
+  VariableValue,
+  Assignment,
+  FieldAssignment,
+  Print,
+  MethodCall,
+  NewInstance,
+  Stringify,
+  Add,
+  Sub,
+  Mult,
+  Div,
+  Or,
+  And,
+  Not,
+  Compound,
+  Return,
+  ClassDefinition,
+  IfElse,
+  Comparison,
+};
+
+class Writer {
+public:
+  explicit Writer(ostream& out) : out(out) {
+  }
+
+  void WriteStatement(const Ast::Statement* statement) {
+    using namespace Ast;
+
+    if (!statement) {
+      WriteTag(Tag::Null);
+    } else if (auto number = dynamic_cast<const NumericConst*>(statement)) {
+      WriteTag(Tag::NumericConst);
+      WriteInt(number->value.GetValue());
+    } else if (auto str = dynamic_cast<const StringConst*>(statement)) {
+      WriteTag(Tag::StringConst);
+      WriteString(str->value.GetValue());
+    } else if (auto boolean = dynamic_cast<const BoolConst*>(statement)) {
+      WriteTag(Tag::BoolConst);
+      WriteInt(boolean->value.GetValue());
+    } else if (dynamic_cast<const None*>(statement)) {
+      WriteTag(Tag::None);
+    } else if (auto variable = dynamic_cast<const VariableValue*>(statement)) {
+      WriteTag(Tag::VariableValue);
+      WriteStrings(variable->dotted_ids);
+    } else if (auto assignment = dynamic_cast<const Assignment*>(statement)) {
+      WriteTag(Tag::Assignment);
+      WriteString(assignment->var_name);
+      WriteStatement(assignment->right_value.get());
+    } else if (auto field_assignment = dynamic_cast<const FieldAssignment*>(statement)) {
+      WriteTag(Tag::FieldAssignment);
+      WriteStrings(field_assignment->object.dotted_ids);
+      WriteString(field_assignment->field_name);
+      WriteStatement(field_assignment->right_value.get());
+    } else if (auto print = dynamic_cast<const Print*>(statement)) {
+      WriteTag(Tag::Print);
+      WriteStatements(print->GetArgs());
+    } else if (auto call = dynamic_cast<const MethodCall*>(statement)) {
+      WriteTag(Tag::MethodCall);
+      WriteStatement(call->object.get());
+      WriteString(call->method);
+      WriteStatements(call->args);
+    } else if (auto new_instance = dynamic_cast<const NewInstance*>(statement)) {
+      WriteTag(Tag::NewInstance);
+      WriteInt(ClassIndex(&new_instance->class_));
+      WriteStatements(new_instance->args);
+    } else if (auto stringify = dynamic_cast<const Stringify*>(statement)) {
+      WriteTag(Tag::Stringify);
+      WriteStatement(stringify->GetArgument());
+    } else if (auto add = dynamic_cast<const Add*>(statement)) {
+      WriteBinary(Tag::Add, *add);
+    } else if (auto sub = dynamic_cast<const Sub*>(statement)) {
+      WriteBinary(Tag::Sub, *sub);
+    } else if (auto mult = dynamic_cast<const Mult*>(statement)) {
+      WriteBinary(Tag::Mult, *mult);
+    } else if (auto div = dynamic_cast<const Div*>(statement)) {
+      WriteBinary(Tag::Div, *div);
+    } else if (auto disjunction = dynamic_cast<const Or*>(statement)) {
+      WriteBinary(Tag::Or, *disjunction);
+    } else if (auto conjunction = dynamic_cast<const And*>(statement)) {
+      WriteBinary(Tag::And, *conjunction);
+    } else if (auto negation = dynamic_cast<const Not*>(statement)) {
+      WriteTag(Tag::Not);
+      WriteStatement(negation->GetArgument());
+    } else if (auto compound = dynamic_cast<const Compound*>(statement)) {
+      WriteTag(Tag::Compound);
+      WriteInt(compound->GetStatements().size());
+      for (const auto& statement : compound->GetStatements()) {
+        WriteInt(statement->line);
+        WriteStatement(statement.get());
+      }
+    } else if (auto ret = dynamic_cast<const Return*>(statement)) {
+      WriteTag(Tag::Return);
+      WriteStatement(ret->GetStatement());
+    } else if (auto definition = dynamic_cast<const ClassDefinition*>(statement)) {
+      WriteTag(Tag::ClassDefinition);
+      WriteClass(definition->GetClass());
+    } else if (auto if_else = dynamic_cast<const IfElse*>(statement)) {
+      WriteTag(Tag::IfElse);
+      WriteStatement(if_else->GetCondition());
+      WriteStatement(if_else->GetIfBody());
+      WriteStatement(if_else->GetElseBody());
+    } else if (auto comparison = dynamic_cast<const Comparison*>(statement)) {
+      if (comparison->GetKind() == Comparison::Kind::Custom) {
+        throw CacheError("Can't store a custom comparator");
+      }
+      WriteTag(Tag::Comparison);
+      WriteInt(static_cast<int>(comparison->GetKind()));
+      WriteStatement(comparison->GetLeft());
+      WriteStatement(comparison->GetRight());
+    } else {
+      throw CacheError("Can't store statement of type " + string(typeid(*statement).name()));
+    }
+  }
+
+private:
+  ostream& out;
+  unordered_map<const Runtime::Class*, int> classes;
+
+  void WriteTag(Tag tag) {
+    out.put(static_cast<char>(tag));
+  }
+
+  void WriteInt(int32_t value) {
+    char bytes[4];
+    memcpy(bytes, &value, sizeof(bytes));
+    out.write(bytes, sizeof(bytes));
+  }
+
+  void WriteString(string_view value) {
+    WriteInt(value.size());
+    out.write(value.data(), value.size());
+  }
+
+  void WriteStrings(const vector<string>& values) {
+    WriteInt(values.size());
+    for (const auto& value : values) {
+      WriteString(value);
+    }
+  }
+
+  void WriteStatements(const vector<unique_ptr<Ast::Statement>>& statements) {
+    WriteInt(statements.size());
+    for (const auto& statement : statements) {
+      WriteStatement(statement.get());
+    }
+  }
+
+  void WriteBinary(Tag tag, const Ast::BinaryOperation& operation) {
+    WriteTag(tag);
+    WriteStatement(operation.GetLhs());
+    WriteStatement(operation.GetRhs());
+  }
+
+  int ClassIndex(const Runtime::Class* cls) {
+    if (auto it = classes.find(cls); it != classes.end()) {
+      return it->second;
+    }
+    throw CacheError("Class " + cls->GetName() + " is used before its definition");
+  }
+
+  // Classes are numbered in the order of their definitions, a class can only
+  // refer to classes defined before it
+  void WriteClass(const Runtime::Class& cls) {
+    WriteString(cls.GetName());
+    WriteInt(cls.GetParent() ? ClassIndex(cls.GetParent()) : -1);
+
+    vector<const Runtime::Method*> methods;
+    for (const auto& [name, method] : cls.GetMethods()) {
+      methods.push_back(&method);
+    }
+    sort(begin(methods), end(methods), [](auto lhs, auto rhs) {
+      return lhs->name < rhs->name;
+    });
+
+    WriteInt(methods.size());
+    for (const Runtime::Method* method : methods) {
+      WriteString(method->name);
+      WriteStrings(method->formal_params);
+      method->ParseBody();
+      WriteStatement(method->body.get());
+    }
+
+    int index = classes.size();
+    classes[&cls] = index;
+  }
+};
+
+class Reader {
+public:
+  explicit Reader(string_view data) : data(data) {
+  }
+
+  unique_ptr<Ast::Statement> ReadStatement() {
+    using namespace Ast;
+
+    switch (ReadTag()) {
+      case Tag::Null:
+        return nullptr;
+      case Tag::NumericConst:
+        return make_unique<NumericConst>(ReadInt());
+      case Tag::StringConst:
+        return make_unique<StringConst>(Runtime::String::Intern(ReadString()));
+      case Tag::BoolConst:
+        return make_unique<BoolConst>(ReadInt() != 0);
+      case Tag::None:
+        return make_unique<None>();
+      case Tag::VariableValue:
+        return make_unique<VariableValue>(ReadStrings());
+      case Tag::Assignment: {
+        string name = ReadString();
+        return make_unique<Assignment>(move(name), ReadStatement());
+      }
+      case Tag::FieldAssignment: {
+        VariableValue object(ReadStrings());
+        string field = ReadString();
+        return make_unique<FieldAssignment>(move(object), move(field), ReadStatement());
+      }
+      case Tag::Print:
+        return make_unique<Print>(ReadStatements());
+      case Tag::MethodCall: {
+        auto object = ReadStatement();
+        string method = ReadString();
+        return make_unique<MethodCall>(move(object), move(method), ReadStatements());
+      }
+      case Tag::NewInstance: {
+        const Runtime::Class* cls = ReadClassIndex();
+        if (!cls) {
+          throw CacheError("Unknown class index");
+        }
+        return make_unique<NewInstance>(*cls, ReadStatements());
+      }
+      case Tag::Stringify:
+        return make_unique<Stringify>(ReadStatement());
+      case Tag::Add:
+        return ReadBinary<Add>();
+      case Tag::Sub:
+        return ReadBinary<Sub>();
+      case Tag::Mult:
+        return ReadBinary<Mult>();
+      case Tag::Div:
+        return ReadBinary<Div>();
+      case Tag::Or:
+        return ReadBinary<Or>();
+      case Tag::And:
+        return ReadBinary<And>();
+      case Tag::Not:
+        return make_unique<Not>(ReadStatement());
+      case Tag::Compound: {
+        auto compound = make_unique<Compound>();
+        for (size_t count = ReadSize(); count > 0; --count) {
+          const int line = ReadInt();
+          auto statement = ReadStatement();
+          if (!statement) {
+            throw CacheError("Null statement in a compound");
+          }
+          statement->line = line;
+          compound->AddStatement(move(statement));
+        }
+        return compound;
+      }
+      case Tag::Return:
+        return make_unique<Return>(ReadStatement());
+      case Tag::ClassDefinition:
+        return make_unique<ClassDefinition>(ReadClass());
+      case Tag::IfElse: {
+        auto condition = ReadStatement();
+        auto if_body = ReadStatement();
+        return make_unique<IfElse>(move(condition), move(if_body), ReadStatement());
+      }
+      case Tag::Comparison: {
+        Comparison::Comparator comparator = ReadComparator();
+        auto lhs = ReadStatement();
+        return make_unique<Comparison>(move(comparator), move(lhs), ReadStatement());
+      }
+    }
+    throw CacheError("Unknown statement tag");
+  }
+
+  void ExpectEnd() const {
+    if (!data.empty()) {
+      throw CacheError("Trailing data in compiled program");
+    }
+  }
+
+private:
+  string_view data;
+  vector<ObjectHolder> classes;
+
+  string_view Take(size_t size) {
+    if (data.size() < size) {
+      throw CacheError("Compiled program is truncated");
+    }
+    string_view result = data.substr(0, size);
+    data.remove_prefix(size);
+    return result;
+  }
+
+  Tag ReadTag() {
+    auto tag = static_cast<uint8_t>(Take(1).front());
+    if (tag > static_cast<uint8_t>(Tag::Comparison)) {
+      throw CacheError("Unknown statement tag");
+    }
+    return static_cast<Tag>(tag);
+  }
+
+  int32_t ReadInt() {
+    int32_t value;
+    memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+    return value;
+  }
+
+  size_t ReadSize() {
+    int32_t size = ReadInt();
+    if (size < 0) {
+      throw CacheError("Negative size in compiled program");
+    }
+    return size;
+  }
+
+  string ReadString() {
+    return string(Take(ReadSize()));
+  }
+
+  vector<string> ReadStrings() {
+    vector<string> result(ReadSize());
+    for (auto& value : result) {
+      value = ReadString();
+    }
+    return result;
+  }
+
+  vector<unique_ptr<Ast::Statement>> ReadStatements() {
+    size_t count = ReadSize();
+    vector<unique_ptr<Ast::Statement>> result;
+    result.reserve(min(count, data.size()));
+    for (size_t i = 0; i < count; ++i) {
+      result.push_back(ReadStatement());
+    }
+    return result;
+  }
+
+  template <typename Operation>
+  unique_ptr<Ast::Statement> ReadBinary() {
+    auto lhs = ReadStatement();
+    return make_unique<Operation>(move(lhs), ReadStatement());
+  }
+
+  Ast::Comparison::Comparator ReadComparator() {
+    using Kind = Ast::Comparison::Kind;
+
+    switch (static_cast<Kind>(ReadInt())) {
+      case Kind::Equal: return Runtime::Equal;
+      case Kind::NotEqual: return Runtime::NotEqual;
+      case Kind::Less: return Runtime::Less;
+      case Kind::Greater: return Runtime::Greater;
+      case Kind::LessOrEqual: return Runtime::LessOrEqual;
+      case Kind::GreaterOrEqual: return Runtime::GreaterOrEqual;
+      case Kind::Custom: break;
+    }
+    throw CacheError("Unknown comparison");
+  }
+
+  const Runtime::Class* ReadClassIndex() {
+    int32_t index = ReadInt();
+    if (index == -1) {
+      return nullptr;
+    } else if (index < 0 || static_cast<size_t>(index) >= classes.size()) {
+      throw CacheError("Unknown class index");
+    }
+    return classes[index].TryAs<Runtime::Class>();
+  }
+
+  ObjectHolder ReadClass() {
+    string name = ReadString();
+    const Runtime::Class* parent = ReadClassIndex();
+
+    vector<Runtime::Method> methods(ReadSize());
+    for (auto& method : methods) {
+      method.name = ReadString();
+      method.formal_params = ReadStrings();
+      method.body = ReadStatement();
+    }
+
+    classes.push_back(ObjectHolder::Own(Runtime::Class(move(name), move(methods), parent)));
+    return classes.back();
+  }
+};
+
+string CachePath(const string& cache_dir, uint64_t source_hash) {
+  ostringstream path;
+  path << cache_dir << '/' << hex << setw(16) << setfill('0') << source_hash << ".myc";
+  return path.str();
+}
+
+} /* namespace */
+
+uint64_t HashSource(string_view source) {
+  // 64-bit FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : source) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// The header is the magic, the version, the size of the source and the
+// source itself
+void Write(const Ast::Statement& program, string_view source, ostream& out) {
+  const uint64_t source_size = source.size();
+  out.write(kMagic, sizeof(kMagic));
+  out.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  out.write(reinterpret_cast<const char*>(&source_size), sizeof(source_size));
+  out.write(source.data(), source.size());
+  Writer(out).WriteStatement(&program);
+}
+
+unique_ptr<Ast::Statement> Read(string_view data, string_view source) {
+  uint64_t source_size;
+  const size_t prefix_size = sizeof(kMagic) + sizeof(kVersion) + sizeof(source_size);
+  if (data.size() < prefix_size || data.substr(0, sizeof(kMagic)) != string_view(kMagic, sizeof(kMagic))) {
+    throw CacheError("Not a compiled program");
+  }
+
+  uint32_t version;
+  memcpy(&version, data.data() + sizeof(kMagic), sizeof(version));
+  memcpy(&source_size, data.data() + sizeof(kMagic) + sizeof(version), sizeof(source_size));
+  if (version != kVersion || source_size != source.size()) {
+    return nullptr;
+  } else if (data.size() - prefix_size < source_size) {
+    throw CacheError("Compiled program is truncated");
+  } else if (data.substr(prefix_size, source_size) != source) {
+    return nullptr;
+  }
+
+  Reader reader(data.substr(prefix_size + source_size));
+  auto program = reader.ReadStatement();
+  reader.ExpectEnd();
+  return program;
+}
+
+unique_ptr<Ast::Statement> Load(const string& path, string_view source) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+
+  unique_ptr<Ast::Statement> program;
+  try {
+    program = Read(string_view(static_cast<const char*>(data), info.st_size), source);
+  } catch (...) {
+    munmap(data, info.st_size);
+    throw;
+  }
+  munmap(data, info.st_size);
+  return program;
+}
+
+void Save(const Ast::Statement& program, string_view source, const string& path) {
+  // Written next to the target and renamed, so a concurrent reader never
+  // sees a partial file. The name is unique to the call, threads of a daemon
+  // may save the same program at once.
+  static atomic<uint64_t> saves{0};
+  const string temp_path = path + ".tmp" + to_string(getpid()) + "-" + to_string(saves++);
+  try {
+    ofstream out(temp_path, ios::binary | ios::trunc);
+    if (!out) {
+      throw CacheError("Can't write " + temp_path);
+    }
+    Write(program, source, out);
+    if (!out) {
+      throw CacheError("Can't write " + temp_path);
+    }
+  } catch (...) {
+    remove(temp_path.c_str());
+    throw;
+  }
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    remove(temp_path.c_str());
+    throw CacheError("Can't write " + path);
+  }
+}
+
+unique_ptr<Ast::Statement> ParseCached(string_view source, const string& cache_dir, const ParseOptions& options) {
+  const string path = CachePath(cache_dir, HashSource(source));
+
+  try {
+    if (auto program = Load(path, source)) {
+      return program;
+    }
+  } catch (const CacheError&) {
+    // A corrupted file is replaced below
+  }
+
+  optional<Parse::Lexer> lexer;
+  if (options.threads != 1) {
+    // Parallel parsing needs the tokens of the whole program
+    istringstream input{string(source)};
+    lexer.emplace(make_shared<const Parse::TokenStream>(input));
+  } else {
+    lexer.emplace(string(source));
+  }
+  auto program = ParseProgram(*lexer, options);
+  try {
+    Save(*program, source, path);
+  } catch (const exception&) {
+    // The cache only saves time, a program which parsed runs anyway
+  }
+  return program;
+}
+
+} /* namespace Cache */
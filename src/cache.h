@@ -0,0 +1,52 @@
+#pragma once
+
+#include "parse.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace Ast {
+  class Statement;
+}
+
+class TestRunner;
+
+namespace Cache {
+
+// Compiled programs (.myc files) store the parsed AST of a program in a
+// binary form, so that an unchanged script can be loaded without lexing and
+// parsing it again. A file starts with a header holding the format version
+// and the source it was built from; a file with another version or source is
+// stale and ignored. The hash of the source only names the file, two sources
+// with the same hash replace each other's file.
+struct CacheError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+uint64_t HashSource(std::string_view source);
+
+void Write(const Ast::Statement& program, std::string_view source, std::ostream& out);
+
+// Returns nullptr for a stale file, throws CacheError for a corrupted one
+std::unique_ptr<Ast::Statement> Read(std::string_view data, std::string_view source);
+
+// Maps the file into memory, returns nullptr if it doesn't exist or is stale
+std::unique_ptr<Ast::Statement> Load(const std::string& path, std::string_view source);
+void Save(const Ast::Statement& program, std::string_view source, const std::string& path);
+
+// Loads the program from <cache_dir>/<source hash>.myc, or parses the source
+// with the options and stores the result there if it can. A stored program
+// has all its method bodies parsed, so it is the same whatever the options;
+// a program with a method body which doesn't parse is never stored, and
+// lazy_methods without validate keeps deferring its error.
+std::unique_ptr<Ast::Statement> ParseCached(
+  std::string_view source, const std::string& cache_dir, const ParseOptions& options = {}
+);
+
+void RunCacheTests(TestRunner& tr);
+
+} /* namespace Cache */
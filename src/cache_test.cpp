@@ -0,0 +1,210 @@
+#include "cache.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Cache {
+
+const string kProgram = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def area():
+    return 0
+
+  def __str__():
+    return self.name + '(' + str(self.area()) + ')'
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'Rect'
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+class Factory:
+  def make(w, h):
+    if w == h and not w < 0:
+      return Rect(w, w)
+    else:
+      if w > h or w >= h:
+        return Shape('Shape')
+    return Rect(w - 1 / 1, h + 0)
+
+f = Factory()
+print f.make(2, 2), f.make(3, 1), f.make(1, 3), None, True, 1 != 2, 'x' <= 'y'
+)";
+
+string Execute(Ast::Statement& program) {
+  ostringstream output;
+  Ast::Print::SetOutputStream(output);
+  Runtime::Closure closure;
+  program.Execute(closure);
+  return output.str();
+}
+
+unique_ptr<Ast::Statement> Parse(const string& source) {
+  istringstream input(source);
+  Parse::Lexer lexer(input);
+  return ParseProgram(lexer);
+}
+
+string Serialize(const Ast::Statement& program, string_view source) {
+  ostringstream out;
+  Write(program, source, out);
+  return out.str();
+}
+
+void TestRoundTrip() {
+  auto program = Parse(kProgram);
+  const string data = Serialize(*program, kProgram);
+
+  auto loaded = Read(data, kProgram);
+  ASSERT(loaded);
+  ASSERT_EQUAL(Execute(*loaded), Execute(*program));
+
+  // The loaded program serializes to the same bytes
+  ASSERT_EQUAL(Serialize(*loaded, kProgram), data);
+}
+
+void TestStaleAndCorrupted() {
+  ASSERT(HashSource(kProgram) != HashSource(kProgram + "\n"));
+
+  const string data = Serialize(*Parse(kProgram), kProgram);
+  ASSERT(!Read(data, kProgram + "\n"));
+
+  // A source of the same size is compared byte by byte
+  string changed = kProgram;
+  changed[changed.find("Rect(w, w)") + 5] = 'h';
+  ASSERT(!Read(data, changed));
+
+  try {
+    Read(data.substr(0, data.size() - 3), kProgram);
+    ASSERT(false);
+  } catch (const CacheError&) {
+  }
+
+  try {
+    Read(data.substr(0, 20), kProgram);
+    ASSERT(false);
+  } catch (const CacheError&) {
+  }
+
+  try {
+    Read("not a compiled program", kProgram);
+    ASSERT(false);
+  } catch (const CacheError&) {
+  }
+}
+
+void TestParseCached() {
+  const auto dir = filesystem::temp_directory_path() / ("mython-cache-test-" + to_string(HashSource(kProgram)));
+  filesystem::remove_all(dir);
+  filesystem::create_directories(dir);
+
+  auto parsed = ParseCached(kProgram, dir.string());
+  const string expected = Execute(*parsed);
+
+  size_t files = distance(filesystem::directory_iterator(dir), filesystem::directory_iterator());
+  ASSERT_EQUAL(files, 1u);
+  const auto path = filesystem::directory_iterator(dir)->path();
+  ASSERT_EQUAL(path.extension().string(), ".myc");
+
+  auto loaded = Load(path.string(), kProgram);
+  ASSERT(loaded);
+  ASSERT_EQUAL(Execute(*loaded), expected);
+
+  // A corrupted file is replaced
+  ofstream(path, ios::binary | ios::trunc) << "MYC";
+  ASSERT_EQUAL(Execute(*ParseCached(kProgram, dir.string())), expected);
+  ASSERT(Load(path.string(), kProgram));
+
+  // So is a file of another source under the same name, as after a hash
+  // collision
+  const string other = "print 'other'\n";
+  Save(*Parse(other), other, path.string());
+  ASSERT_EQUAL(Execute(*ParseCached(kProgram, dir.string())), expected);
+  ASSERT(Load(path.string(), kProgram));
+
+  filesystem::remove_all(dir);
+}
+
+void TestUnwritableCache() {
+  const auto dir = filesystem::temp_directory_path() / ("mython-cache-test-" + to_string(HashSource(kProgram) + 1));
+  filesystem::remove_all(dir);
+  filesystem::create_directories(dir / "target" / "taken");
+  auto program = ParseCached(kProgram, dir.string());
+
+  // A cache which can't be written doesn't fail the run
+  const auto missing = dir / "missing" / "dir";
+  ASSERT_EQUAL(Execute(*ParseCached(kProgram, missing.string())), Execute(*program));
+  ASSERT(!filesystem::exists(missing));
+
+  // The temporary file of a failed save is removed
+  ASSERT_THROWS(Save(*program, kProgram, (dir / "target").string()), CacheError);
+  size_t files = distance(filesystem::directory_iterator(dir), filesystem::directory_iterator());
+  ASSERT_EQUAL(files, 2u);
+
+  filesystem::remove_all(dir);
+}
+
+void TestParseOptions() {
+  const string source = R"(
+class A:
+  def used():
+    return 1
+
+  def broken():
+    return 1 +
+
+a = A()
+print a.used()
+)";
+  const auto dir = filesystem::temp_directory_path() / ("mython-cache-test-" + to_string(HashSource(source)));
+  filesystem::remove_all(dir);
+  filesystem::create_directories(dir);
+
+  // Lazy methods defer the error of a body which is never called, and such a
+  // program isn't stored
+  ParseOptions lazy;
+  lazy.lazy_methods = true;
+  for (int run = 0; run < 2; ++run) {
+    ASSERT_EQUAL(Execute(*ParseCached(source, dir.string(), lazy)), "1\n");
+  }
+  ASSERT(filesystem::is_empty(dir));
+
+  ASSERT_THROWS(ParseCached(source, dir.string()), Parse::LexerError);
+  lazy.validate = true;
+  ASSERT_THROWS(ParseCached(source, dir.string(), lazy), Parse::LexerError);
+
+  // Parallel parsing of the classes gives the same program
+  ParseOptions parallel;
+  parallel.threads = 2;
+  ASSERT_EQUAL(Execute(*ParseCached(kProgram, dir.string(), parallel)), Execute(*Parse(kProgram)));
+  ASSERT_EQUAL(Execute(*ParseCached(kProgram, dir.string())), Execute(*Parse(kProgram)));
+
+  filesystem::remove_all(dir);
+}
+
+void RunCacheTests(TestRunner& tr) {
+  RUN_TEST(tr, Cache::TestRoundTrip);
+  RUN_TEST(tr, Cache::TestStaleAndCorrupted);
+  RUN_TEST(tr, Cache::TestParseCached);
+  RUN_TEST(tr, Cache::TestUnwritableCache);
+  RUN_TEST(tr, Cache::TestParseOptions);
+}
+
+} /* namespace Cache */
@@ -0,0 +1,121 @@
+#include "server.h"
+#include "server_protocol.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Server {
+
+namespace Protocol {
+
+string ErrorText(const string& what) {
+  return what + ": " + strerror(errno);
+}
+
+void SendAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw ServerError(ErrorText("send"));
+    }
+    data += sent;
+    size -= sent;
+  }
+}
+
+bool ReceiveAll(int fd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t received = recv(fd, data, size, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    } else if (received <= 0) {
+      return false;
+    }
+    data += received;
+    size -= received;
+  }
+  return true;
+}
+
+void SendFrame(int fd, char type, string_view payload) {
+  char header[5] = {type};
+  uint32_t size = payload.size();
+  memcpy(header + 1, &size, sizeof(size));
+  SendAll(fd, header, sizeof(header));
+  SendAll(fd, payload.data(), payload.size());
+}
+
+sockaddr_un SocketAddress(const string& path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw ServerError("Socket path is too long: " + path);
+  }
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+
+} /* namespace Protocol */
+
+using namespace Protocol;
+
+bool Execute(const string& socket_path, string_view script, ostream& out, ostream& err) {
+  sockaddr_un address = SocketAddress(socket_path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw ServerError(ErrorText("socket"));
+  }
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    string error = ErrorText("Can't connect to " + socket_path);
+    close(fd);
+    throw ServerError(error);
+  }
+
+  bool succeeded = true;
+  try {
+    uint32_t size = script.size();
+    SendAll(fd, reinterpret_cast<const char*>(&size), sizeof(size));
+    SendAll(fd, script.data(), script.size());
+
+    while (true) {
+      char header[5];
+      if (!ReceiveAll(fd, header, sizeof(header))) {
+        throw ServerError("Connection closed by the server");
+      }
+      memcpy(&size, header + 1, sizeof(size));
+      string payload(size, '\0');
+      if (!ReceiveAll(fd, payload.data(), size)) {
+        throw ServerError("Connection closed by the server");
+      }
+
+      if (header[0] == 'O') {
+        out << payload;
+      } else if (header[0] == 'E') {
+        err << payload << '\n';
+        succeeded = false;
+      } else if (header[0] == 'X') {
+        break;
+      } else {
+        throw ServerError("Unknown frame from the server");
+      }
+    }
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+
+  close(fd);
+  return succeeded;
+}
+
+} /* namespace Server */
@@ -10,12 +10,18 @@ using namespace std;
 
 namespace Runtime {
 
-bool Equal(ObjectHolder lhs, ObjectHolder rhs) {
+bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+	if (ClassInstance* object = lhs.TryAs<ClassInstance>()) {
+		if (const Method* eq = object->GetClass().GetSlots().eq) {
+			return IsTrue(object->Call(*eq, {rhs}));
+		}
+		return false;
+	}
 	if (lhs.TryAs<Number>()) {
 		return lhs.TryAs<Number>()->GetValue() == rhs.TryAs<Number>()->GetValue();
 	}
 	if (lhs.TryAs<String>()) {
-		return lhs.TryAs<String>()->GetValue() == rhs.TryAs<String>()->GetValue();
+		return *lhs.TryAs<String>() == *rhs.TryAs<String>();
 	}
 	if (lhs.TryAs<Bool>()) {
 		return lhs.TryAs<Bool>()->GetValue() == rhs.TryAs<Bool>()->GetValue();
@@ -23,7 +29,13 @@ bool Equal(ObjectHolder lhs, ObjectHolder rhs) {
 	return false;
 }
 
-bool Less(ObjectHolder lhs, ObjectHolder rhs) {
+bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+	if (ClassInstance* object = lhs.TryAs<ClassInstance>()) {
+		if (const Method* lt = object->GetClass().GetSlots().lt) {
+			return IsTrue(object->Call(*lt, {rhs}));
+		}
+		return false;
+	}
 	if (lhs.TryAs<Number>()) {
 		return lhs.TryAs<Number>()->GetValue() < rhs.TryAs<Number>()->GetValue();
 	}
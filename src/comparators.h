@@ -4,22 +4,22 @@
 
 namespace Runtime {
 
-bool Equal(ObjectHolder lhs, ObjectHolder rhs);
-bool Less(ObjectHolder lhs, ObjectHolder rhs);
+bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs);
+bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs);
 
-inline bool NotEqual(ObjectHolder lhs, ObjectHolder rhs) {
+inline bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs) {
   return !Equal(lhs, rhs);
 }
 
-inline bool Greater(ObjectHolder lhs, ObjectHolder rhs) {
+inline bool Greater(const ObjectHolder& lhs, const ObjectHolder& rhs) {
   return !Less(lhs, rhs) && !Equal(lhs, rhs);
 }
 
-inline bool LessOrEqual(ObjectHolder lhs, ObjectHolder rhs) {
+inline bool LessOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs) {
   return !Greater(lhs, rhs);
 }
 
-inline bool GreaterOrEqual(ObjectHolder lhs, ObjectHolder rhs) {
+inline bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs) {
   return !Less(lhs, rhs);
 }
 
@@ -0,0 +1,232 @@
+#include "interpreter.h"
+#include "cache.h"
+#include "jit.h"
+#include "lexer.h"
+#include "metrics.h"
+#include "parallel_lexer.h"
+#include "parse.h"
+#include "profile.h"
+#include "statement.h"
+#include "trace.h"
+
+#include <exception>
+#include <iomanip>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+chrono::nanoseconds LexOnly(const string& source) {
+  const auto start = Clock::now();
+  Parse::Lexer lexer(source);
+  while (!lexer.CurrentToken().Is<Parse::TokenType::Eof>()) {
+    lexer.NextToken();
+  }
+  return Clock::now() - start;
+}
+
+// The separately measured lexing is part of the parse time
+void SetParseTime(PhaseTimings& timings, chrono::nanoseconds parse, bool separate_lex) {
+  if (separate_lex) {
+    parse -= timings.lex;
+  }
+  timings.parse = max(parse, chrono::nanoseconds::zero());
+}
+
+void Execute(Ast::Statement& statement, Runtime::Closure& closure, const RunOptions& options) {
+  if (options.profile) {
+    Ast::ExecuteProfiled(statement, closure);
+  } else {
+    statement.Execute(closure);
+  }
+}
+
+void Execute(Ast::Statement& program, const RunOptions& options, PhaseTimings* timings) {
+  const auto start = Clock::now();
+  Runtime::Closure closure;
+  Execute(program, closure, options);
+  if (timings) {
+    timings->execute = Clock::now() - start;
+  }
+}
+
+// Counts the error which ends the program, see Metrics::Stats
+struct ErrorCounter {
+  int exceptions = uncaught_exceptions();
+
+  ~ErrorCounter() {
+    if (uncaught_exceptions() > exceptions) {
+      Metrics::ProgramFailed();
+    }
+  }
+};
+
+void StartProfile(const RunOptions& options) {
+  if (options.profile) {
+    Profile::Reset();
+  }
+}
+
+void WriteProfile(const RunOptions& options) {
+  if (options.profile) {
+    Profile::WriteJson(Profile::GetReport(), *options.profile);
+  }
+}
+
+}
+
+void RunMythonProgram(istream& input, ostream& output) {
+  ErrorCounter errors;
+  Ast::Print::SetOutputStream(output);
+
+  Parse::Lexer lexer(input);
+  auto program = ParseProgram(lexer);
+
+  Runtime::Closure closure;
+  program->Execute(closure);
+}
+
+void RunMythonProgram(istream& input, ostream& output, const RunOptions& options, PhaseTimings* timings) {
+  ErrorCounter errors;
+  Ast::Print::SetOutputStream(output);
+
+  // Statements executed while parsing are lexed from the input line by line,
+  // their text is dropped once they are parsed
+  const bool read_lines = options.streaming && options.cache_dir.empty() && !options.token_stream;
+
+  auto start = Clock::now();
+  string source;
+  if (!read_lines) {
+    source.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+  }
+  auto finish = Clock::now();
+  const bool separate_lex = options.cache_dir.empty() && !options.token_stream && !read_lines;
+  if (timings) {
+    timings->read = finish - start;
+    timings->lex = separate_lex ? LexOnly(source) : chrono::nanoseconds::zero();
+  }
+
+  if (!options.cache_dir.empty()) {
+    start = Clock::now();
+    auto program = Cache::ParseCached(source, options.cache_dir, options.parse);
+    finish = Clock::now();
+    if (timings) {
+      timings->parse = finish - start;
+    }
+    StartProfile(options);
+    Execute(*program, options, timings);
+    WriteProfile(options);
+    return;
+  }
+
+  shared_ptr<const Parse::TokenStream> stream;
+  if (options.token_stream) {
+    start = Clock::now();
+    Parse::ParallelLexOptions lex_options;
+    lex_options.threads = options.lex_threads;
+    stream = make_shared<const Parse::TokenStream>(Parse::LexParallel(source, lex_options));
+    if (timings) {
+      timings->lex = Clock::now() - start;
+    }
+  }
+
+  start = Clock::now();
+  optional<Parse::Lexer> lexer;
+  if (stream) {
+    lexer.emplace(move(stream));
+  } else if (read_lines) {
+    lexer.emplace(input);
+  } else {
+    lexer.emplace(move(source));
+  }
+
+  if (options.streaming) {
+    StartProfile(options);
+    Runtime::Closure closure;
+    chrono::nanoseconds execute{};
+    ParseProgram(*lexer, options.parse, [&](unique_ptr<Ast::Statement> statement) {
+      const auto statement_start = Clock::now();
+      Execute(*statement, closure, options);
+      execute += Clock::now() - statement_start;
+    });
+    WriteProfile(options);
+    finish = Clock::now();
+    if (timings) {
+      SetParseTime(*timings, finish - start - execute, separate_lex);
+      timings->execute = execute;
+    }
+    return;
+  }
+
+  auto program = ParseProgram(*lexer, options.parse);
+  finish = Clock::now();
+  if (timings) {
+    SetParseTime(*timings, finish - start, separate_lex);
+  }
+  StartProfile(options);
+  Execute(*program, options, timings);
+  WriteProfile(options);
+}
+
+void PrintTimings(const PhaseTimings& timings, ostream& out) {
+  auto print = [&out](const char* phase, chrono::nanoseconds duration) {
+    out << setw(8) << left << phase << fixed << setprecision(3)
+        << chrono::duration<double, milli>(duration).count() << " ms\n";
+  };
+  print("read", timings.read);
+  print("lex", timings.lex);
+  print("parse", timings.parse);
+  print("execute", timings.execute);
+}
+
+void SetEngine(string_view engine) {
+  if (engine != "interpreter" && engine != "jit" && engine != "trace" && engine != "jit+trace") {
+    throw invalid_argument("Unknown engine " + string(engine));
+  }
+  Jit::SetEnabled(engine == "jit" || engine == "jit+trace");
+  Trace::SetEnabled(engine == "trace" || engine == "jit+trace");
+}
+
+EngineScope::EngineScope(string_view engine)
+  : jit(Jit::IsEnabled()), trace(Trace::IsEnabled())
+{
+  SetEngine(engine);
+}
+
+EngineScope::~EngineScope() {
+  Jit::SetEnabled(jit);
+  Trace::SetEnabled(trace);
+}
+
+bool HasPrefix(string_view arg, string_view prefix, string_view& value) {
+  if (arg.substr(0, prefix.size()) != prefix) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseEngineOption(string_view arg) {
+  string_view value;
+  if (HasPrefix(arg, "--engine=", value)) {
+    SetEngine(value);
+  } else if (arg == "--jit") {
+    Jit::SetEnabled(true);
+  } else if (HasPrefix(arg, "--jit-threshold=", value)) {
+    Jit::SetEnabled(true);
+    Jit::SetThreshold(stoul(string(value)));
+  } else if (arg == "--trace") {
+    Trace::SetEnabled(true);
+  } else if (HasPrefix(arg, "--trace-threshold=", value)) {
+    Trace::SetEnabled(true);
+    Trace::SetThreshold(stoul(string(value)));
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "parse.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// How long each phase of a program run took. Lexing happens on demand while
+// parsing, so lex is measured by a separate tokenizing pass, which is only
+// done when timings are requested, and parse excludes it. With a token stream
+// both are measured directly. With the program cache, parse is the time to
+// load or build the cached program and lex is 0. When statements are executed
+// while parsing, execute is their total time and parse the rest; without a
+// token stream the source is read while parsing, and read and lex are 0.
+struct PhaseTimings {
+  std::chrono::nanoseconds read{};
+  std::chrono::nanoseconds lex{};
+  std::chrono::nanoseconds parse{};
+  std::chrono::nanoseconds execute{};
+};
+
+struct RunOptions {
+  // Parsed programs are cached in the directory unless it's empty
+  std::string cache_dir;
+  // Tokenizes the whole program into a Parse::TokenStream before parsing
+  bool token_stream = false;
+  // Threads of Parse::LexParallel for the token stream, 0 for all cores
+  size_t lex_threads = 1;
+  // Executes each top-level statement once it is parsed and then drops it.
+  // Output starts before the whole program is parsed, and statements before a
+  // syntax error are executed. Ignored with the program cache.
+  bool streaming = false;
+  // The execution is profiled and the profile written to the stream as JSON
+  // after the program, see profile.h
+  std::ostream* profile = nullptr;
+  ParseOptions parse;
+};
+
+void RunMythonProgram(std::istream& input, std::ostream& output);
+
+// Timings are filled if not null
+void RunMythonProgram(
+  std::istream& input, std::ostream& output, const RunOptions& options, PhaseTimings* timings
+);
+
+void PrintTimings(const PhaseTimings& timings, std::ostream& out);
+
+// Selects the engine of method calls: interpreter, jit, trace or jit+trace.
+// Throws invalid_argument for another name.
+void SetEngine(std::string_view engine);
+
+// Selects the engine while alive and restores the previous one after
+class EngineScope {
+public:
+  explicit EngineScope(std::string_view engine);
+  ~EngineScope();
+
+  EngineScope(const EngineScope&) = delete;
+  EngineScope& operator=(const EngineScope&) = delete;
+
+private:
+  bool jit;
+  bool trace;
+};
+
+// Whether a command line argument starts with the prefix, the rest of it is
+// stored in value, e.g. "--engine=jit" with "--engine="
+bool HasPrefix(std::string_view arg, std::string_view prefix, std::string_view& value);
+
+// Applies an engine option of the command line (--engine=, --jit, --trace,
+// --jit-threshold=, --trace-threshold=), false if arg isn't one
+bool ParseEngineOption(std::string_view arg);
@@ -0,0 +1,531 @@
+#include "jit.h"
+#include "object.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Jit {
+
+namespace {
+
+bool enabled = false;
+size_t threshold = 100;
+thread_local Stats stats;
+
+} /* namespace */
+
+struct Frame;
+struct Instr;
+
+// A stencil executes one instruction and returns the index of the next one
+using Stencil = size_t (*)(Frame& frame, const Instr& instr, size_t pc);
+
+using CompareOp = Ast::Comparison::Kind;
+
+// Operands patched into a stencil. Registers are indices in the frame,
+// objects/ints registers live in separate files.
+struct Instr {
+  Stencil stencil;
+  int dst = 0;
+  int a = 0;
+  int b = 0;
+  int imm = 0;
+  size_t target = 0;
+  CompareOp op = CompareOp::Custom;
+  Ast::Statement* node = nullptr;
+  Runtime::Object* object = nullptr;
+  const string* name = nullptr;
+  const Ast::Comparison::Comparator* comparator = nullptr;
+  const Runtime::Method* method = nullptr;
+};
+
+class Code {
+public:
+  vector<Instr> instructions;
+  int object_registers = 0;
+  int int_registers = 0;
+};
+
+struct Frame {
+  Runtime::Closure& closure;
+  ObjectHolder* objects;
+  int* ints;
+  ObjectHolder result;
+};
+
+namespace {
+
+using Runtime::Number;
+
+const size_t kHalt = numeric_limits<size_t>::max();
+
+bool CompareInts(CompareOp op, int lhs, int rhs) {
+  switch (op) {
+    case CompareOp::Equal: return lhs == rhs;
+    case CompareOp::NotEqual: return lhs != rhs;
+    case CompareOp::Less: return lhs < rhs;
+    case CompareOp::Greater: return lhs > rhs;
+    case CompareOp::LessOrEqual: return lhs <= rhs;
+    case CompareOp::GreaterOrEqual: return lhs >= rhs;
+    case CompareOp::Custom: break;
+  }
+  throw logic_error("Unknown integer comparison");
+}
+
+bool CompareObjects(Frame& frame, const Instr& instr) {
+  const ObjectHolder& lhs = frame.objects[instr.a];
+  const ObjectHolder& rhs = frame.objects[instr.b];
+  if (instr.op != CompareOp::Custom) {
+    auto l = lhs.TryAs<Number>();
+    auto r = rhs.TryAs<Number>();
+    if (l && r) {
+      return CompareInts(instr.op, l->GetValue(), r->GetValue());
+    }
+    ++stats.deoptimizations;
+  }
+  return (*instr.comparator)(lhs, rhs);
+}
+
+size_t LoadObject(Frame& frame, const Instr& instr, size_t pc) {
+  frame.objects[instr.dst] = ObjectHolder::Share(*instr.object);
+  return pc + 1;
+}
+
+size_t LoadNone(Frame& frame, const Instr& instr, size_t pc) {
+  frame.objects[instr.dst] = ObjectHolder::None();
+  return pc + 1;
+}
+
+size_t LoadVariable(Frame& frame, const Instr& instr, size_t pc) {
+  auto it = frame.closure.find(*instr.name);
+  if (it == frame.closure.end()) {
+    throw runtime_error("Not found: " + *instr.name);
+  }
+  frame.objects[instr.dst] = it->second;
+  return pc + 1;
+}
+
+size_t StoreVariable(Frame& frame, const Instr& instr, size_t pc) {
+  frame.closure[*instr.name] = frame.objects[instr.a];
+  return pc + 1;
+}
+
+size_t Move(Frame& frame, const Instr& instr, size_t pc) {
+  frame.objects[instr.dst] = frame.objects[instr.a];
+  return pc + 1;
+}
+
+size_t EvaluateNode(Frame& frame, const Instr& instr, size_t pc) {
+  frame.objects[instr.dst] = instr.node->Execute(frame.closure);
+  return pc + 1;
+}
+
+size_t ExecuteNode(Frame& frame, const Instr& instr, size_t pc) {
+  instr.node->Execute(frame.closure);
+  return pc + 1;
+}
+
+size_t LoadInt(Frame& frame, const Instr& instr, size_t pc) {
+  frame.ints[instr.dst] = instr.imm;
+  return pc + 1;
+}
+
+// The operand is already evaluated, so a failed guard converts it as the
+// interpreter does rather than executing the node again. An operand the
+// interpreter rejects too is an error of the program, not a deoptimization.
+size_t Unbox(Frame& frame, const Instr& instr, size_t pc) {
+  const ObjectHolder& operand = frame.objects[instr.a];
+  if (auto number = operand.TryAs<Number>()) {
+    frame.ints[instr.dst] = number->GetValue();
+    return pc + 1;
+  }
+  frame.ints[instr.dst] = Ast::IntOperation::Operand(operand);
+  ++stats.deoptimizations;
+  return pc + 1;
+}
+
+size_t Box(Frame& frame, const Instr& instr, size_t pc) {
+  frame.objects[instr.dst] = ObjectHolder::Own(Number(frame.ints[instr.a]));
+  return pc + 1;
+}
+
+size_t IntAdd(Frame& frame, const Instr& instr, size_t pc) {
+  frame.ints[instr.dst] = frame.ints[instr.a] + frame.ints[instr.b];
+  return pc + 1;
+}
+
+size_t IntSub(Frame& frame, const Instr& instr, size_t pc) {
+  frame.ints[instr.dst] = frame.ints[instr.a] - frame.ints[instr.b];
+  return pc + 1;
+}
+
+size_t IntMult(Frame& frame, const Instr& instr, size_t pc) {
+  frame.ints[instr.dst] = frame.ints[instr.a] * frame.ints[instr.b];
+  return pc + 1;
+}
+
+size_t IntDiv(Frame& frame, const Instr& instr, size_t pc) {
+  frame.ints[instr.dst] = Ast::Div::Evaluate(frame.ints[instr.a], frame.ints[instr.b]);
+  return pc + 1;
+}
+
+size_t AddObjects(Frame& frame, const Instr& instr, size_t pc) {
+  const ObjectHolder& lhs = frame.objects[instr.a];
+  const ObjectHolder& rhs = frame.objects[instr.b];
+  auto l = lhs.TryAs<Number>();
+  auto r = rhs.TryAs<Number>();
+  if (l && r) {
+    frame.objects[instr.dst] = ObjectHolder::Own(Number(l->GetValue() + r->GetValue()));
+  } else {
+    ++stats.deoptimizations;
+    frame.objects[instr.dst] = Ast::Add::Evaluate(lhs, rhs);
+  }
+  return pc + 1;
+}
+
+size_t Compare(Frame& frame, const Instr& instr, size_t pc) {
+  frame.objects[instr.dst] = ObjectHolder::Own(Runtime::Bool(CompareObjects(frame, instr)));
+  return pc + 1;
+}
+
+size_t IntCompare(Frame& frame, const Instr& instr, size_t pc) {
+  bool result = CompareInts(instr.op, frame.ints[instr.a], frame.ints[instr.b]);
+  frame.objects[instr.dst] = ObjectHolder::Own(Runtime::Bool(result));
+  return pc + 1;
+}
+
+size_t JumpUnlessTrue(Frame& frame, const Instr& instr, size_t pc) {
+  return Runtime::IsTrue(frame.objects[instr.a]) ? pc + 1 : instr.target;
+}
+
+size_t JumpUnlessCompare(Frame& frame, const Instr& instr, size_t pc) {
+  return CompareObjects(frame, instr) ? pc + 1 : instr.target;
+}
+
+size_t JumpUnlessIntCompare(Frame& frame, const Instr& instr, size_t pc) {
+  return CompareInts(instr.op, frame.ints[instr.a], frame.ints[instr.b]) ? pc + 1 : instr.target;
+}
+
+size_t Jump(Frame&, const Instr& instr, size_t) {
+  return instr.target;
+}
+
+size_t CallMethod(Frame& frame, const Instr& instr, size_t pc) {
+  // The arguments are in consecutive registers, the callee reads them there
+  Runtime::Arguments actual_args(frame.objects + instr.b, instr.imm);
+  auto object = frame.objects[instr.a].TryAs<Runtime::ClassInstance>();
+  frame.objects[instr.dst] = object->Call(*instr.name, actual_args);
+  return pc + 1;
+}
+
+// A self call of the compiled method in tail position restarts the code
+// with a new closure, unless the class of self overrides the method
+size_t TailCall(Frame& frame, const Instr& instr, size_t) {
+  Runtime::Arguments actual_args(frame.objects + instr.b, instr.imm);
+  auto object = frame.objects[instr.a].TryAs<Runtime::ClassInstance>();
+  if (object->GetClass().GetMethod(*instr.name) != instr.method) {
+    frame.result = object->Call(*instr.name, actual_args);
+    return kHalt;
+  }
+
+  Runtime::Closure& closure = frame.closure;
+  closure.clear();
+  closure.emplace("self", frame.objects[instr.a]);
+  for (size_t i = 0; i < actual_args.size(); ++i) {
+    closure.emplace(instr.method->formal_params[i], actual_args[i]);
+  }
+  ++stats.tail_calls;
+  return 0;
+}
+
+size_t Return(Frame& frame, const Instr& instr, size_t) {
+  frame.result = frame.objects[instr.a];
+  return kHalt;
+}
+
+class Compiler {
+public:
+  explicit Compiler(const Runtime::Method& method) : method(method) {
+  }
+
+  shared_ptr<const Code> Compile(Ast::Statement& body) {
+    if (dynamic_cast<Ast::Compound*>(&body) || dynamic_cast<Ast::Return*>(&body)) {
+      CompileStatement(body);
+    } else {
+      // A body which is a single node returns the value of that node
+      Instr instr{Return};
+      instr.a = ToObject(CompileExpression(body));
+      Emit(instr);
+    }
+    return move(code);
+  }
+
+private:
+  struct Operand {
+    bool is_int;
+    int reg;
+  };
+
+  const Runtime::Method& method;
+  shared_ptr<Code> code = make_shared<Code>();
+
+  size_t Emit(const Instr& instr) {
+    code->instructions.push_back(instr);
+    return code->instructions.size() - 1;
+  }
+
+  void PatchTarget(size_t jump) {
+    code->instructions[jump].target = code->instructions.size();
+  }
+
+  int NewObjectRegister() {
+    return code->object_registers++;
+  }
+
+  int NewIntRegister() {
+    return code->int_registers++;
+  }
+
+  int ToObject(Operand operand) {
+    if (!operand.is_int) {
+      return operand.reg;
+    }
+    Instr instr{Box};
+    instr.dst = NewObjectRegister();
+    instr.a = operand.reg;
+    Emit(instr);
+    return instr.dst;
+  }
+
+  int ToInt(Operand operand) {
+    if (operand.is_int) {
+      return operand.reg;
+    }
+    Instr instr{Unbox};
+    instr.dst = NewIntRegister();
+    instr.a = operand.reg;
+    Emit(instr);
+    return instr.dst;
+  }
+
+  void CompileStatement(Ast::Statement& statement) {
+    if (auto compound = dynamic_cast<Ast::Compound*>(&statement)) {
+      for (const auto& stmt : compound->GetStatements()) {
+        CompileStatement(*stmt);
+      }
+    } else if (auto if_else = dynamic_cast<Ast::IfElse*>(&statement)) {
+      size_t jump_to_else = CompileBranch(*if_else->GetCondition());
+      CompileStatement(*if_else->GetIfBody());
+      if (auto else_body = if_else->GetElseBody()) {
+        size_t jump_to_end = Emit(Instr{Jump});
+        PatchTarget(jump_to_else);
+        CompileStatement(*else_body);
+        PatchTarget(jump_to_end);
+      } else {
+        PatchTarget(jump_to_else);
+      }
+    } else if (auto ret = dynamic_cast<Ast::Return*>(&statement)) {
+      Ast::MethodCall* call = ret->GetSelfCall();
+      if (call && call->method == method.name && call->args.size() == method.formal_params.size() && !method.memo) {
+        CompileTailCall(*call);
+        return;
+      }
+      Instr instr{Return};
+      instr.a = ToObject(CompileExpression(*ret->GetStatement()));
+      Emit(instr);
+    } else if (auto assignment = dynamic_cast<Ast::Assignment*>(&statement)) {
+      Instr instr{StoreVariable};
+      instr.a = ToObject(CompileExpression(*assignment->right_value));
+      instr.name = &assignment->var_name;
+      Emit(instr);
+    } else if (dynamic_cast<Ast::MethodCall*>(&statement)) {
+      CompileExpression(statement);
+    } else {
+      Instr instr{ExecuteNode};
+      instr.node = &statement;
+      Emit(instr);
+    }
+  }
+
+  // Moves the arguments to consecutive registers, the instruction gets the
+  // receiver and the arguments
+  Instr CompileCall(Ast::MethodCall& call, Stencil stencil) {
+    int first_arg = code->object_registers;
+    code->object_registers += call.args.size();
+    for (size_t i = 0; i < call.args.size(); ++i) {
+      Instr instr{Move, first_arg + static_cast<int>(i)};
+      instr.a = ToObject(CompileExpression(*call.args[i]));
+      Emit(instr);
+    }
+    Instr instr{stencil};
+    instr.a = ToObject(CompileExpression(*call.object));
+    instr.b = first_arg;
+    instr.imm = call.args.size();
+    instr.name = &call.method;
+    return instr;
+  }
+
+  void CompileTailCall(Ast::MethodCall& call) {
+    Instr instr = CompileCall(call, TailCall);
+    instr.method = &method;
+    Emit(instr);
+  }
+
+  // Returns the jump to be patched with the target taken when condition is false
+  size_t CompileBranch(Ast::Statement& condition) {
+    if (auto comparison = dynamic_cast<Ast::Comparison*>(&condition)) {
+      Operand lhs = CompileExpression(*comparison->GetLeft());
+      Operand rhs = CompileExpression(*comparison->GetRight());
+      CompareOp op = comparison->GetKind();
+      if (lhs.is_int && rhs.is_int && op != CompareOp::Custom) {
+        Instr instr{JumpUnlessIntCompare, 0, lhs.reg, rhs.reg};
+        instr.op = op;
+        return Emit(instr);
+      }
+      Instr instr{JumpUnlessCompare, 0, ToObject(lhs), ToObject(rhs)};
+      instr.op = op;
+      instr.comparator = &comparison->GetComparator();
+      return Emit(instr);
+    }
+
+    Instr instr{JumpUnlessTrue};
+    instr.a = ToObject(CompileExpression(condition));
+    return Emit(instr);
+  }
+
+  Operand CompileArithmetic(Stencil stencil, Ast::BinaryOperation& operation) {
+    int lhs = ToInt(CompileExpression(*operation.GetLhs()));
+    int rhs = ToInt(CompileExpression(*operation.GetRhs()));
+    Instr instr{stencil, NewIntRegister(), lhs, rhs};
+    Emit(instr);
+    return {true, instr.dst};
+  }
+
+  Operand CompileExpression(Ast::Statement& expression) {
+    if (auto number = dynamic_cast<Ast::NumericConst*>(&expression)) {
+      Instr instr{LoadInt, NewIntRegister()};
+      instr.imm = number->value.GetValue();
+      Emit(instr);
+      return {true, instr.dst};
+    } else if (auto str = dynamic_cast<Ast::StringConst*>(&expression)) {
+      Instr instr{LoadObject, NewObjectRegister()};
+      instr.object = &str->value;
+      Emit(instr);
+      return {false, instr.dst};
+    } else if (auto boolean = dynamic_cast<Ast::BoolConst*>(&expression)) {
+      Instr instr{LoadObject, NewObjectRegister()};
+      instr.object = &boolean->value;
+      Emit(instr);
+      return {false, instr.dst};
+    } else if (dynamic_cast<Ast::None*>(&expression)) {
+      Instr instr{LoadNone, NewObjectRegister()};
+      Emit(instr);
+      return {false, instr.dst};
+    } else if (auto variable = dynamic_cast<Ast::VariableValue*>(&expression);
+               variable && variable->dotted_ids.size() == 1) {
+      Instr instr{LoadVariable, NewObjectRegister()};
+      instr.name = &variable->dotted_ids.front();
+      Emit(instr);
+      return {false, instr.dst};
+    } else if (auto add = dynamic_cast<Ast::Add*>(&expression)) {
+      Operand lhs = CompileExpression(*add->GetLhs());
+      Operand rhs = CompileExpression(*add->GetRhs());
+      if (lhs.is_int && rhs.is_int) {
+        Instr instr{IntAdd, NewIntRegister(), lhs.reg, rhs.reg};
+        Emit(instr);
+        return {true, instr.dst};
+      }
+      Instr instr{AddObjects, 0, ToObject(lhs), ToObject(rhs)};
+      instr.dst = NewObjectRegister();
+      Emit(instr);
+      return {false, instr.dst};
+    } else if (auto sub = dynamic_cast<Ast::Sub*>(&expression)) {
+      return CompileArithmetic(IntSub, *sub);
+    } else if (auto mult = dynamic_cast<Ast::Mult*>(&expression)) {
+      return CompileArithmetic(IntMult, *mult);
+    } else if (auto div = dynamic_cast<Ast::Div*>(&expression)) {
+      return CompileArithmetic(IntDiv, *div);
+    } else if (auto comparison = dynamic_cast<Ast::Comparison*>(&expression)) {
+      Operand lhs = CompileExpression(*comparison->GetLeft());
+      Operand rhs = CompileExpression(*comparison->GetRight());
+      CompareOp op = comparison->GetKind();
+      if (lhs.is_int && rhs.is_int && op != CompareOp::Custom) {
+        Instr instr{IntCompare, NewObjectRegister(), lhs.reg, rhs.reg};
+        instr.op = op;
+        Emit(instr);
+        return {false, instr.dst};
+      }
+      Instr instr{Compare, 0, ToObject(lhs), ToObject(rhs)};
+      instr.dst = NewObjectRegister();
+      instr.op = op;
+      instr.comparator = &comparison->GetComparator();
+      Emit(instr);
+      return {false, instr.dst};
+    } else if (auto call = dynamic_cast<Ast::MethodCall*>(&expression)) {
+      Instr instr = CompileCall(*call, CallMethod);
+      instr.dst = NewObjectRegister();
+      Emit(instr);
+      return {false, instr.dst};
+    }
+
+    Instr instr{EvaluateNode, NewObjectRegister()};
+    instr.node = &expression;
+    Emit(instr);
+    return {false, instr.dst};
+  }
+};
+
+} /* namespace */
+
+void SetEnabled(bool value) {
+  enabled = value;
+}
+
+bool IsEnabled() {
+  return enabled;
+}
+
+void SetThreshold(size_t call_count) {
+  threshold = call_count;
+}
+
+size_t GetThreshold() {
+  return threshold;
+}
+
+shared_ptr<const Code> Compile(const Runtime::Method& method) {
+  ++stats.compiled_methods;
+  return Compiler(method).Compile(*method.body);
+}
+
+ObjectHolder Execute(const Code& code, Runtime::Closure& closure) {
+  ++stats.compiled_calls;
+
+  // Registers come from stacks of the thread rather than the heap
+  Runtime::ArgumentFrame objects(code.object_registers);
+  Runtime::IntFrame ints(code.int_registers);
+  Frame frame{closure, code.object_registers ? &objects[0] : nullptr, ints.Get(), {}};
+  const auto& instructions = code.instructions;
+  for (size_t pc = 0; pc < instructions.size(); ) {
+    const Instr& instr = instructions[pc];
+    pc = instr.stencil(frame, instr, pc);
+  }
+  return frame.result;
+}
+
+const Stats& GetStats() {
+  return stats;
+}
+
+void ResetStats() {
+  stats = {};
+}
+
+} /* namespace Jit */
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "object_holder.h"
+
+#include <cstddef>
+#include <memory>
+
+class TestRunner;
+
+namespace Runtime {
+  struct Method;
+}
+
+namespace Jit {
+
+// Baseline JIT for method bodies. A hot method is translated once into a flat
+// array of instructions, each one a precompiled stencil (a plain C++ function)
+// with its operands (registers, jump targets, constants, AST nodes) patched in
+// at compile time. Execution walks the array without virtual dispatch over the
+// tree; integer subexpressions stay unboxed in registers, returns don't throw.
+// No machine code is emitted: the code is call-threaded, one indirect call
+// per instruction, which keeps it portable and needs no executable memory.
+//
+// Every type-specialized stencil guards its operands and deoptimizes to the
+// interpreter semantics of the same node when the guard fails. Nodes the
+// compiler doesn't know are executed by the interpreter as is.
+class Code;
+
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// The number of interpreted calls of a method before it is compiled
+void SetThreshold(size_t call_count);
+size_t GetThreshold();
+
+std::shared_ptr<const Code> Compile(const Runtime::Method& method);
+ObjectHolder Execute(const Code& code, Runtime::Closure& closure);
+
+struct Stats {
+  size_t compiled_methods = 0;
+  size_t compiled_calls = 0;
+  size_t deoptimizations = 0;
+  size_t tail_calls = 0;
+};
+
+// Counted per thread
+const Stats& GetStats();
+void ResetStats();
+
+void RunJitTests(TestRunner& tr);
+
+} /* namespace Jit */
@@ -0,0 +1,239 @@
+#include "jit.h"
+#include "trace.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace Jit {
+
+// Runs the program with every method compiled on its first call, or with
+// the interpreter only
+void RunProgram(const string& program, bool jit, ostream& output) {
+  struct Settings {
+    bool was_enabled = IsEnabled();
+    size_t old_threshold = GetThreshold();
+    bool was_tracing = Trace::IsEnabled();
+
+    ~Settings() {
+      SetEnabled(was_enabled);
+      SetThreshold(old_threshold);
+      Trace::SetEnabled(was_tracing);
+    }
+  } settings;
+  Trace::SetEnabled(false);
+  SetEnabled(jit);
+  SetThreshold(0);
+
+  istringstream input(program);
+  Ast::Print::SetOutputStream(output);
+
+  Parse::Lexer lexer(input);
+  auto tree = ParseProgram(lexer);
+  Runtime::Closure closure;
+  tree->Execute(closure);
+}
+
+string RunProgram(const string& program, bool jit) {
+  ostringstream output;
+  RunProgram(program, jit, output);
+  return output.str();
+}
+
+void AssertSameOutput(const string& program, const string& expected) {
+  ASSERT_EQUAL(RunProgram(program, false), expected);
+  ASSERT_EQUAL(RunProgram(program, true), expected);
+}
+
+void TestArithmetic() {
+  AssertSameOutput(R"(
+class Calc:
+  def eval(a, b, c, d, e, f):
+    return a * b + c * d - e / f
+
+  def neg(x):
+    y = -x
+    return y + 1
+
+c = Calc()
+print c.eval(2, 3, 4, 5, 12, 4), c.neg(10)
+)", "23 -9\n");
+}
+
+void TestBranchesAndRecursion() {
+  AssertSameOutput(R"(
+class Fib:
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+  def sign(n):
+    if n > 0:
+      return 'positive'
+    else:
+      if n == 0:
+        return 'zero'
+    return 'negative'
+
+f = Fib()
+print f.fib(15), f.sign(3), f.sign(0), f.sign(-3)
+)", "610 positive zero negative\n");
+}
+
+void TestDeoptimizationOnTypeMismatch() {
+  const string program = R"(
+class Join:
+  def join(a, b):
+    return a + b
+
+  def less(a, b):
+    return a < b
+
+j = Join()
+print j.join(1, 2), j.join('a', 'b'), j.less(1, 2), j.less('b', 'a')
+)";
+
+  ResetStats();
+  AssertSameOutput(program, "3 ab True False\n");
+  ASSERT(GetStats().compiled_methods > 0);
+  ASSERT(GetStats().compiled_calls > 0);
+  ASSERT(GetStats().deoptimizations > 0);
+}
+
+void TestOperandsWhichAreNotNumbers() {
+  const string program = R"(
+class Calc:
+  def sub(a, b):
+    return a - b
+
+  def noisy():
+    print 'evaluated'
+    return 1
+
+c = Calc()
+print c.sub(5, 2)
+print c.sub(c.noisy(), 'x')
+)";
+
+  // The error is the interpreter's, and the operands are evaluated once
+  for (bool jit : {false, true}) {
+    ResetStats();
+    ostringstream output;
+    string message;
+    try {
+      RunProgram(program, jit, output);
+    } catch (const runtime_error& e) {
+      message = e.what();
+    }
+    ASSERT_EQUAL(output.str(), "3\nevaluated\n");
+    ASSERT_EQUAL(message, "Not number");
+    ASSERT_EQUAL(GetStats().deoptimizations, 0u);
+    ASSERT_EQUAL(GetStats().compiled_calls > 0, jit);
+  }
+}
+
+void TestInstancesAndFields() {
+  AssertSameOutput(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(delta):
+    self.value = self.value + delta
+    return self
+
+  def __str__():
+    return 'Counter(' + str(self.value) + ')'
+
+class Pair:
+  def __init__(a, b):
+    self.a = a
+    self.b = b
+
+  def __add__(other):
+    return self.a * other.b + self.b * other.a
+
+c = Counter()
+c.add(3)
+c.add(4)
+print c, Pair(1, 2) + Pair(3, 4)
+)", "Counter(7) 10\n");
+}
+
+void TestThreshold() {
+  bool was_enabled = IsEnabled();
+  size_t old_threshold = GetThreshold();
+  bool was_tracing = Trace::IsEnabled();
+  Trace::SetEnabled(false);
+  ResetStats();
+  SetEnabled(true);
+  SetThreshold(3);
+
+  istringstream input(R"(
+class Id:
+  def id(x):
+    return x
+
+i = Id()
+i.id(1)
+i.id(2)
+i.id(3)
+i.id(4)
+)");
+  Parse::Lexer lexer(input);
+  auto tree = ParseProgram(lexer);
+  Runtime::Closure closure;
+  tree->Execute(closure);
+
+  SetEnabled(was_enabled);
+  SetThreshold(old_threshold);
+  Trace::SetEnabled(was_tracing);
+
+  ASSERT_EQUAL(GetStats().compiled_methods, 1u);
+  ASSERT_EQUAL(GetStats().compiled_calls, 1u);
+}
+
+void TestTailCalls() {
+  ResetStats();
+  AssertSameOutput(R"(
+class Walker:
+  def count(n, acc):
+    if n == 0:
+      return acc
+    return self.count(n - 1, acc + 1)
+
+  def walk(n, other):
+    if n == 0:
+      return 'walker'
+    self = other
+    return self.walk(n - 1, other)
+
+class Runner(Walker):
+  def walk(n, other):
+    return 'runner ' + str(n)
+
+w = Walker()
+print w.count(1000000, 0), w.walk(3, Runner()), w.walk(2, Walker())
+)", "1000000 runner 2 walker\n");
+  ASSERT(GetStats().tail_calls >= 1000000);
+}
+
+void RunJitTests(TestRunner& tr) {
+  RUN_TEST(tr, Jit::TestArithmetic);
+  RUN_TEST(tr, Jit::TestBranchesAndRecursion);
+  RUN_TEST(tr, Jit::TestDeoptimizationOnTypeMismatch);
+  RUN_TEST(tr, Jit::TestOperandsWhichAreNotNumbers);
+  RUN_TEST(tr, Jit::TestInstancesAndFields);
+  RUN_TEST(tr, Jit::TestThreshold);
+  RUN_TEST(tr, Jit::TestTailCalls);
+}
+
+} /* namespace Jit */
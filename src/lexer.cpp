@@ -1,8 +1,11 @@
 #include "lexer.h"
+#include "scanner.h"
 
 #include <algorithm>
 #include <charconv>
-#include <unordered_map>
+#include <iterator>
+#include <string_view>
+#include <utility>
 
 using namespace std;
 
@@ -70,52 +73,285 @@ std::ostream& operator << (std::ostream& os, const Token& rhs) {
 }
 
 
+namespace {
+
+template <typename T>
+Token MakeToken() {
+  return T{};
+}
+
+struct Keyword {
+  string_view text;
+  Token (*make)();
+};
+
+// Adding a keyword only takes a line here, the hash below adapts to the set
+constexpr Keyword kKeywords[] = {
+  {"class", MakeToken<TokenType::Class>},
+  {"return", MakeToken<TokenType::Return>},
+  {"if", MakeToken<TokenType::If>},
+  {"else", MakeToken<TokenType::Else>},
+  {"def", MakeToken<TokenType::Def>},
+  {"print", MakeToken<TokenType::Print>},
+  {"and", MakeToken<TokenType::And>},
+  {"or", MakeToken<TokenType::Or>},
+  {"not", MakeToken<TokenType::Not>},
+  {"None", MakeToken<TokenType::None>},
+  {"True", MakeToken<TokenType::True>},
+  {"False", MakeToken<TokenType::False>},
+};
+
+constexpr size_t kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+constexpr size_t kKeywordSlots = 32;
+
+constexpr size_t KeywordHash(string_view word, size_t seed) {
+  return (word.size() + seed * static_cast<unsigned char>(word.front())
+          + static_cast<unsigned char>(word.back())) % kKeywordSlots;
+}
+
+constexpr bool IsPerfectHash(size_t seed) {
+  bool used[kKeywordSlots] = {};
+  for (const auto& keyword : kKeywords) {
+    auto slot = KeywordHash(keyword.text, seed);
+    if (used[slot]) {
+      return false;
+    }
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr size_t FindKeywordSeed() {
+  for (size_t seed = 1; seed < 1024; ++seed) {
+    if (IsPerfectHash(seed)) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+constexpr size_t kKeywordSeed = FindKeywordSeed();
+static_assert(kKeywordSeed != 0, "The keywords collide for every seed, increase kKeywordSlots");
+
+// Index in kKeywords for every hash value, kKeywordCount for none
+struct KeywordTable {
+  size_t slots[kKeywordSlots];
+};
+
+constexpr KeywordTable BuildKeywordTable() {
+  KeywordTable table{};
+  for (auto& slot : table.slots) {
+    slot = kKeywordCount;
+  }
+  for (size_t i = 0; i < kKeywordCount; ++i) {
+    table.slots[KeywordHash(kKeywords[i].text, kKeywordSeed)] = i;
+  }
+  return table;
+}
+
+constexpr KeywordTable kKeywordTable = BuildKeywordTable();
+
+constexpr const Keyword* FindKeyword(string_view word) {
+  auto index = kKeywordTable.slots[KeywordHash(word, kKeywordSeed)];
+  if (index == kKeywordCount || kKeywords[index].text != word) {
+    return nullptr;
+  }
+  return &kKeywords[index];
+}
+
+static_assert(FindKeyword("class") == &kKeywords[0]);
+static_assert(FindKeyword("False") == &kKeywords[kKeywordCount - 1]);
+static_assert(FindKeyword("Class") == nullptr);
+
+} /* namespace */
+
+namespace {
+
+template <size_t... Kinds>
+Token MakeUnvaluedToken(uint8_t kind, index_sequence<Kinds...>) {
+  static constexpr Token (*make[])() = {
+    +[]() { return Token(in_place_index<Kinds>); }...
+  };
+  return make[kind]();
+}
+
+} /* namespace */
+
+TokenStream::TokenStream(istream& input) {
+  Lexer lexer(input);
+  while (true) {
+    Append(lexer.CurrentToken(), lexer.CurrentLineNumber());
+    if (lexer.CurrentToken().Is<TokenType::Eof>()) {
+      break;
+    }
+    lexer.NextToken();
+  }
+}
+
+void TokenStream::Append(const Token& token, int line) {
+  using namespace TokenType;
+
+  int32_t payload = 0;
+  if (auto number = token.TryAs<Number>()) {
+    payload = number->value;
+  } else if (auto c = token.TryAs<Char>()) {
+    payload = c->value;
+  } else if (auto id = token.TryAs<Id>()) {
+    payload = AddText(id->value);
+  } else if (auto str = token.TryAs<String>()) {
+    payload = AddText(str->value);
+  }
+  kinds.push_back(static_cast<uint8_t>(token.index()));
+  payloads.push_back(payload);
+  lines.push_back(line);
+}
+
+void TokenStream::AppendRange(const TokenStream& other, size_t begin, size_t end, int line) {
+  kinds.insert(kinds.end(), other.kinds.begin() + begin, other.kinds.begin() + end);
+  lines.insert(lines.end(), end - begin, line);
+  for (size_t position = begin; position < end; ++position) {
+    const auto kind = other.kinds[position];
+    if (kind == kTokenKind<TokenType::Id> || kind == kTokenKind<TokenType::String>) {
+      payloads.push_back(AddText(other.Text(position)));
+    } else {
+      payloads.push_back(other.payloads[position]);
+    }
+  }
+}
+
+void TokenStream::Reserve(size_t tokens, size_t text_size) {
+  kinds.reserve(tokens);
+  payloads.reserve(tokens);
+  lines.reserve(tokens);
+  text_data.reserve(text_size);
+}
+
+int32_t TokenStream::AddText(string_view text) {
+  text_data += text;
+  text_offsets.push_back(static_cast<uint32_t>(text_data.size()));
+  return static_cast<int32_t>(text_offsets.size() - 2);
+}
+
+Token TokenStream::At(size_t position) const {
+  using namespace TokenType;
+
+  switch (kinds[position]) {
+  case kTokenKind<Number>:
+    return Number{payloads[position]};
+  case kTokenKind<Char>:
+    return Char{static_cast<char>(payloads[position])};
+  case kTokenKind<Id>:
+    return Id{string(Text(position))};
+  case kTokenKind<String>:
+    return String{string(Text(position))};
+  default:
+    return MakeUnvaluedToken(kinds[position], make_index_sequence<variant_size_v<TokenBase>>());
+  }
+}
+
+size_t TokenStream::SkipBlock(size_t position) const {
+  int depth = 0;
+  for (; position < kinds.size(); ++position) {
+    if (kinds[position] == kTokenKind<TokenType::Indent>) {
+      ++depth;
+    } else if (kinds[position] == kTokenKind<TokenType::Dedent>) {
+      if (--depth == 0) {
+        return position + 1;
+      }
+    } else if (kinds[position] == kTokenKind<TokenType::Eof>) {
+      break;
+    }
+  }
+  return kinds.size();
+}
+
 const int IndentedReader::Eof = std::istream::traits_type::eof();
 
-IndentedReader::IndentedReader(istream& is) : input(is), line_number(0) {
+IndentedReader::IndentedReader(istream& is)
+  : input(&is)
+  , position(source.data())
+  , line_end(position)
+  , next_line(position)
+  , line_number(0)
+  , current_indent(0)
+  , exhausted(false)
+{
+  NextLine();
+}
+
+IndentedReader::IndentedReader(string source)
+  : source(std::move(source))
+  , position(this->source.data())
+  , line_end(position)
+  , next_line(position)
+  , line_number(0)
+  , current_indent(0)
+  , exhausted(false)
+{
   NextLine();
 }
 
 int IndentedReader::Next() {
-  if (!input) {
+  if (exhausted) {
     return Eof;
   }
-  char c;
-  if (current_line_input >> c) {
-    return c;
+  position = Scan::SkipSpaces(position, line_end);
+  if (position != line_end) {
+    return *position++;
   } else {
     return '\n';
   }
 }
 
 int IndentedReader::Get() {
-  if (!input) {
+  if (exhausted) {
     return Eof;
   }
-  if (int c = current_line_input.get(); c != Eof) {
-    return c;
+  if (position != line_end) {
+    return static_cast<unsigned char>(*position++);
   } else {
     return '\n';
   }
 }
 
-void IndentedReader::NextLine() {
-  auto is_space = [](char c) { return isspace(c); };
+bool IndentedReader::ReadLine(const char*& line_begin) {
+  if (input) {
+    // The buffer holds only the current line, read as the lexer reaches it
+    if (!getline(*input, source)) {
+      return false;
+    }
+    line_begin = source.data();
+    line_end = line_begin + source.size();
+    next_line = line_end;
+    return true;
+  }
 
-  for (string line; getline(input, line); ) {
+  const char* source_end = source.data() + source.size();
+  if (next_line == source_end) {
+    return false;
+  }
+  line_begin = next_line;
+  line_end = Scan::FindLineEnd(line_begin, source_end);
+  next_line = line_end == source_end ? line_end : line_end + 1;
+  return true;
+}
+
+void IndentedReader::NextLine() {
+  const char* line_begin;
+  while (ReadLine(line_begin)) {
     ++line_number;
-    auto it = find_if_not(begin(line), end(line), is_space);
-    if (it != end(line)) {
-      auto leading_spaces = it - begin(line);
+    position = Scan::SkipSpaces(line_begin, line_end);
+    if (position != line_end) {
+      auto leading_spaces = position - line_begin;
       if (leading_spaces % 2 == 1) {
-        throw LexerError("Odd number of spaces at the beginning of line " + line);
+        throw LexerError("Odd number of spaces at the beginning of line " + string(line_begin, line_end));
       }
       current_indent = leading_spaces / 2;
-      current_line_input = istringstream(string(it, end(line)));
       return;
     }
   }
   // When input is exhausted we must set current_indent to zero to produce enough Dedent tokens
+  exhausted = true;
   current_indent = 0;
 }
 
@@ -127,33 +363,74 @@ Lexer::Lexer(std::istream& input)
 {
 }
 
+Lexer::Lexer(string source)
+  : char_reader(std::move(source))
+  , cur_char(char_reader.Get())
+  , indent(0)
+  , current(NextTokenImpl())
+{
+}
+
+Lexer::Lexer(shared_ptr<const TokenStream> stream)
+  : Lexer(stream, 0, stream->Size())
+{
+}
+
+Lexer::Lexer(shared_ptr<const TokenStream> stream, size_t begin, size_t end)
+  : stream(std::move(stream))
+  , stream_position(begin)
+  , stream_end(end)
+  , char_reader(string())
+  , cur_char(IndentedReader::Eof)
+  , indent(0)
+  , current(TokenType::Eof{})
+{
+  Advance();
+}
+
+int Lexer::CurrentLineNumber() const {
+  if (!stream) {
+    return char_reader.CurrentLineNumber();
+  }
+  // Past the end it's the line of the last token
+  auto position = min(stream_position, stream_end);
+  if (position == 0 || stream->Size() == 0) {
+    return 0;
+  }
+  return stream->Line(position - 1);
+}
+
+void Lexer::Seek(size_t position) {
+  stream_position = position;
+  Advance();
+}
+
 const Token& Lexer::CurrentToken() const {
+  if (!has_current) {
+    current = AtStreamEnd() ? Token(TokenType::Eof{}) : stream->At(stream_position - 1);
+    has_current = true;
+  }
   return current;
 }
 
-Token Lexer::NextToken() {
-  current = NextTokenImpl();
-  return current;
+const Token& Lexer::NextToken() {
+  Advance();
+  return CurrentToken();
+}
+
+void Lexer::Advance() {
+  if (stream) {
+    // Stays right past the end, where the current token is Eof
+    stream_position = min(stream_position, stream_end) + 1;
+    has_current = false;
+  } else {
+    current = NextTokenImpl();
+  }
 }
 
 Token Lexer::NextTokenImpl() {
   using namespace TokenType;
 
-  static const unordered_map<string, Token> keywords = {
-    {"class", Class{}},
-    {"return", Return{}},
-    {"if", If{}},
-    {"else", Else{}},
-    {"def", Def{}},
-    {"print", Print{}},
-    {"and", And{}},
-    {"or", Or{}},
-    {"not", Not{}},
-    {"None", None{}},
-    {"True", True{}},
-    {"False", False{}},
-  };
-
   if (indent > char_reader.CurrentIndent()) {
     --indent;
     return Dedent{};
@@ -175,36 +452,44 @@ Token Lexer::NextTokenImpl() {
   if (cur_char == IndentedReader::Eof) {
     return Eof{};
   } else if (isdigit(cur_char)) {
-    int value = 0;
-    while (isdigit(cur_char)) {
-      value = value * 10 + (cur_char - '0');
-      cur_char = char_reader.Get();
+    auto rest = char_reader.RestOfLine();
+    auto digits = rest.substr(0, Scan::SkipDigits(rest.data(), rest.data() + rest.size()) - rest.data());
+    int value = cur_char - '0';
+    for (char c : digits) {
+      value = value * 10 + (c - '0');
     }
+    char_reader.Skip(digits.size());
+    cur_char = char_reader.Get();
     return Number{value};
   } else if (cur_char == '"' || cur_char == '\'') {
-    auto opener = cur_char;
-    bool previous_backslash = false;
-    string value;
-    while (((cur_char = char_reader.Get()) != opener || previous_backslash) && cur_char != '\n') {
-      value += cur_char;
-      previous_backslash = (cur_char == '\\');
+    auto opener = static_cast<char>(cur_char);
+    auto rest = char_reader.RestOfLine();
+    const char* rest_end = rest.data() + rest.size();
+    // A quote preceded by a backslash doesn't close the string
+    const char* quote = rest.data();
+    while ((quote = Scan::FindQuoteOrLineEnd(quote, rest_end, opener)) != rest_end
+           && quote != rest.data() && quote[-1] == '\\') {
+      ++quote;
     }
-    if (cur_char != opener) {
+    string value(rest.data(), quote);
+    if (quote == rest_end) {
       throw LexerError("String " + value + " has unbalanced quotes");
     }
+    char_reader.Skip(value.size() + 1);
     cur_char = char_reader.Next();
     return String{std::move(value)};
   } else if (isalpha(cur_char) || cur_char == '_') {
-    string value;
-    do {
-      value += cur_char;
-      cur_char = char_reader.Get();
-    } while (isalnum(cur_char) || cur_char == '_');
-
-    if (auto it = keywords.find(value); it != keywords.end()) {
-      return it->second;
+    auto rest = char_reader.RestOfLine();
+    auto tail = Scan::SkipIdentifier(rest.data(), rest.data() + rest.size()) - rest.data();
+    // cur_char is the character right before the rest of the line
+    const string_view word(rest.data() - 1, tail + 1);
+    char_reader.Skip(tail);
+    cur_char = char_reader.Get();
+
+    if (auto keyword = FindKeyword(word)) {
+      return keyword->make();
     } else {
-      return Id{std::move(value)};
+      return Id{string(word)};
     }
   } else if (cur_char == '=') {
     cur_char = char_reader.Get();
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <variant>
 #include <stdexcept>
 #include <optional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 class TestRunner;
 
@@ -113,11 +118,15 @@ public:
   using std::runtime_error::runtime_error;
 };
 
+// Keeps the source in a contiguous buffer, which Parse::Scan runs over. A
+// stream is read a line at a time as the lexer reaches it, and the buffer
+// holds only that line.
 class IndentedReader {
 public:
   static const int Eof;
 
   explicit IndentedReader(std::istream& input);
+  explicit IndentedReader(std::string source);
 
   int CurrentIndent() const {
     return current_indent;
@@ -130,62 +139,245 @@ public:
   int Next();
   int Get();
 
+  // The characters of the current line which Get hasn't returned yet
+  std::string_view RestOfLine() const {
+    return {position, static_cast<size_t>(line_end - position)};
+  }
+
+  void Skip(size_t count) {
+    position += count;
+  }
+
   void NextLine();
 
 private:
-  std::istream& input;
+  // Finds the line after next_line, false at the end of the source
+  bool ReadLine(const char*& line_begin);
+
+  std::istream* input = nullptr;
+  std::string source;
+  const char* position;
+  const char* line_end;
+  const char* next_line;
   int line_number;
-  std::istringstream current_line_input;
   int current_indent;
+  bool exhausted;
 };
 
+// Index of the token type T in TokenBase
+template <typename T, typename... Types>
+constexpr uint8_t TokenKindOf(const std::variant<Types...>*) {
+  constexpr bool matches[] = {std::is_same_v<T, Types>...};
+  uint8_t kind = 0;
+  while (!matches[kind]) {
+    ++kind;
+  }
+  return kind;
+}
+
+template <typename T>
+inline constexpr uint8_t kTokenKind = TokenKindOf<T>(static_cast<const TokenBase*>(nullptr));
+
+// Tokens as parallel arrays: the kind, the value of a Number or Char or the
+// index of an Id or String text in a side table, and the line. The texts are
+// stored back to back in one buffer. Used to lex a whole program before
+// parsing it and to keep method bodies for lazy parsing.
+class TokenStream {
+public:
+  TokenStream() = default;
+
+  // Tokenizes the whole input, the last token is Eof
+  explicit TokenStream(std::istream& input);
+
+  void Append(const Token& token, int line);
+
+  // Appends the tokens [begin, end) of the other stream, all on the line
+  void AppendRange(const TokenStream& other, size_t begin, size_t end, int line);
+
+  void Reserve(size_t tokens, size_t text_size);
+
+  size_t Size() const {
+    return kinds.size();
+  }
+
+  uint8_t Kind(size_t position) const {
+    return kinds[position];
+  }
+
+  template <typename T>
+  bool Is(size_t position) const {
+    return kinds[position] == kTokenKind<T>;
+  }
+
+  int Line(size_t position) const {
+    return lines[position];
+  }
+
+  Token At(size_t position) const;
+
+  // The value of a Number or Char
+  int32_t Value(size_t position) const {
+    return payloads[position];
+  }
+
+  // The value of an Id or String
+  std::string_view Text(size_t position) const {
+    auto index = payloads[position];
+    return std::string_view(text_data).substr(text_offsets[index], text_offsets[index + 1] - text_offsets[index]);
+  }
+
+  // The position right after the Dedent closing the Indent at position, or
+  // Size() if the stream ends first
+  size_t SkipBlock(size_t position) const;
+
+private:
+  int32_t AddText(std::string_view text);
+
+  std::vector<uint8_t> kinds;
+  std::vector<int32_t> payloads;
+  std::vector<int32_t> lines;
+  std::string text_data;
+  std::vector<uint32_t> text_offsets{0};
+};
+
+// Over a stream, the current token is only built by CurrentToken and
+// NextToken. The parser tests the kind with Is and reads the value with
+// Value, which are answered by the arrays of the stream.
 class Lexer {
 public:
+  // Reads the input line by line while lexing
   explicit Lexer(std::istream& input);
+  explicit Lexer(std::string source);
+
+  // Runs over the tokens [begin, end) of the stream, followed by Eof
+  explicit Lexer(std::shared_ptr<const TokenStream> stream);
+  Lexer(std::shared_ptr<const TokenStream> stream, size_t begin, size_t end);
 
   const Token& CurrentToken() const;
-  Token NextToken();
+  const Token& NextToken();
+
+  // Moves to the next token without building it
+  void Advance();
+
+  template <typename T>
+  bool Is() const {
+    if (!stream) {
+      return current.Is<T>();
+    } else if (AtStreamEnd()) {
+      return std::is_same_v<T, TokenType::Eof>;
+    }
+    return stream->Is<T>(stream_position - 1);
+  }
+
+  // The value of the current token, which is a T. The text of an Id or a
+  // String is a view valid until the next token.
+  template <typename T>
+  auto Value() const {
+    constexpr bool is_text = std::is_same_v<T, TokenType::Id> || std::is_same_v<T, TokenType::String>;
+    using Result = std::conditional_t<is_text, std::string_view, decltype(T::value)>;
+    if (!stream) {
+      return Result(current.As<T>().value);
+    } else if constexpr (is_text) {
+      return stream->Text(stream_position - 1);
+    } else {
+      return static_cast<Result>(stream->Value(stream_position - 1));
+    }
+  }
+
+  bool IsChar(char c) const {
+    return Is<TokenType::Char>() && Value<TokenType::Char>() == c;
+  }
+
+  int CurrentLineNumber() const;
+
+  // The stream the lexer runs over, if any, and the position of the current
+  // token in it
+  const std::shared_ptr<const TokenStream>& Stream() const {
+    return stream;
+  }
+
+  size_t StreamPosition() const {
+    return stream_position - 1;
+  }
+
+  // Continues from the token at the position of the stream
+  void Seek(size_t position);
 
   template <typename T>
   const T& Expect() const {
-    if (!current.Is<T>()) {
-      std::ostringstream msg;
-      msg << "Expect token " << T() << " but got " << current << " at line "
-          << char_reader.CurrentLineNumber();
-      throw LexerError(msg.str());
+    Check<T>();
+    if constexpr (std::is_empty_v<T>) {
+      // Keywords and marks carry nothing to build a token for
+      static const T tag;
+      return tag;
+    } else {
+      return CurrentToken().As<T>();
     }
-    return current.As<T>();
+  }
+
+  // Expect without building the token, returns Value
+  template <typename T>
+  auto ExpectValue() const {
+    Check<T>();
+    return Value<T>();
   }
 
   template <typename T, typename U>
   void Expect(const U& value) const {
-    if (auto& token_value = Expect<T>().value; token_value != value) {
+    if (auto token_value = ExpectValue<T>(); token_value != value) {
       std::ostringstream msg;
       msg << "Expect token with value " << value << " but found " << token_value << " at line "
-          << char_reader.CurrentLineNumber();
+          << CurrentLineNumber();
       throw LexerError(msg.str());
     }
   }
 
   template <typename T>
   const T& ExpectNext() {
-    NextToken();
+    Advance();
     return Expect<T>();
   }
 
+  template <typename T>
+  auto ExpectNextValue() {
+    Advance();
+    return ExpectValue<T>();
+  }
+
   template <typename T, typename U>
   void ExpectNext(const U& value) {
-    NextToken();
+    Advance();
     Expect<T>(value);
   }
 
 private:
   Token NextTokenImpl();
 
+  // Past the tokens of the stream, the current token is Eof
+  bool AtStreamEnd() const {
+    return stream_position > stream_end;
+  }
+
+  template <typename T>
+  void Check() const {
+    if (!Is<T>()) {
+      std::ostringstream msg;
+      msg << "Expect token " << T() << " but got " << CurrentToken() << " at line "
+          << CurrentLineNumber();
+      throw LexerError(msg.str());
+    }
+  }
+
+  std::shared_ptr<const TokenStream> stream;
+  size_t stream_position = 0;
+  size_t stream_end = 0;
+
   IndentedReader char_reader;
   int cur_char;
   int indent;
-  Token current;
+  // Over a stream, built on demand
+  mutable Token current;
+  mutable bool has_current = true;
 };
 
 void RunLexerTests(TestRunner& test_runner);
@@ -0,0 +1,120 @@
+// Lexer throughput microbenchmark.
+//
+// lexer_bench [<program.my>] [--size=<MB>] [--runs=<count>] [--threads=<n>]
+//
+// Tokenizes the program, or a generated one of about --size megabytes, --runs
+// times and reports the best throughput. With --threads the program is
+// tokenized into a Parse::TokenStream by Parse::LexParallel, 0 means all
+// cores. Build it with the lexer sources:
+// g++ -std=c++17 -O2 -pthread [-mavx2] lexer_bench.cpp lexer.cpp scanner.cpp parallel_lexer.cpp
+
+#include "lexer.h"
+#include "parallel_lexer.h"
+#include "scanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Classes with methods of assignments, arithmetic, calls and string literals
+string GenerateProgram(size_t size) {
+  ostringstream out;
+  for (size_t i = 0; static_cast<size_t>(out.tellp()) < size; ++i) {
+    out << "class Generated" << i << ":\n"
+        << "  def __init__(self, first_value, second_value):\n"
+        << "    self.first_value = first_value\n"
+        << "    self.second_value = second_value + " << i << "\n"
+        << "\n"
+        << "  def describe(self, prefix):\n"
+        << "    if self.first_value >= self.second_value and not prefix == None:\n"
+        << "      return prefix + ' first value is larger than the second one'\n"
+        << "    else:\n"
+        << "      return \"second value \\\"wins\\\" in class Generated" << i << "\"\n"
+        << "\n"
+        << "x" << i << " = Generated" << i << "(" << i * 7 << ", 1234567)\n"
+        << "print x" << i << ".describe('value:'), x" << i << ".first_value * 3\n";
+  }
+  return out.str();
+}
+
+size_t CountTokens(const string& source, optional<size_t> threads) {
+  if (threads) {
+    Parse::ParallelLexOptions options;
+    options.threads = *threads;
+    return Parse::LexParallel(source, options).Size();
+  }
+
+  Parse::Lexer lexer(source);
+  size_t count = 1;
+  while (!lexer.CurrentToken().Is<Parse::TokenType::Eof>()) {
+    lexer.NextToken();
+    ++count;
+  }
+  return count;
+}
+
+} /* namespace */
+
+int main(int argc, char** argv) {
+  string path;
+  size_t megabytes = 16;
+  int runs = 5;
+  optional<size_t> threads;
+
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    if (arg.rfind("--size=", 0) == 0) {
+      megabytes = stoul(arg.substr(7));
+    } else if (arg.rfind("--runs=", 0) == 0) {
+      runs = max(stoi(arg.substr(7)), 1);
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      threads = stoul(arg.substr(10));
+    } else if (arg.rfind("--", 0) == 0) {
+      cerr << "Usage: lexer_bench [<program.my>] [--size=<MB>] [--runs=<count>] [--threads=<n>]" << endl;
+      return 2;
+    } else {
+      path = arg;
+    }
+  }
+
+  string source;
+  if (path.empty()) {
+    source = GenerateProgram(megabytes << 20);
+  } else {
+    ifstream input(path, ios::binary);
+    if (!input) {
+      cerr << "lexer_bench: Can't open " << path << endl;
+      return 1;
+    }
+    source.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+  }
+
+  try {
+    double best = 0;
+    size_t tokens = 0;
+    for (int run = 0; run < runs; ++run) {
+      const auto start = chrono::steady_clock::now();
+      tokens = CountTokens(source, threads);
+      const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+      best = run == 0 ? elapsed.count() : min(best, elapsed.count());
+    }
+
+    const double mb = source.size() / double(1 << 20);
+    cout << "scanner:    " << Parse::Scan::Implementation() << '\n'
+         << "threads:    " << (!threads ? "lexer only" : *threads ? to_string(*threads) : "all") << '\n'
+         << "input:      " << mb << " MB, " << tokens << " tokens\n"
+         << "best time:  " << best * 1000 << " ms of " << runs << " runs\n"
+         << "throughput: " << mb / best << " MB/s, " << tokens / best / 1e6 << " Mtokens/s\n";
+  } catch (const exception& e) {
+    cerr << "lexer_bench: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -39,6 +39,18 @@ void TestKeywords() {
   ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::False{}));
 }
 
+void TestKeywordLookalikes() {
+  istringstream input("classes clas cl c ifs i If ret_urn not_ Nonee Tru e nor a_d printx def_ elsE _print");
+  Lexer lexer(input);
+
+  for (auto word : {"classes", "clas", "cl", "c", "ifs", "i", "If", "ret_urn", "not_", "Nonee", "Tru",
+                    "e", "nor", "a_d", "printx", "def_", "elsE", "_print"}) {
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(TokenType::Id{word}));
+    lexer.NextToken();
+  }
+  ASSERT_EQUAL(lexer.CurrentToken(), Token(TokenType::Newline{}));
+}
+
 void TestNumbers() {
   istringstream input("42 15 -53");
   Lexer lexer(input);
@@ -318,9 +330,92 @@ void TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine() {
   }
 }
 
+void TestTokenStream() {
+  const string program = R"(
+x = 4
+y = "hello"
+
+class Point:
+  def __init__(self, x, y):
+    self.x = x
+    self.y = y
+
+  def __str__(self):
+    return str(x) + ' ' + str(y) != None
+
+p = Point(1, 2)
+print str(p)
+)";
+  istringstream input(program);
+  auto stream = make_shared<const TokenStream>(input);
+
+  istringstream lexer_input(program);
+  Lexer lexer(lexer_input);
+  Lexer stream_lexer(stream);
+  for (size_t i = 0; i < stream->Size(); ++i) {
+    ASSERT_EQUAL(stream->At(i), lexer.CurrentToken());
+    ASSERT_EQUAL(stream->Line(i), lexer.CurrentLineNumber());
+    ASSERT_EQUAL(stream_lexer.CurrentToken(), lexer.CurrentToken());
+    ASSERT_EQUAL(stream_lexer.CurrentLineNumber(), lexer.CurrentLineNumber());
+    lexer.NextToken();
+    stream_lexer.NextToken();
+  }
+  ASSERT(stream->Is<TokenType::Eof>(stream->Size() - 1));
+  ASSERT(stream_lexer.CurrentToken().Is<TokenType::Eof>());
+
+  // The body of __init__ from its Newline to the Dedent
+  size_t begin = 0;
+  while (!stream->Is<TokenType::Def>(begin)) {
+    ++begin;
+  }
+  begin += 10;
+  ASSERT(stream->Is<TokenType::Newline>(begin));
+  const size_t end = stream->SkipBlock(begin + 1);
+  ASSERT(stream->Is<TokenType::Dedent>(end - 1));
+  ASSERT(stream->Is<TokenType::Def>(end));
+
+  Lexer body(stream, begin, end);
+  body.ExpectNext<TokenType::Indent>();
+  ASSERT_EQUAL(body.ExpectNext<TokenType::Id>().value, "self");
+  ASSERT_EQUAL(body.CurrentLineNumber(), 7);
+  body.Seek(end - 1);
+  ASSERT(body.CurrentToken().Is<TokenType::Dedent>());
+  ASSERT(body.NextToken().Is<TokenType::Eof>());
+  ASSERT(body.NextToken().Is<TokenType::Eof>());
+  ASSERT_EQUAL(body.CurrentLineNumber(), stream->Line(end - 1));
+}
+
+void TestReadsStreamByLines() {
+  string program;
+  for (int i = 0; program.size() < 300000; ++i) {
+    program += "x" + to_string(i) + " = '" + string(i % 97, 'a') + "' + " + to_string(i) + "\n";
+    if (i == 1000) {
+      program += "y = '" + string(150000, 'b') + "'\n";
+    }
+    if (i % 50 == 0) {
+      program += "if x:\n  z = 1\n\n";
+    }
+  }
+  program += "last";
+
+  istringstream input(program);
+  Lexer stream_lexer(input);
+  ASSERT_EQUAL(input.tellg(), static_cast<streamoff>(program.find('\n') + 1));
+
+  Lexer lexer(program);
+  while (!lexer.CurrentToken().Is<TokenType::Eof>()) {
+    ASSERT_EQUAL(stream_lexer.CurrentToken(), lexer.CurrentToken());
+    ASSERT_EQUAL(stream_lexer.CurrentLineNumber(), lexer.CurrentLineNumber());
+    lexer.NextToken();
+    stream_lexer.NextToken();
+  }
+  ASSERT(stream_lexer.CurrentToken().Is<TokenType::Eof>());
+}
+
 void RunLexerTests(TestRunner& tr) {
   RUN_TEST(tr, Parse::TestSimpleAssignment);
   RUN_TEST(tr, Parse::TestKeywords);
+  RUN_TEST(tr, Parse::TestKeywordLookalikes);
   RUN_TEST(tr, Parse::TestNumbers);
   RUN_TEST(tr, Parse::TestIds);
   RUN_TEST(tr, Parse::TestStrings);
@@ -331,6 +426,8 @@ void RunLexerTests(TestRunner& tr) {
   RUN_TEST(tr, Parse::TestExpectNext);
   RUN_TEST(tr, Parse::TestMythonProgram);
   RUN_TEST(tr, Parse::TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine);
+  RUN_TEST(tr, Parse::TestTokenStream);
+  RUN_TEST(tr, Parse::TestReadsStreamByLines);
 }
 
 } /* namespace Parse */
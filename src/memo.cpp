@@ -0,0 +1,190 @@
+#include "memo.h"
+#include "object.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+using namespace std;
+
+namespace Memo {
+
+namespace {
+
+vector<string> methods;
+size_t capacity = 4096;
+thread_local Stats stats;
+
+size_t Mix(size_t hash, size_t value) {
+  return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+class PurityChecker {
+public:
+  explicit PurityChecker(const Runtime::Class& cls) : cls(cls) {
+  }
+
+  bool IsPure(const Runtime::Method& method) {
+    if (!checked.insert(&method).second) {
+      // Recursive calls are checked by the outer one
+      return true;
+    }
+    if (method.native) {
+      return false;
+    }
+    method.ParseBody();
+    return IsPure(method.body.get());
+  }
+
+private:
+  const Runtime::Class& cls;
+  unordered_set<const Runtime::Method*> checked;
+
+  bool IsPure(const Ast::Statement* statement) {
+    using namespace Ast;
+
+    if (!statement) {
+      return true;
+    } else if (dynamic_cast<const Print*>(statement) || dynamic_cast<const FieldAssignment*>(statement)) {
+      return false;
+    } else if (dynamic_cast<const NewInstance*>(statement)) {
+      // __init__ of the class may assign fields
+      return false;
+    } else if (auto call = dynamic_cast<const MethodCall*>(statement)) {
+      auto receiver = dynamic_cast<const VariableValue*>(call->object.get());
+      if (!receiver || receiver->dotted_ids != vector<string>{"self"}) {
+        return false;
+      }
+      const Runtime::Method* target = cls.GetMethod(call->method);
+      return target && IsPure(*target) && AllPure(call->args);
+    } else if (auto variable = dynamic_cast<const VariableValue*>(statement)) {
+      // Fields may change between calls with the same key
+      return variable->dotted_ids.size() == 1;
+    } else if (auto assignment = dynamic_cast<const Assignment*>(statement)) {
+      return IsPure(assignment->right_value.get());
+    } else if (auto unary = dynamic_cast<const UnaryOperation*>(statement)) {
+      return IsPure(unary->GetArgument());
+    } else if (auto binary = dynamic_cast<const BinaryOperation*>(statement)) {
+      return IsPure(binary->GetLhs()) && IsPure(binary->GetRhs());
+    } else if (auto comparison = dynamic_cast<const Comparison*>(statement)) {
+      return IsPure(comparison->GetLeft()) && IsPure(comparison->GetRight());
+    } else if (auto compound = dynamic_cast<const Compound*>(statement)) {
+      return AllPure(compound->GetStatements());
+    } else if (auto ret = dynamic_cast<const Return*>(statement)) {
+      return IsPure(ret->GetStatement());
+    } else if (auto if_else = dynamic_cast<const IfElse*>(statement)) {
+      return IsPure(if_else->GetCondition()) && IsPure(if_else->GetIfBody()) && IsPure(if_else->GetElseBody());
+    }
+    // Constants
+    return true;
+  }
+
+  bool AllPure(const vector<unique_ptr<Ast::Statement>>& statements) {
+    return all_of(begin(statements), end(statements), [this](const auto& statement) {
+      return IsPure(statement.get());
+    });
+  }
+};
+
+bool IsCacheable(const ObjectHolder& object) {
+  return !object || object.TryAs<Runtime::Number>() || object.TryAs<Runtime::String>() || object.TryAs<Runtime::Bool>();
+}
+
+} /* namespace */
+
+void SetMethods(vector<string> names) {
+  methods = move(names);
+}
+
+void SetCapacity(size_t entries) {
+  capacity = max<size_t>(entries, 1);
+}
+
+bool IsPure(const Runtime::Class& cls, const Runtime::Method& method) {
+  return PurityChecker(cls).IsPure(method);
+}
+
+optional<Table::Key> Table::MakeKey(
+  const Runtime::ClassInstance& self, const Runtime::Method& method, Runtime::Arguments args
+) {
+  const Runtime::Class* cls = &self.GetClass();
+  auto verdict = find_if(begin(purity), end(purity), [cls](const auto& entry) {
+    return entry.first == cls;
+  });
+  if (verdict == end(purity)) {
+    bool pure = IsPure(*cls, method);
+    if (!pure) {
+      ++stats.rejected_methods;
+    }
+    verdict = purity.emplace(end(purity), cls, pure);
+  }
+  if (!verdict->second) {
+    return nullopt;
+  }
+
+  Key key{self.GetIdentity(), {}, hash<uint64_t>{}(self.GetIdentity())};
+  key.args.reserve(args.size());
+  for (const ObjectHolder& arg : args) {
+    if (!arg) {
+      key.args.emplace_back();
+    } else if (auto number = arg.TryAs<Runtime::Number>()) {
+      key.args.emplace_back(in_place_type<int>, number->GetValue());
+    } else if (auto boolean = arg.TryAs<Runtime::Bool>()) {
+      key.args.emplace_back(in_place_type<bool>, boolean->GetValue());
+    } else if (auto str = arg.TryAs<Runtime::String>()) {
+      key.args.emplace_back(in_place_type<string>, str->GetValue());
+    } else {
+      ++stats.uncached;
+      return nullopt;
+    }
+    key.hash = Mix(key.hash, hash<Value>{}(key.args.back()));
+  }
+  return key;
+}
+
+const ObjectHolder* Table::Find(const Key& key) {
+  if (!entries.empty()) {
+    const auto& entry = entries[key.hash % entries.size()];
+    if (entry && entry->key.receiver == key.receiver && entry->key.args == key.args) {
+      ++stats.hits;
+      return &entry->result;
+    }
+  }
+  ++stats.misses;
+  return nullptr;
+}
+
+void Table::Insert(Key key, const ObjectHolder& result) {
+  if (!IsCacheable(result)) {
+    ++stats.uncached;
+    return;
+  }
+  if (entries.empty()) {
+    entries.resize(capacity);
+  }
+  auto& entry = entries[key.hash % entries.size()];
+  if (entry) {
+    ++stats.evictions;
+  }
+  entry = Entry{move(key), result};
+}
+
+shared_ptr<Table> TableFor(const string& class_name, const string& method_name) {
+  for (const string& name : methods) {
+    if (name == method_name || name == class_name + "." + method_name) {
+      return make_shared<Table>();
+    }
+  }
+  return nullptr;
+}
+
+const Stats& GetStats() {
+  return stats;
+}
+
+void ResetStats() {
+  stats = {};
+}
+
+} /* namespace Memo */
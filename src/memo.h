@@ -0,0 +1,96 @@
+#pragma once
+
+#include "object_holder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+  class Arguments;
+  class Class;
+  class ClassInstance;
+  struct Method;
+}
+
+namespace Memo {
+
+// Memoization of pure methods. The results of the configured methods are
+// kept in a bounded table per method, keyed on the receiver and the values
+// of the arguments. Only calls whose arguments are all numbers, strings,
+// booleans or None are cached, and only results of those types.
+//
+// A configured method is memoized for a class of receivers once it passes
+// IsPure on its first call with such a receiver, otherwise it's rejected for
+// that class and always executed. The special methods called by operators
+// aren't checked.
+
+// Names of the memoized methods, "Class.method" for a method defined in the
+// class or "method" for the methods of that name in all classes. Applies to
+// the classes defined afterwards.
+void SetMethods(std::vector<std::string> names);
+
+// Entries of the table of a method, a new entry replaces the one with the
+// same slot
+void SetCapacity(size_t entries);
+
+// A method neither prints nor reads or assigns fields, and the methods it
+// calls are methods of self which are pure too. Fields are rejected because
+// the key doesn't include them, so a result would outlive a change of them.
+bool IsPure(const Runtime::Class& cls, const Runtime::Method& method);
+
+class Table {
+public:
+  // The value of an argument
+  using Value = std::variant<std::monostate, int, bool, std::string>;
+
+  struct Key {
+    uint64_t receiver;
+    std::vector<Value> args;
+    size_t hash;
+  };
+
+  // No key if the method isn't pure or an argument can't be a part of it
+  std::optional<Key> MakeKey(const Runtime::ClassInstance& self, const Runtime::Method& method, Runtime::Arguments args);
+
+  const ObjectHolder* Find(const Key& key);
+  void Insert(Key key, const ObjectHolder& result);
+
+private:
+  struct Entry {
+    Key key;
+    ObjectHolder result;
+  };
+
+  // Whether the method is pure for a class of receivers. The methods of self
+  // it calls depend on the class, as a subclass may override them.
+  std::vector<std::pair<const Runtime::Class*, bool>> purity;
+  std::vector<std::optional<Entry>> entries;
+};
+
+// The table for a method defined in the class, if the method is memoized
+std::shared_ptr<Table> TableFor(const std::string& class_name, const std::string& method_name);
+
+struct Stats {
+  size_t hits = 0;
+  size_t misses = 0;
+  // Calls with an argument or a result which can't be cached
+  size_t uncached = 0;
+  size_t evictions = 0;
+  size_t rejected_methods = 0;
+};
+
+// Counted per thread
+const Stats& GetStats();
+void ResetStats();
+
+void RunMemoTests(TestRunner& tr);
+
+} /* namespace Memo */
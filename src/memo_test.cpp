@@ -0,0 +1,208 @@
+#include "memo.h"
+#include "lexer.h"
+#include "object.h"
+#include "parse.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Memo {
+
+string RunProgram(const string& program, vector<string> memoized, size_t capacity = 4096) {
+  SetMethods(move(memoized));
+  SetCapacity(capacity);
+  ResetStats();
+
+  istringstream input(program);
+  ostringstream output;
+  Ast::Print::SetOutputStream(output);
+
+  Parse::Lexer lexer(input);
+  auto tree = ParseProgram(lexer);
+  Runtime::Closure closure;
+  tree->Execute(closure);
+
+  SetMethods({});
+  SetCapacity(4096);
+  return output.str();
+}
+
+const string kFib = R"(
+class Fib:
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+f = Fib()
+g = Fib()
+print f.fib(30), g.fib(10)
+)";
+
+void TestPurity() {
+  istringstream input(R"(
+class Other:
+  def get():
+    return 1
+
+class Shape:
+  def area(w, h):
+    s = w * h
+    if s < 0:
+      return 0 - s
+    return s
+  def twice(w):
+    return self.area(w, 2) + self.area(w, 2)
+  def show(w):
+    print self.area(w, 1)
+  def remember(w):
+    self.w = w
+  def indirect(w):
+    return self.remember(w)
+  def other(o):
+    return o.get()
+  def create():
+    return Other()
+  def recursive(n):
+    if n > 0:
+      return self.recursive(n - 1)
+    return n
+  def width():
+    return self.w
+  def scaled(k):
+    return self.width() * k
+)");
+  Parse::Lexer lexer(input);
+  auto tree = ParseProgram(lexer);
+  const auto& definitions = dynamic_cast<Ast::Compound&>(*tree).GetStatements();
+  const auto& shape = dynamic_cast<Ast::ClassDefinition&>(*definitions.at(1)).GetClass();
+  auto is_pure = [&shape](const string& name) {
+    return IsPure(shape, *shape.GetMethod(name));
+  };
+  ASSERT(is_pure("area"));
+  ASSERT(is_pure("twice"));
+  ASSERT(is_pure("recursive"));
+  ASSERT(!is_pure("show"));
+  ASSERT(!is_pure("remember"));
+  ASSERT(!is_pure("indirect"));
+  ASSERT(!is_pure("other"));
+  ASSERT(!is_pure("create"));
+  ASSERT(!is_pure("width"));
+  ASSERT(!is_pure("scaled"));
+}
+
+void TestMemoizedCalls() {
+  ASSERT_EQUAL(RunProgram(kFib, {}), "832040 55\n");
+  ASSERT_EQUAL(GetStats().hits + GetStats().misses, 0u);
+
+  ASSERT_EQUAL(RunProgram(kFib, {"Fib.fib"}), "832040 55\n");
+  // Each receiver computes every value once
+  ASSERT_EQUAL(GetStats().misses, 31u + 11u);
+  ASSERT_EQUAL(GetStats().hits, 28u + 8u);
+  ASSERT_EQUAL(GetStats().evictions, 0u);
+
+  ASSERT_EQUAL(RunProgram(kFib, {"fib"}), "832040 55\n");
+  ASSERT_EQUAL(GetStats().misses, 31u + 11u);
+
+  ASSERT_EQUAL(RunProgram(kFib, {"Other.fib"}), "832040 55\n");
+  ASSERT_EQUAL(GetStats().hits + GetStats().misses, 0u);
+}
+
+void TestBoundedTable() {
+  ASSERT_EQUAL(RunProgram(kFib, {"fib"}, 1), "832040 55\n");
+  ASSERT(GetStats().evictions > 0);
+  ASSERT(GetStats().misses > 31u + 11u);
+}
+
+void TestImpureAndUncachedCalls() {
+  const string program = R"(
+class Point:
+  def __init__(x):
+    self.x = x
+
+class Log:
+  def log(n):
+    print n
+    return n
+  def x(p):
+    return p.x
+  def second(p, n):
+    return n
+  def same(s):
+    return s
+
+l = Log()
+l.log(1)
+l.log(1)
+p = Point(5)
+print l.x(p), l.x(p), l.second(p, 2), l.second(p, 2), l.same('a'), l.same('a'), l.same(None), l.same(True)
+)";
+  ASSERT_EQUAL(RunProgram(program, {"log", "same", "second", "x"}), "1\n1\n5 5 2 2 a a None True\n");
+  ASSERT_EQUAL(GetStats().rejected_methods, 2u);
+  ASSERT_EQUAL(GetStats().uncached, 2u);
+  ASSERT_EQUAL(GetStats().hits, 1u);
+  ASSERT_EQUAL(GetStats().misses, 3u);
+}
+
+void TestGetterAfterSetter() {
+  const string program = R"(
+class Box:
+  def __init__(v):
+    self.v = v
+  def get():
+    return self.v
+  def set(v):
+    self.v = v
+
+b = Box(1)
+print b.get()
+b.set(2)
+print b.get()
+)";
+  ASSERT_EQUAL(RunProgram(program, {"get"}), "1\n2\n");
+  ASSERT_EQUAL(GetStats().rejected_methods, 1u);
+  ASSERT_EQUAL(GetStats().hits, 0u);
+}
+
+void TestPurityPerReceiverClass() {
+  const string program = R"(
+class Base:
+  def value():
+    return 1
+  def twice():
+    return self.value() * 2
+
+class Logged(Base):
+  def value():
+    print 'value'
+    return 2
+
+b = Base()
+l = Logged()
+print b.twice(), b.twice()
+print l.twice()
+print l.twice()
+print b.twice()
+)";
+  ASSERT_EQUAL(RunProgram(program, {"twice"}), "2 2\nvalue\n4\nvalue\n4\n2\n");
+  // Logged overrides value with an impure method, Base doesn't
+  ASSERT_EQUAL(GetStats().rejected_methods, 1u);
+  ASSERT_EQUAL(GetStats().hits, 2u);
+  ASSERT_EQUAL(GetStats().misses, 1u);
+}
+
+void RunMemoTests(TestRunner& tr) {
+  RUN_TEST(tr, Memo::TestPurity);
+  RUN_TEST(tr, Memo::TestMemoizedCalls);
+  RUN_TEST(tr, Memo::TestBoundedTable);
+  RUN_TEST(tr, Memo::TestImpureAndUncachedCalls);
+  RUN_TEST(tr, Memo::TestGetterAfterSetter);
+  RUN_TEST(tr, Memo::TestPurityPerReceiverClass);
+}
+
+} /* namespace Memo */
@@ -0,0 +1,206 @@
+#include "metrics.h"
+#include "allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Metrics {
+
+namespace {
+
+struct Counters {
+  // Distinguishes the thread in ClassCounters, assigned on first use
+  uint64_t thread = 0;
+  size_t strings = 0;
+  size_t closures = 0;
+  size_t calls = 0;
+  size_t returns = 0;
+  size_t depth = 0;
+  size_t max_depth = 0;
+  size_t failed_programs = 0;
+};
+
+thread_local Counters counters;
+atomic<uint64_t> threads{0};
+
+// Instances refer to their counters, which stay in place until the thread
+// exits. Instances destroyed after that aren't counted.
+thread_local bool classes_destroyed = false;
+
+struct Classes {
+  unordered_map<string, Instances> instances;
+
+  ~Classes() {
+    classes_destroyed = true;
+  }
+};
+
+Classes& GetClasses() {
+  static thread_local Classes classes;
+  return classes;
+}
+
+void WriteString(ostream& out, string_view value) {
+  out << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+void WriteMetric(ostream& out, const char* name, const char* type, const char* help, size_t value) {
+  out << "# HELP mython_" << name << ' ' << help << '\n'
+      << "# TYPE mython_" << name << ' ' << type << '\n'
+      << "mython_" << name << ' ' << value << '\n';
+}
+
+void WriteClassMetric(
+  ostream& out, const Stats& stats, const char* name, const char* type, const char* help,
+  size_t Instances::*value
+) {
+  out << "# HELP mython_" << name << ' ' << help << '\n'
+      << "# TYPE mython_" << name << ' ' << type << '\n';
+  for (const auto& [class_name, instances] : stats.instances) {
+    out << "mython_" << name << "{class=";
+    WriteString(out, class_name);
+    out << "} " << instances.*value << '\n';
+  }
+}
+
+} /* namespace */
+
+Instances* InstanceCreated(const string& class_name, ClassCounters& class_counters) {
+  if (classes_destroyed) {
+    return nullptr;
+  }
+  if (!counters.thread) {
+    counters.thread = ++threads;
+  }
+  if (class_counters.thread != counters.thread) {
+    class_counters.instances = &GetClasses().instances[class_name];
+    class_counters.thread = counters.thread;
+  }
+  Instances& instances = *class_counters.instances;
+  ++instances.created;
+  ++instances.live;
+  return &instances;
+}
+
+void InstanceDestroyed(Instances* instances) {
+  if (instances && !classes_destroyed) {
+    ++instances->destroyed;
+    --instances->live;
+  }
+}
+
+void StringCreated() {
+  ++counters.strings;
+}
+
+void ClosureCreated() {
+  ++counters.closures;
+}
+
+void CallEntered() {
+  ++counters.calls;
+  counters.max_depth = max(counters.max_depth, ++counters.depth);
+}
+
+void CallLeft(bool returned) {
+  --counters.depth;
+  if (returned) {
+    ++counters.returns;
+  }
+}
+
+void CallsInlined(size_t calls, size_t depth) {
+  counters.calls += calls;
+  counters.returns += calls;
+  counters.max_depth = max(counters.max_depth, counters.depth + depth);
+}
+
+void CallFrame::Cancel() {
+  cancelled = true;
+  --counters.calls;
+  --counters.depth;
+}
+
+void ProgramFailed() {
+  ++counters.failed_programs;
+}
+
+Stats GetStats() {
+  Stats stats;
+  if (!classes_destroyed) {
+    for (const auto& [name, instances] : GetClasses().instances) {
+      stats.instances.emplace(name, instances);
+    }
+  }
+  stats.strings = counters.strings;
+  stats.closures = counters.closures;
+  stats.calls = counters.calls;
+  stats.returns = counters.returns;
+  stats.max_depth = counters.max_depth;
+  stats.failed_programs = counters.failed_programs;
+  stats.heap_bytes = Runtime::SlabCount() * Runtime::kSlabSize;
+  return stats;
+}
+
+void ResetStats() {
+  if (!classes_destroyed) {
+    for (auto& [name, instances] : GetClasses().instances) {
+      instances.created = 0;
+      instances.destroyed = 0;
+    }
+  }
+  const Counters kept = counters;
+  counters = {};
+  counters.thread = kept.thread;
+  counters.depth = kept.depth;
+  counters.max_depth = kept.depth;
+}
+
+void WriteJson(const Stats& stats, ostream& out) {
+  out << "{\n  \"instances\": {";
+  bool first = true;
+  for (const auto& [name, instances] : stats.instances) {
+    out << (first ? "\n    " : ",\n    ");
+    first = false;
+    WriteString(out, name);
+    out << ": {\"created\": " << instances.created
+        << ", \"destroyed\": " << instances.destroyed
+        << ", \"live\": " << instances.live << '}';
+  }
+  out << (stats.instances.empty() ? "},\n" : "\n  },\n")
+      << "  \"strings\": " << stats.strings << ",\n"
+      << "  \"closures\": " << stats.closures << ",\n"
+      << "  \"calls\": " << stats.calls << ",\n"
+      << "  \"returns\": " << stats.returns << ",\n"
+      << "  \"max_depth\": " << stats.max_depth << ",\n"
+      << "  \"failed_programs\": " << stats.failed_programs << ",\n"
+      << "  \"heap_bytes\": " << stats.heap_bytes << "\n"
+      << "}\n";
+}
+
+void WritePrometheus(const Stats& stats, ostream& out) {
+  WriteClassMetric(out, stats, "instances_created_total", "counter", "Instances created per class.", &Instances::created);
+  WriteClassMetric(out, stats, "instances_destroyed_total", "counter", "Instances destroyed per class.", &Instances::destroyed);
+  WriteClassMetric(out, stats, "instances_live", "gauge", "Instances alive per class.", &Instances::live);
+  WriteMetric(out, "strings_total", "counter", "Strings created.", stats.strings);
+  WriteMetric(out, "closures_total", "counter", "Closures created for method calls.", stats.closures);
+  WriteMetric(out, "calls_total", "counter", "Method calls.", stats.calls);
+  WriteMetric(out, "returns_total", "counter", "Method calls which returned.", stats.returns);
+  WriteMetric(out, "call_depth_max", "gauge", "Deepest nesting of method calls.", stats.max_depth);
+  WriteMetric(out, "failed_programs_total", "counter", "Programs which ended with an error.", stats.failed_programs);
+  WriteMetric(out, "heap_bytes", "gauge", "Bytes of the slabs of the allocator.", stats.heap_bytes);
+}
+
+} /* namespace Metrics */
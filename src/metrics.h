@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+class TestRunner;
+
+namespace Metrics {
+
+// Counters of the runtime, always maintained by the objects and calls of
+// the thread. Meant for watching programs in production: instances per
+// class, strings, closures, calls and their depth, and errors.
+
+struct Instances {
+  size_t created = 0;
+  size_t destroyed = 0;
+  // Not reset by ResetStats
+  size_t live = 0;
+};
+
+struct Stats {
+  // Per class name, classes of the same name in different programs are
+  // counted together
+  std::map<std::string, Instances> instances;
+  size_t strings = 0;
+  // Closures of the method calls
+  size_t closures = 0;
+  // Method calls and those which returned rather than threw, including the
+  // calls inlined by traces. Self tail calls reuse the frame of their caller,
+  // inlined accessors and memoized results run no method, they aren't counted.
+  size_t calls = 0;
+  size_t returns = 0;
+  size_t max_depth = 0;
+  // Runs of RunMythonProgram which ended with an error. Errors thrown and
+  // caught inside a program aren't counted.
+  size_t failed_programs = 0;
+  // Slabs of the allocator, for all threads
+  size_t heap_bytes = 0;
+};
+
+// The counters of a class on the thread which last created its instances,
+// kept by the class so that they are looked up by name once
+struct ClassCounters {
+  Instances* instances = nullptr;
+  uint64_t thread = 0;
+};
+
+// Updated by the runtime. An instance must be destroyed by the thread which
+// created it; the counters it refers to belong to the thread.
+Instances* InstanceCreated(const std::string& class_name, ClassCounters& counters);
+void InstanceDestroyed(Instances* instances);
+void StringCreated();
+void ClosureCreated();
+void CallEntered();
+// The call returned unless it's left by an exception
+void CallLeft(bool returned);
+// Calls inlined into a call which returned, nested up to depth below it
+void CallsInlined(size_t calls, size_t depth);
+void ProgramFailed();
+
+// Counts a call while alive
+class CallFrame {
+public:
+  CallFrame() {
+    CallEntered();
+  }
+
+  ~CallFrame() {
+    if (!cancelled) {
+      CallLeft(std::uncaught_exceptions() == exceptions);
+    }
+  }
+
+  CallFrame(const CallFrame&) = delete;
+  CallFrame& operator=(const CallFrame&) = delete;
+
+  // The call didn't happen after all, e.g. a trace exited at a guard
+  void Cancel();
+
+private:
+  int exceptions = std::uncaught_exceptions();
+  bool cancelled = false;
+};
+
+// Counted per thread
+Stats GetStats();
+void ResetStats();
+
+void WriteJson(const Stats& stats, std::ostream& out);
+// Prometheus text exposition format, names prefixed with mython_
+void WritePrometheus(const Stats& stats, std::ostream& out);
+
+void RunMetricsTests(TestRunner& tr);
+
+} /* namespace Metrics */
@@ -0,0 +1,205 @@
+#include "metrics.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "object.h"
+#include "statement.h"
+#include "trace.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace Metrics {
+
+namespace {
+
+string Run(const string& program) {
+  istringstream input(program);
+  ostringstream output;
+  RunMythonProgram(input, output);
+  return output.str();
+}
+
+}
+
+void TestCallsAndInstances() {
+  ResetStats();
+  ASSERT_EQUAL(Run(R"(
+class Node:
+  def __init__(v):
+    self.v = v
+  def depth(n):
+    if n == 0:
+      return 0
+    return 1 + self.depth(n - 1)
+
+class Leaf:
+  def get(k):
+    s = k + 'f'
+    return s
+
+n = Node(1)
+print n.depth(5)
+l = Leaf()
+x = Leaf()
+print l.get('lea')
+)"), "5\nleaf\n");
+
+  const Stats stats = GetStats();
+  ASSERT_EQUAL(stats.calls, 8u);
+  ASSERT_EQUAL(stats.returns, 8u);
+  // Traces run the methods they inline without closures
+  if (Trace::IsEnabled()) {
+    ASSERT(stats.closures <= 8u);
+  } else {
+    ASSERT_EQUAL(stats.closures, 8u);
+  }
+  ASSERT_EQUAL(stats.max_depth, 6u);
+  ASSERT_EQUAL(stats.failed_programs, 0u);
+  // The literals and the sum
+  ASSERT_EQUAL(stats.strings, 3u);
+  ASSERT(stats.heap_bytes > 0);
+
+  ASSERT_EQUAL(stats.instances.at("Node").created, 1u);
+  ASSERT_EQUAL(stats.instances.at("Leaf").created, 2u);
+  // The variables of the program are gone
+  ASSERT_EQUAL(stats.instances.at("Leaf").destroyed, 2u);
+  ASSERT_EQUAL(stats.instances.at("Leaf").live, 0u);
+}
+
+void TestFailedPrograms() {
+  ResetStats();
+  ASSERT_THROWS(Run(R"(
+class Div:
+  def by(n):
+    return 1 / n
+
+d = Div()
+print d.by(1)
+d.by(0)
+)"), runtime_error);
+
+  Stats stats = GetStats();
+  ASSERT_EQUAL(stats.failed_programs, 1u);
+  ASSERT_EQUAL(stats.calls, 2u);
+  ASSERT_EQUAL(stats.returns, 1u);
+  ASSERT_EQUAL(stats.instances.at("Div").live, 0u);
+
+  // The depth is back to 0
+  ResetStats();
+  Run("class A:\n  def f(x):\n    return x + 1\n\na = A()\nprint a.f(1)\n");
+  ASSERT_EQUAL(GetStats().max_depth, 1u);
+}
+
+void TestCallsUnderEveryEngine() {
+  const string program = R"(
+class Shape:
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+  def area():
+    a = self.w * self.h
+    return a
+  def scaled(k):
+    return self.area() * k
+
+class Sum:
+  def of(s, t):
+    return s.scaled(2) + t.scaled(3)
+
+s = Sum()
+a = Shape(1, 2)
+b = Shape(3, 4)
+print s.of(a, b), s.of(b, a), s.of(a, a)
+)";
+
+  const size_t jit_threshold = Jit::GetThreshold();
+  const size_t trace_threshold = Trace::GetThreshold();
+  Jit::SetThreshold(0);
+  Trace::SetThreshold(0);
+  for (const char* engine : {"interpreter", "jit", "trace", "jit+trace"}) {
+    EngineScope scope(engine);
+    ResetStats();
+    ASSERT_EQUAL(Run(program), "40 30 10\n");
+    const Stats stats = GetStats();
+    ASSERT_EQUAL(stats.calls, 17u);
+    ASSERT_EQUAL(stats.returns, 17u);
+    ASSERT_EQUAL(stats.max_depth, 3u);
+  }
+  Jit::SetThreshold(jit_threshold);
+  Trace::SetThreshold(trace_threshold);
+}
+
+void TestLiveInstancesAcrossReset() {
+  Runtime::Class cls("MetricsKept");
+  ObjectHolder instance = ObjectHolder::Make<Runtime::ClassInstance>(cls);
+  ObjectHolder copy = ObjectHolder::Own(Runtime::ClassInstance(*instance.TryAs<Runtime::ClassInstance>()));
+  ResetStats();
+  ASSERT_EQUAL(GetStats().instances.at("MetricsKept").created, 0u);
+  ASSERT_EQUAL(GetStats().instances.at("MetricsKept").live, 2u);
+
+  instance = {};
+  copy = {};
+  ASSERT_EQUAL(GetStats().instances.at("MetricsKept").destroyed, 2u);
+  ASSERT_EQUAL(GetStats().instances.at("MetricsKept").live, 0u);
+}
+
+void TestFormats() {
+  Stats stats;
+  stats.instances["A"] = Instances{3, 1, 2};
+  stats.strings = 4;
+  stats.closures = 5;
+  stats.calls = 6;
+  stats.returns = 5;
+  stats.max_depth = 2;
+  stats.failed_programs = 1;
+  stats.heap_bytes = 65536;
+
+  ostringstream json;
+  WriteJson(stats, json);
+  ASSERT_EQUAL(json.str(),
+    "{\n"
+    "  \"instances\": {\n"
+    "    \"A\": {\"created\": 3, \"destroyed\": 1, \"live\": 2}\n"
+    "  },\n"
+    "  \"strings\": 4,\n"
+    "  \"closures\": 5,\n"
+    "  \"calls\": 6,\n"
+    "  \"returns\": 5,\n"
+    "  \"max_depth\": 2,\n"
+    "  \"failed_programs\": 1,\n"
+    "  \"heap_bytes\": 65536\n"
+    "}\n"
+  );
+
+  ostringstream prometheus;
+  WritePrometheus(stats, prometheus);
+  const string text = prometheus.str();
+  ASSERT(text.find(
+    "# HELP mython_instances_created_total Instances created per class.\n"
+    "# TYPE mython_instances_created_total counter\n"
+    "mython_instances_created_total{class=\"A\"} 3\n"
+  ) == 0);
+  ASSERT(text.find("mython_instances_live{class=\"A\"} 2\n") != string::npos);
+  ASSERT(text.find("# TYPE mython_call_depth_max gauge\nmython_call_depth_max 2\n") != string::npos);
+  ASSERT(text.find("mython_calls_total 6\n") != string::npos);
+  ASSERT(text.find("mython_heap_bytes 65536\n") != string::npos);
+
+  ostringstream empty;
+  WriteJson(Stats{}, empty);
+  ASSERT_EQUAL(empty.str().substr(0, 20), "{\n  \"instances\": {},");
+}
+
+void RunMetricsTests(TestRunner& tr) {
+  RUN_TEST(tr, Metrics::TestCallsAndInstances);
+  RUN_TEST(tr, Metrics::TestFailedPrograms);
+  RUN_TEST(tr, Metrics::TestCallsUnderEveryEngine);
+  RUN_TEST(tr, Metrics::TestLiveInstancesAcrossReset);
+  RUN_TEST(tr, Metrics::TestFormats);
+}
+
+} /* namespace Metrics */
@@ -1,225 +1,239 @@
-#include "object.h"
-#include "object_holder.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "memo.h"
+#include "metrics.h"
+#include "trace.h"
+#include "server.h"
 #include "statement.h"
-#include "lexer.h"
-#include "parse.h"
 
-#include "test_runner.h"
-
-#include <memory>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <thread>
 #include <vector>
-#include <iostream>
-#include <fstream>
-#include <sstream>
 
 using namespace std;
 
-void TestAll();
-
-void RunMythonProgram(istream& input, ostream& output) {
-  Ast::Print::SetOutputStream(output);
-
-  Parse::Lexer lexer(input);
-  auto program = ParseProgram(lexer);
-
-  Runtime::Closure closure;
-  program->Execute(closure);
-}
-
-int main() {
-  TestAll();
-
-  RunMythonProgram(cin, cout);
-
-  return 0;
-}
-
-void TestSimplePrints() {
-  istringstream input(R"(
-print 57
-print 10, 24, -8
-print 'hello'
-print "world"
-print True, False
-print
-print None
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "57\n10 24 -8\nhello\nworld\nTrue False\n\nNone\n");
-}
-
-void TestAssignments() {
-  istringstream input(R"(
-x = 57
-print x
-x = 'C++ black belt'
-print x
-y = False
-x = y
-print x
-x = None
-print x, y
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "57\nC++ black belt\nFalse\nNone False\n");
-}
-
-void TestArithmetics() {
-  istringstream input(
-    "print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2"
-  );
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
-}
-
-void TestVariablesArePointers() {
-  istringstream input(R"(
-class Counter:
-  def __init__():
-    self.value = 0
-
-  def add():
-    self.value = self.value + 1
-
-class Dummy:
-  def do_add(counter):
-    counter.add()
-
-x = Counter()
-y = x
-
-x.add()
-y.add()
-
-print x.value
-
-d = Dummy()
-d.do_add(x)
-
-print y.value
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "2\n3\n");
+namespace {
+
+const char kUsage[] = R"(Usage: mython [options] [<program.my>]
+Runs the program from the file, or from stdin if no file is given.
+
+Engine:
+  --engine=<name>         interpreter (default), jit, trace or jit+trace
+  --jit                   same as --engine=jit
+  --trace                 same as --engine=trace
+  --jit-threshold=<n>     calls of a method before it is compiled, enables the JIT
+  --trace-threshold=<n>   executions of a call site before it is traced, enables tracing
+  --cache-dir=<dir>       keep compiled programs (.myc) in the directory
+  --lazy-methods          parse method bodies on their first call
+  --validate              parse all method bodies at load time, even with --lazy-methods
+  --token-stream          tokenize the whole program before parsing it
+  --lex-threads=<n>       tokenize the program on n threads (0 for all cores), implies --token-stream
+  --parse-threads=<n>     parse top-level classes on n threads (0 for all cores), implies --token-stream
+  --streaming             run each top-level statement as soon as it is parsed
+  --memoize=<names>       cache results of the pure methods, comma-separated Class.method or method
+  --memo-capacity=<n>     cached results per method (default 4096)
+
+Diagnostics:
+  --stats                 print JIT, tracing, memoization and inlining counters to stderr
+  --timings               print the duration of each phase to stderr
+  --metrics[=<format>]    print runtime counters to stderr at exit, as json (default) or prometheus
+  --trace-dump            print recorded traces to stderr
+  --profile[=<file>]      write the executions and time of the nodes per kind and line as JSON to the file or stderr
+
+Daemon:
+  --serve[=<socket>]      serve programs from mython-client (default socket /tmp/mython.sock)
+  --workers=<n>           worker threads of the daemon
+  --help                  print this message
+)";
+
+struct Options {
+  string program_path;
+  RunOptions run;
+  bool stats = false;
+  bool timings = false;
+  bool help = false;
+  // Written to stderr if the path is empty
+  bool profile = false;
+  string profile_path;
+  // json or prometheus, empty unless metrics are printed
+  string metrics;
+
+  // Socket of the daemon, empty unless running as one
+  string serve_socket;
+  size_t serve_workers = thread::hardware_concurrency();
+};
+
+vector<string> SplitNames(string_view names) {
+  vector<string> result;
+  while (!names.empty()) {
+    size_t comma = names.find(',');
+    if (comma != 0) {
+      result.emplace_back(names.substr(0, comma));
+    }
+    names.remove_prefix(comma == string_view::npos ? names.size() : comma + 1);
+  }
+  return result;
 }
 
-void TestInheritance() {
-  istringstream input(R"(
-class Shape:
-  def __str__():
-    return "Shape"
-
-  def area():
-    return 'Not implemented'
-
-class Rect(Shape):
-  def __init__(w, h):
-    self.w = w
-    self.h = h
-
-  def __str__():
-    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
-
-  def area():
-    return self.w * self.h
-
-x = Shape()
-print x, x.area()
-
-x = Rect(1, 2)
-print x, x.area()
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "Shape Not implemented\nRect(1x2) 2\n");
+Options ParseCommandLine(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    string_view arg = argv[i];
+    string_view value;
+    if (arg == "--help" || arg == "-h") {
+      options.help = true;
+    } else if (ParseEngineOption(arg)) {
+      // Applied by ParseEngineOption
+    } else if (arg == "--trace-dump") {
+      Trace::SetDumpStream(&cerr);
+    } else if (HasPrefix(arg, "--cache-dir=", value)) {
+      options.run.cache_dir = value;
+    } else if (arg == "--lazy-methods") {
+      options.run.parse.lazy_methods = true;
+    } else if (arg == "--validate") {
+      options.run.parse.validate = true;
+    } else if (arg == "--token-stream") {
+      options.run.token_stream = true;
+    } else if (HasPrefix(arg, "--lex-threads=", value)) {
+      options.run.token_stream = true;
+      options.run.lex_threads = stoul(string(value));
+    } else if (HasPrefix(arg, "--parse-threads=", value)) {
+      options.run.token_stream = true;
+      options.run.parse.threads = stoul(string(value));
+    } else if (arg == "--streaming") {
+      options.run.streaming = true;
+    } else if (HasPrefix(arg, "--memoize=", value)) {
+      Memo::SetMethods(SplitNames(value));
+    } else if (HasPrefix(arg, "--memo-capacity=", value)) {
+      Memo::SetCapacity(stoul(string(value)));
+    } else if (arg == "--stats") {
+      options.stats = true;
+    } else if (arg == "--timings") {
+      options.timings = true;
+    } else if (arg == "--metrics") {
+      options.metrics = "json";
+    } else if (HasPrefix(arg, "--metrics=", value)) {
+      if (value != "json" && value != "prometheus") {
+        throw invalid_argument("Unknown metrics format " + string(value));
+      }
+      options.metrics = value;
+    } else if (arg == "--profile") {
+      options.profile = true;
+    } else if (HasPrefix(arg, "--profile=", value)) {
+      options.profile = true;
+      options.profile_path = value;
+    } else if (arg == "--serve") {
+      options.serve_socket = Server::kDefaultSocket;
+    } else if (HasPrefix(arg, "--serve=", value)) {
+      options.serve_socket = value;
+    } else if (HasPrefix(arg, "--workers=", value)) {
+      options.serve_workers = stoul(string(value));
+    } else if (arg.substr(0, 1) == "-" || !options.program_path.empty()) {
+      throw invalid_argument("Unknown option " + string(arg));
+    } else {
+      options.program_path = arg;
+    }
+  }
+  return options;
 }
 
-void TestReturn() {
-  istringstream input(R"(
-class Counter:
-  def __init__():
-    self.value = 0
-
-  def add():
-    self.value = self.value + 1
-    return True
-
-x = Counter()
-y = x.add()
-if y:
-  x.add()
-
-print x.value
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "2\n");
+void PrintStats(ostream& out) {
+  const Jit::Stats& jit = Jit::GetStats();
+  const Trace::Stats& trace = Trace::GetStats();
+  const Memo::Stats& memo = Memo::GetStats();
+  const Ast::InlineStats& inlined = Ast::GetInlineStats();
+  const size_t lookups = memo.hits + memo.misses;
+  out << "jit: " << jit.compiled_methods << " methods compiled, "
+      << jit.compiled_calls << " compiled calls, "
+      << jit.deoptimizations << " deoptimizations, "
+      << jit.tail_calls << " tail calls\n"
+      << "trace: " << trace.recorded << " recorded, "
+      << trace.aborted << " aborted, "
+      << trace.hits << " hits, "
+      << trace.side_exits << " side exits\n"
+      << "memo: " << memo.hits << " hits, "
+      << memo.misses << " misses ("
+      << (lookups ? 100 * memo.hits / lookups : 0) << "% hit rate), "
+      << memo.uncached << " uncached calls, "
+      << memo.evictions << " evictions, "
+      << memo.rejected_methods << " impure methods rejected\n"
+      << "inline: " << inlined.sites << " call sites, "
+      << inlined.calls << " calls\n";
 }
 
-void TestFildAssignment() {
-  istringstream input(R"(
-class Base:
-  def set(x):
-    self.x = x
-  def get(x):
-    return self.x
-	
-x = Base()
-x.set(1)
-x.get(2)
-
-print x.get(3), x.x
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "1 1\n");
+int Run(const Options& options) {
+  if (!options.serve_socket.empty()) {
+    Server::Daemon(options.serve_socket, options.serve_workers).Run();
+    return 0;
+  }
+
+  RunOptions run = options.run;
+  ofstream profile;
+  if (options.profile && options.profile_path.empty()) {
+    run.profile = &cerr;
+  } else if (options.profile) {
+    profile.open(options.profile_path);
+    if (!profile) {
+      throw runtime_error("Can't open " + options.profile_path);
+    }
+    run.profile = &profile;
+  }
+
+  PhaseTimings timings;
+  PhaseTimings* timings_ptr = options.timings ? &timings : nullptr;
+  if (options.program_path.empty()) {
+    RunMythonProgram(cin, cout, run, timings_ptr);
+  } else {
+    ifstream input(options.program_path);
+    if (!input) {
+      throw runtime_error("Can't open " + options.program_path);
+    }
+    RunMythonProgram(input, cout, run, timings_ptr);
+  }
+  cout.flush();
+
+  if (options.timings) {
+    PrintTimings(timings, cerr);
+  }
+  if (options.stats) {
+    PrintStats(cerr);
+  }
+  return 0;
 }
 
-void TestComparison() {
-  istringstream input(R"(
-if True == True:
-  print True
-)");
-
-  ostringstream output;
-  RunMythonProgram(input, output);
-
-  ASSERT_EQUAL(output.str(), "True\n");
 }
 
-void TestAll() {
-  TestRunner tr;
-  Runtime::RunObjectHolderTests(tr);
-  Runtime::RunObjectsTests(tr);
-  Ast::RunUnitTests(tr);
-  Parse::RunLexerTests(tr);
-  TestParseProgram(tr);
-
-  RUN_TEST(tr, TestSimplePrints);
-  RUN_TEST(tr, TestAssignments);
-  RUN_TEST(tr, TestArithmetics);
-  RUN_TEST(tr, TestVariablesArePointers);
-  RUN_TEST(tr, TestInheritance);
-  RUN_TEST(tr, TestReturn);
-  RUN_TEST(tr, TestFildAssignment);
-  RUN_TEST(tr, TestComparison);
+int main(int argc, char* argv[]) {
+  Options options;
+  try {
+    options = ParseCommandLine(argc, argv);
+  } catch (const exception& e) {
+    cerr << "mython: " << e.what() << '\n' << kUsage;
+    return 2;
+  }
+
+  if (options.help) {
+    cout << kUsage;
+    return 0;
+  }
+
+  int status = 1;
+  try {
+    status = Run(options);
+  } catch (const exception& e) {
+    cout.flush();
+    cerr << "mython: " << e.what() << endl;
+  }
+
+  if (options.metrics == "json") {
+    Metrics::WriteJson(Metrics::GetStats(), cerr);
+  } else if (options.metrics == "prometheus") {
+    Metrics::WritePrometheus(Metrics::GetStats(), cerr);
+  }
+  return status;
 }
@@ -0,0 +1,50 @@
+#include "server.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// mython-client [--socket=<path>] [<program.my>]
+//
+// Runs the program, read from the file or from stdin, on a daemon started
+// with mython --serve. Only the program is sent, a script has no input to
+// read.
+int main(int argc, char* argv[]) {
+  string socket_path = Server::kDefaultSocket;
+  string input_path;
+
+  for (int i = 1; i < argc; ++i) {
+    string_view arg = argv[i];
+    if (const string_view prefix = "--socket="; arg.substr(0, prefix.size()) == prefix) {
+      socket_path = arg.substr(prefix.size());
+    } else if (input_path.empty()) {
+      input_path = arg;
+    } else {
+      cerr << "Usage: mython-client [--socket=<path>] [<program.my>]" << endl;
+      return 2;
+    }
+  }
+
+  string script;
+  if (input_path.empty()) {
+    script.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+  } else {
+    ifstream input(input_path);
+    if (!input) {
+      cerr << "Can't open " << input_path << endl;
+      return 2;
+    }
+    script.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+  }
+
+  try {
+    return Server::Execute(socket_path, script, cout, cerr) ? 0 : 1;
+  } catch (const Server::ServerError& e) {
+    cerr << e.what() << endl;
+    return 2;
+  }
+}
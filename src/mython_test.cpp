@@ -0,0 +1,441 @@
+#include "allocator.h"
+#include "object.h"
+#include "object_holder.h"
+#include "statement.h"
+#include "lexer.h"
+#include "scanner.h"
+#include "parallel_lexer.h"
+#include "parse.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "trace.h"
+#include "memo.h"
+#include "metrics.h"
+#include "profile.h"
+#include "aot.h"
+#include "cache.h"
+#include "server.h"
+
+#include "test_runner.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void TestSimplePrints() {
+  istringstream input(R"(
+print 57
+print 10, 24, -8
+print 'hello'
+print "world"
+print True, False
+print
+print None
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "57\n10 24 -8\nhello\nworld\nTrue False\n\nNone\n");
+}
+
+void TestAssignments() {
+  istringstream input(R"(
+x = 57
+print x
+x = 'C++ black belt'
+print x
+y = False
+x = y
+print x
+x = None
+print x, y
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "57\nC++ black belt\nFalse\nNone False\n");
+}
+
+void TestArithmetics() {
+  istringstream input(
+    "print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2"
+  );
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
+}
+
+void TestVariablesArePointers() {
+  istringstream input(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add():
+    self.value = self.value + 1
+
+class Dummy:
+  def do_add(counter):
+    counter.add()
+
+x = Counter()
+y = x
+
+x.add()
+y.add()
+
+print x.value
+
+d = Dummy()
+d.do_add(x)
+
+print y.value
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "2\n3\n");
+}
+
+void TestInheritance() {
+  istringstream input(R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+  def area():
+    return 'Not implemented'
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+  def area():
+    return self.w * self.h
+
+x = Shape()
+print x, x.area()
+
+x = Rect(1, 2)
+print x, x.area()
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "Shape Not implemented\nRect(1x2) 2\n");
+}
+
+void TestReturn() {
+  istringstream input(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add():
+    self.value = self.value + 1
+    return True
+
+x = Counter()
+y = x.add()
+if y:
+  x.add()
+
+print x.value
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "2\n");
+}
+
+void TestReturnOutsideMethod() {
+  istringstream input("print 1\nreturn 2\nprint 3\n");
+  ostringstream output;
+  ASSERT_THROWS(RunMythonProgram(input, output), runtime_error);
+  ASSERT_EQUAL(output.str(), "1\n");
+}
+
+void TestAccessorInlining() {
+  istringstream input(R"(
+class Point:
+  def __init__(x):
+    self.x = x
+  def get():
+    return self.x
+  def set(x):
+    self.x = x
+  def kind():
+    return 'point'
+
+class Labeled(Point):
+  def get():
+    return 'label ' + str(self.x)
+
+class Sum:
+  def total(points, n):
+    if n == 0:
+      return 0
+    p = points.get()
+    return p + self.total(points, n - 1)
+  def show(p):
+    print p.kind(), p.get()
+
+p = Point(1)
+p.set(2)
+q = Labeled(3)
+s = Sum()
+s.show(p)
+s.show(q)
+print s.total(p, 3)
+p.set('a')
+s.show(p)
+)");
+  ostringstream output;
+  // The JIT and traces make their own calls
+  EngineScope engine("interpreter");
+  Ast::ResetInlineStats();
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "point 2\npoint label 3\n6\npoint a\n");
+  ASSERT_EQUAL(Ast::GetInlineStats().sites, 5u);
+  ASSERT_EQUAL(Ast::GetInlineStats().calls, 10u);
+
+  istringstream missing("class A:\n  def get():\n    return self.x\n\na = A()\nprint a.get()\n");
+  ASSERT_THROWS(RunMythonProgram(missing, output), runtime_error);
+}
+
+void TestFildAssignment() {
+  istringstream input(R"(
+class Base:
+  def set(x):
+    self.x = x
+  def get(x):
+    return self.x
+	
+x = Base()
+x.set(1)
+x.get(2)
+
+print x.get(3), x.x
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "1 1\n");
+}
+
+void TestComparison() {
+  istringstream input(R"(
+if True == True:
+  print True
+)");
+
+  ostringstream output;
+  RunMythonProgram(input, output);
+
+  ASSERT_EQUAL(output.str(), "True\n");
+}
+
+void TestPhaseTimings() {
+  istringstream input(R"(
+class Sum:
+  def sum(n):
+    if n == 0:
+      return 0
+    return n + self.sum(n - 1)
+
+s = Sum()
+print s.sum(100)
+)");
+
+  ostringstream output;
+  PhaseTimings timings;
+  RunMythonProgram(input, output, {}, &timings);
+
+  ASSERT_EQUAL(output.str(), "5050\n");
+  ASSERT(timings.lex.count() > 0);
+  ASSERT(timings.execute.count() > 0);
+
+  ostringstream report;
+  PrintTimings(timings, report);
+  ASSERT(report.str().find("execute") != string::npos);
+
+  // With a token stream lexing is a phase of its own
+  input.clear();
+  input.seekg(0);
+  RunOptions options;
+  options.token_stream = true;
+  ostringstream stream_output;
+  PhaseTimings stream_timings;
+  RunMythonProgram(input, stream_output, options, &stream_timings);
+  ASSERT_EQUAL(stream_output.str(), "5050\n");
+  ASSERT(stream_timings.lex.count() > 0);
+  ASSERT(stream_timings.parse.count() > 0);
+}
+
+void TestStreamingExecution() {
+  const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+    return self.value
+
+c = Counter()
+print c.add(2)
+print c.add(3)
+)";
+
+  for (bool token_stream : {false, true}) {
+    istringstream input(program);
+    ostringstream output;
+    RunOptions options;
+    options.streaming = true;
+    options.token_stream = token_stream;
+    PhaseTimings timings;
+    RunMythonProgram(input, output, options, &timings);
+    ASSERT_EQUAL(output.str(), "2\n5\n");
+    // Parsing may take no longer than the separate lexing pass
+    ASSERT(timings.lex.count() + timings.parse.count() > 0);
+    ASSERT(timings.execute.count() > 0);
+  }
+
+  // Values of literals outlive the statements which are dropped
+  {
+    istringstream input(R"(
+class Box:
+  def __init__(v):
+    self.v = v
+
+x = 'a string literal long enough to be allocated on the heap'
+y = 5
+z = True
+b = Box('a field from a literal long enough to be allocated')
+b.w = 'another field from a literal, long enough to be allocated'
+print x, y, z
+print b.v, b.w
+)");
+    ostringstream output;
+    RunOptions options;
+    options.streaming = true;
+    RunMythonProgram(input, output, options, nullptr);
+    ASSERT_EQUAL(output.str(),
+      "a string literal long enough to be allocated on the heap 5 True\n"
+      "a field from a literal long enough to be allocated another field from a literal, long enough to be allocated\n"
+    );
+  }
+
+  // The input is read as the statements run, the output of a statement is
+  // there before the line after the next is read
+  {
+    struct LineBuffer : streambuf {
+      vector<string> lines;
+      size_t next = 0;
+      const ostringstream* output = nullptr;
+      vector<string> output_at_read;
+
+      int_type underflow() override {
+        if (next == lines.size()) {
+          return traits_type::eof();
+        }
+        output_at_read.push_back(output->str());
+        string& line = lines[next++];
+        setg(line.data(), line.data(), line.data() + line.size());
+        return traits_type::to_int_type(line[0]);
+      }
+    };
+
+    ostringstream output;
+    LineBuffer buffer;
+    buffer.lines = {"print 'first'\n", "print 'second'\n", "print 'third'\n"};
+    buffer.output = &output;
+    istream input(&buffer);
+    RunOptions options;
+    options.streaming = true;
+    RunMythonProgram(input, output, options, nullptr);
+    ASSERT_EQUAL(output.str(), "first\nsecond\nthird\n");
+    ASSERT_EQUAL(buffer.output_at_read.size(), 3u);
+    ASSERT_EQUAL(buffer.output_at_read[2], "first\n");
+  }
+
+  // Statements before a syntax error have already run
+  istringstream input("print 'first'\nx = \nprint 'second'\n");
+  ostringstream output;
+  RunOptions options;
+  options.streaming = true;
+  try {
+    RunMythonProgram(input, output, options, nullptr);
+    ASSERT(false);
+  } catch (const exception&) {
+  }
+  ASSERT_EQUAL(output.str(), "first\n");
+}
+
+void TestAll() {
+  TestRunner tr;
+  Runtime::RunAllocatorTests(tr);
+  Runtime::RunObjectHolderTests(tr);
+  Runtime::RunObjectsTests(tr);
+  Ast::RunUnitTests(tr);
+  Parse::RunLexerTests(tr);
+  Parse::Scan::RunScannerTests(tr);
+  Parse::RunParallelLexerTests(tr);
+  TestParseProgram(tr);
+  Jit::RunJitTests(tr);
+  Trace::RunTraceTests(tr);
+  Memo::RunMemoTests(tr);
+  Profile::RunProfileTests(tr);
+  Metrics::RunMetricsTests(tr);
+  Aot::RunAotTests(tr);
+  Cache::RunCacheTests(tr);
+  Server::RunServerTests(tr);
+
+  RUN_TEST(tr, TestSimplePrints);
+  RUN_TEST(tr, TestAssignments);
+  RUN_TEST(tr, TestArithmetics);
+  RUN_TEST(tr, TestVariablesArePointers);
+  RUN_TEST(tr, TestInheritance);
+  RUN_TEST(tr, TestReturn);
+  RUN_TEST(tr, TestReturnOutsideMethod);
+  RUN_TEST(tr, TestAccessorInlining);
+  RUN_TEST(tr, TestFildAssignment);
+  RUN_TEST(tr, TestComparison);
+  RUN_TEST(tr, TestPhaseTimings);
+  RUN_TEST(tr, TestStreamingExecution);
+}
+
+// The engine options of mython run the whole suite under that engine, e.g.
+// mython_test --engine=jit --jit-threshold=0
+//
+// Build it with the tests and the sources of mython, without its entry point:
+// g++ -std=c++17 -O2 -pthread -o mython_test *_test.cpp aot.cpp allocator.cpp
+//   cache.cpp client.cpp comparators.cpp interpreter.cpp jit.cpp lexer.cpp
+//   memo.cpp metrics.cpp object.cpp object_holder.cpp parallel_lexer.cpp
+//   parse.cpp profile.cpp scanner.cpp server.cpp statement.cpp trace.cpp
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseEngineOption(argv[i])) {
+      cerr << "Usage: mython_test [--engine=<name>] [--jit-threshold=<n>] [--trace-threshold=<n>]" << endl;
+      return 2;
+    }
+  }
+  TestAll();
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include "aot.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// mythonc <program.my> [-o <output.cpp>]
+//
+// The output is a standalone translation unit, build it together with the
+// runtime sources listed in Aot::kRuntimeSources.
+int main(int argc, char* argv[]) {
+  string input_path;
+  string output_path;
+  for (int i = 1; i < argc; ++i) {
+    string_view arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (input_path.empty()) {
+      input_path = arg;
+    } else {
+      cerr << "Usage: mythonc <program.my> [-o <output.cpp>]" << endl;
+      return 2;
+    }
+  }
+  if (input_path.empty()) {
+    cerr << "Usage: mythonc <program.my> [-o <output.cpp>]" << endl;
+    return 2;
+  }
+
+  ifstream input(input_path);
+  if (!input) {
+    cerr << "Can't open " << input_path << endl;
+    return 1;
+  }
+
+  try {
+    Parse::Lexer lexer(input);
+    auto program = ParseProgram(lexer);
+
+    if (output_path.empty()) {
+      Aot::EmitProgram(*program, cout);
+    } else {
+      ofstream output(output_path);
+      Aot::EmitProgram(*program, output);
+    }
+  } catch (const exception& e) {
+    cerr << input_path << ": " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
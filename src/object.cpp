@@ -1,18 +1,119 @@
 #include "object.h"
 #include "statement.h"
+#include "jit.h"
+#include "memo.h"
+#include "metrics.h"
 
 #include <sstream>
 #include <string_view>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <stack>
+#include <stdexcept>
+#include <mutex>
+#include <unordered_set>
 
 using namespace std;
 
 namespace Runtime {
 
+String::String(string value)
+	: String(string_view(value), nullptr)
+{
+	if (size > kInlineCapacity) {
+		buffer = make_shared<string>(move(value));
+	}
+}
+
+String::String(shared_ptr<string> buffer, size_t size)
+	: buffer(move(buffer))
+	, size(size)
+{
+	Metrics::StringCreated();
+}
+
+String::String(string_view value, const string* interned)
+	: interned(interned)
+	, size(value.size())
+{
+	Metrics::StringCreated();
+	if (!interned && size <= kInlineCapacity) {
+		value.copy(inline_chars, size);
+	}
+}
+
+String String::Intern(string_view value) {
+	static mutex table_mutex;
+	static unordered_set<string> table;
+
+	lock_guard guard(table_mutex);
+	const string& entry = *table.emplace(value).first;
+	String result(entry, &entry);
+	result.Hash();
+	return result;
+}
+
+void String::Print(std::ostream& os) {
+	os << GetValue();
+}
+
+string_view String::GetValue() const {
+	if (interned) {
+		return *interned;
+	} else if (buffer) {
+		return string_view(buffer->data(), size);
+	}
+	return string_view(inline_chars, size);
+}
+
+size_t String::Hash() const {
+	if (!hashed) {
+		hash = std::hash<string_view>{}(GetValue());
+		hashed = true;
+	}
+	return hash;
+}
+
+String String::Concat(const String& left, const String& right) {
+	const string_view tail = right.GetValue();
+
+	// Appended in place only if left ends the buffer and the bytes fit in it,
+	// so that the bytes of the strings sharing the buffer never move or change
+	if (left.buffer && left.size == left.buffer->size() && left.buffer != right.buffer
+			&& left.buffer->capacity() - left.size >= tail.size()) {
+		left.buffer->append(tail);
+		return String(left.buffer, left.buffer->size());
+	}
+
+	if (left.size + tail.size() <= kInlineCapacity || !left.buffer) {
+		string result;
+		result.reserve(left.size + tail.size());
+		result.append(left.GetValue()).append(tail);
+		return String(move(result));
+	}
+
+	// A string which has a buffer and grows is likely to grow again
+	auto buffer = make_shared<string>();
+	buffer->reserve(2 * (left.size + tail.size()));
+	buffer->append(left.GetValue()).append(tail);
+	const size_t size = buffer->size();
+	return String(move(buffer), size);
+}
+
+bool operator==(const String& lhs, const String& rhs) {
+	if (lhs.IsInterned() && rhs.IsInterned()) {
+		return lhs.GetValue().data() == rhs.GetValue().data();
+	}
+	if (lhs.size != rhs.size || (lhs.hashed && rhs.hashed && lhs.hash != rhs.hash)) {
+		return false;
+	}
+	return lhs.GetValue() == rhs.GetValue();
+}
+
 void ClassInstance::Print(std::ostream& os) {
-	if (HasMethod("__str__", 0)) {
-		Call("__str__", {})->Print(os);
+	if (const Method* str = cls.GetSlots().str) {
+		Call(*str, {})->Print(os);
 	} else {
 		os << this;
 	}
@@ -31,32 +132,250 @@ Closure& ClassInstance::Fields() {
 	return fields;
 }
 
-ClassInstance::ClassInstance(const Class& cls) : cls(cls) {
+const Class& ClassInstance::GetClass() const {
+	return cls;
+}
+
+uint64_t ClassInstance::GetIdentity() const {
+	static atomic<uint64_t> last_identity{0};
+	if (!identity) {
+		identity = ++last_identity;
+	}
+	return identity;
+}
+
+void Method::ParseBody() const {
+	if (parse_body) {
+		body = parse_body();
+		parse_body = nullptr;
+	}
+}
+
+namespace {
+
+// Instances may outlive their class, so the recycled fields belong to the
+// thread. Instances destroyed after the pool during thread exit free theirs.
+thread_local bool fields_pool_destroyed = false;
+
+struct FieldsPool {
+	static constexpr size_t kCapacity = 64;
+	vector<Closure> fields;
+
+	~FieldsPool() {
+		fields_pool_destroyed = true;
+	}
+};
+
+FieldsPool* GetFieldsPool() {
+	if (fields_pool_destroyed) {
+		return nullptr;
+	}
+	static thread_local FieldsPool pool;
+	return &pool;
+}
+
+Closure TakeRecycledFields() {
+	FieldsPool* pool = GetFieldsPool();
+	if (!pool || pool->fields.empty()) {
+		return {};
+	}
+	Closure fields = move(pool->fields.back());
+	pool->fields.pop_back();
+	return fields;
+}
+
+}
+
+ClassInstance::ClassInstance(const Class& cls)
+	: cls(cls)
+	, fields(TakeRecycledFields())
+	, instances(Metrics::InstanceCreated(cls.GetName(), cls.GetCounters()))
+{
+}
+
+ClassInstance::ClassInstance(const ClassInstance& other)
+	: Object(other)
+	, cls(other.cls)
+	, fields(other.fields)
+	, instances(Metrics::InstanceCreated(cls.GetName(), cls.GetCounters()))
+{
+}
+
+ClassInstance::~ClassInstance() {
+	Metrics::InstanceDestroyed(instances);
+	// Clearing may destroy other instances, which use the pool too
+	fields.clear();
+	FieldsPool* pool = GetFieldsPool();
+	if (pool && fields.bucket_count() > 1 && pool->fields.size() < FieldsPool::kCapacity) {
+		pool->fields.push_back(move(fields));
+	}
+}
 
+ObjectHolder ClassInstance::Call(const std::string& method, Arguments actual_args) {
+	const Method* mtd = cls.GetMethod(method);
+	if (!mtd) {
+		throw runtime_error("Not found method " + method);
+	}
+	return Call(*mtd, actual_args);
 }
 
-ObjectHolder ClassInstance::Call(const std::string& method, const std::vector<ObjectHolder>& actual_args) {
-  try {
-  	const Method* mtd = cls.GetMethod(method);
-    Closure closure = {{"self", ObjectHolder::Share(*this)}};
+ObjectHolder ClassInstance::Call(const Method& method, Arguments actual_args) {
+	if (method.formal_params.size() != actual_args.size()) {
+		throw runtime_error(
+			"Method " + method.name + " takes " + to_string(method.formal_params.size())
+			+ " arguments, " + to_string(actual_args.size()) + " given"
+		);
+	}
+	if (method.memo) {
+		if (auto key = method.memo->MakeKey(*this, method, actual_args)) {
+			if (const ObjectHolder* result = method.memo->Find(*key)) {
+				return *result;
+			}
+			ObjectHolder result = Execute(method, actual_args);
+			method.memo->Insert(move(*key), result);
+			return result;
+		}
+	}
+	return Execute(method, actual_args);
+}
+
+ObjectHolder ClassInstance::Execute(const Method& method, Arguments actual_args) {
+	Metrics::CallFrame frame;
+
+	if (method.native) {
+		return method.native(*this, actual_args);
+	}
+	method.ParseBody();
+
+	Closure closure = {{"self", ObjectHolder::Share(*this)}};
+	Metrics::ClosureCreated();
+	for (size_t i = 0; i < actual_args.size(); ++i) {
+		closure[method.formal_params[i]] = actual_args[i];
+	}
 
-    for (size_t i = 0; i < actual_args.size(); ++i) {
-      closure[mtd->formal_params[i]] = actual_args[i];
-    }
+	if (Jit::IsEnabled()) {
+		if (!method.jit_code && method.call_count++ >= Jit::GetThreshold()) {
+			method.jit_code = Jit::Compile(method);
+		}
+		if (method.jit_code) {
+			return Jit::Execute(*method.jit_code, closure);
+		}
+	}
 
-    return mtd->body->Execute(closure);
-  } catch (ObjectHolder& returned_value) {
-    return returned_value;
-  }
-  return ObjectHolder::None();
+	return Ast::Return::ExecuteBody(method, closure);
+}
+
+namespace {
+
+// Chunks of slots, a new chunk is used when a frame doesn't fit into the
+// rest of the current one
+template <typename T>
+struct SlotStack {
+	static constexpr size_t kChunkSize = 1024;
+
+	struct Chunk {
+		unique_ptr<T[]> slots;
+		size_t capacity;
+	};
+
+	vector<Chunk> chunks;
+	// Chunks in use, the slots of the last one are used up to top
+	size_t used = 0;
+	size_t top = 0;
+
+	T* Current() const {
+		return used ? chunks[used - 1].slots.get() : nullptr;
+	}
+
+	size_t Capacity() const {
+		return used ? chunks[used - 1].capacity : 0;
+	}
+
+	T* Push(size_t size) {
+		if (top + size > Capacity()) {
+			const size_t capacity = max(size, kChunkSize);
+			if (used == chunks.size()) {
+				chunks.push_back({make_unique<T[]>(capacity), capacity});
+			} else if (chunks[used].capacity < size) {
+				chunks[used] = {make_unique<T[]>(capacity), capacity};
+			}
+			++used;
+			top = 0;
+		}
+		T* slots = Current() + top;
+		top += size;
+		return slots;
+	}
+
+	void Pop(size_t previous_chunks, size_t previous_top) {
+		used = previous_chunks;
+		top = previous_top;
+	}
+};
+
+thread_local SlotStack<ObjectHolder> argument_stack;
+thread_local SlotStack<int> int_stack;
+
+}
+
+ArgumentFrame::ArgumentFrame(size_t size)
+	: size(size), previous_chunks(argument_stack.used), previous_top(argument_stack.top)
+{
+	slots = argument_stack.Push(size);
+}
+
+ArgumentFrame::~ArgumentFrame() {
+	for (size_t i = 0; i < size; ++i) {
+		slots[i] = ObjectHolder();
+	}
+	argument_stack.Pop(previous_chunks, previous_top);
+}
+
+IntFrame::IntFrame(size_t size)
+	: previous_chunks(int_stack.used), previous_top(int_stack.top)
+{
+	slots = int_stack.Push(size);
+}
+
+IntFrame::~IntFrame() {
+	int_stack.Pop(previous_chunks, previous_top);
 }
 
 Class::Class(std::string name, std::vector<Method> methods_, const Class* parent)
 	: name(move(name)), parent(parent)
 {
 	for (auto& method : methods_) {
+		method.memo = Memo::TableFor(this->name, method.name);
 		methods[method.name] = move(method);
 	}
+	ResolveSlots();
+}
+
+Class::Class(std::string name)
+	: name(move(name)), parent(nullptr)
+{
+}
+
+void Class::Define(std::vector<Method> methods_, const Class* parent_) {
+	methods.clear();
+	for (auto& method : methods_) {
+		method.memo = Memo::TableFor(name, method.name);
+		methods[method.name] = move(method);
+	}
+	parent = parent_;
+	ResolveSlots();
+}
+
+void Class::ResolveSlots() {
+	auto find = [this](const string& name, size_t argument_count) -> const Method* {
+		const Method* method = GetMethod(name);
+		return method && method->formal_params.size() == argument_count ? method : nullptr;
+	};
+	slots.str = find("__str__", 0);
+	slots.add = find("__add__", 1);
+	slots.init = GetMethod("__init__");
+	slots.eq = find("__eq__", 1);
+	slots.lt = find("__lt__", 1);
 }
 
 const Method* Class::GetMethod(const std::string& name) const {
@@ -77,6 +396,14 @@ const std::string& Class::GetName() const {
 	return name;
 }
 
+const Class* Class::GetParent() const {
+	return parent;
+}
+
+const std::unordered_map<std::string, Method>& Class::GetMethods() const {
+	return methods;
+}
+
 void Bool::Print(std::ostream& os) {
 	os << (GetValue() ? "True" : "False");
 }
@@ -1,27 +1,36 @@
 #pragma once
 
+#include "metrics.h"
 #include "object_holder.h"
 
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <functional>
 #include <unordered_map>
 
 namespace Ast {
   class Statement;
 }
 
+namespace Jit {
+  class Code;
+}
+
+namespace Trace {
+  class Tree;
+}
+
+namespace Memo {
+  class Table;
+}
+
 class TestRunner;
 
 namespace Runtime {
 
-class Object {
-public:
-  virtual ~Object() = default;
-  virtual void Print(std::ostream& os) = 0;
-};
-
 template <typename T>
 class ValueObject : public Object {
 public:
@@ -40,7 +49,56 @@ private:
   T value;
 };
 
-using String = ValueObject<std::string>;
+// Immutable string. Strings of up to kInlineCapacity bytes are stored in
+// the object. A longer string shares a buffer with the strings it was
+// concatenated from: a concatenation appends to the buffer of the left
+// operand if that string ends at the end of the buffer, so s = s + piece
+// copies only the piece. Interned strings point to one copy per value, so
+// comparing two of them is comparing pointers.
+class String : public Object {
+public:
+  static constexpr size_t kInlineCapacity = 15;
+
+  String(std::string value);
+
+  // The string of the process-wide table, which is never freed, e.g. for
+  // the literals of a program
+  static String Intern(std::string_view value);
+
+  void Print(std::ostream& os) override;
+
+  // Valid while the string is alive, concatenations never move its bytes
+  std::string_view GetValue() const;
+
+  size_t Size() const {
+    return size;
+  }
+
+  // Computed on the first call
+  size_t Hash() const;
+
+  bool IsInterned() const {
+    return interned != nullptr;
+  }
+
+  // Appends to the buffer of left when it has room after left, the strings
+  // of a loop like s = s + t then share one buffer
+  static String Concat(const String& left, const String& right);
+
+  friend bool operator==(const String& lhs, const String& rhs);
+
+private:
+  String(std::shared_ptr<std::string> buffer, size_t size);
+  String(std::string_view value, const std::string* interned);
+
+  std::shared_ptr<std::string> buffer;
+  const std::string* interned = nullptr;
+  size_t size;
+  char inline_chars[kInlineCapacity];
+  mutable bool hashed = false;
+  mutable size_t hash = 0;
+};
+
 using Number = ValueObject<int>;
 
 class Bool : public ValueObject<bool> {
@@ -49,40 +107,189 @@ public:
   void Print(std::ostream& os) override;
 };
 
+class ClassInstance;
+
+// Arguments of a call: a view of holders owned by the caller, which must
+// outlive the call, e.g. an ArgumentFrame, a vector or a single holder
+class Arguments {
+public:
+  Arguments() = default;
+
+  Arguments(const ObjectHolder* data, size_t size) : data(data), count(size) {
+  }
+
+  Arguments(const std::vector<ObjectHolder>& args) : data(args.data()), count(args.size()) {
+  }
+
+  Arguments(const ObjectHolder& arg) : data(&arg), count(1) {
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  const ObjectHolder& operator[](size_t i) const {
+    return data[i];
+  }
+
+  const ObjectHolder* begin() const {
+    return data;
+  }
+
+  const ObjectHolder* end() const {
+    return data + count;
+  }
+
+private:
+  const ObjectHolder* data = nullptr;
+  size_t count = 0;
+};
+
+// Slots for the arguments of a call, taken from a stack of the thread
+// instead of the heap. The slots don't move while the frame exists, so
+// they can be filled by expressions which make calls themselves.
+class ArgumentFrame {
+public:
+  explicit ArgumentFrame(size_t size);
+  ~ArgumentFrame();
+
+  ArgumentFrame(const ArgumentFrame&) = delete;
+  ArgumentFrame& operator=(const ArgumentFrame&) = delete;
+
+  ObjectHolder& operator[](size_t i) {
+    return slots[i];
+  }
+
+  Arguments GetArguments() const {
+    return {slots, size};
+  }
+
+private:
+  ObjectHolder* slots;
+  size_t size;
+  size_t previous_chunks;
+  size_t previous_top;
+};
+
+// Integer registers of compiled code, taken from a stack of the thread like
+// the slots of an ArgumentFrame. The registers aren't initialized.
+class IntFrame {
+public:
+  explicit IntFrame(size_t size);
+  ~IntFrame();
+
+  IntFrame(const IntFrame&) = delete;
+  IntFrame& operator=(const IntFrame&) = delete;
+
+  int* Get() const {
+    return slots;
+  }
+
+private:
+  int* slots;
+  size_t previous_chunks;
+  size_t previous_top;
+};
+
+// Method implemented in C++, e.g. emitted by mythonc
+using NativeMethod = ObjectHolder (*)(ClassInstance& self, Arguments actual_args);
+
 struct Method {
   std::string name;
   std::vector<std::string> formal_params;
-  std::unique_ptr<Ast::Statement> body;
+  mutable std::unique_ptr<Ast::Statement> body;
+  NativeMethod native = nullptr;
+
+  // Parses the body if it was skipped at load time, see ParseOptions
+  mutable std::function<std::unique_ptr<Ast::Statement>()> parse_body = nullptr;
+  void ParseBody() const;
+
+  mutable size_t call_count = 0;
+  mutable std::shared_ptr<const Jit::Code> jit_code = nullptr;
+  mutable std::shared_ptr<Trace::Tree> traces = nullptr;
+  // Set if the method is memoized, see memo.h
+  std::shared_ptr<Memo::Table> memo = nullptr;
 };
 
 class Class : public Object {
 public:
   explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
+
+  // A class whose methods and parent are given later by Define, so that
+  // method bodies referring to it can be parsed before it's complete
+  explicit Class(std::string name);
+  void Define(std::vector<Method> methods, const Class* parent);
+
+  // Special methods of the class or its ancestors, resolved when the class
+  // is defined. A slot is null if the method doesn't take the arguments of
+  // its operator; __init__ may take any number.
+  struct Slots {
+    const Method* str = nullptr;
+    const Method* add = nullptr;
+    const Method* init = nullptr;
+    const Method* eq = nullptr;
+    const Method* lt = nullptr;
+  };
+
+  const Slots& GetSlots() const {
+    return slots;
+  }
+
   const Method* GetMethod(const std::string& name) const;
   const std::string& GetName() const;
+  const Class* GetParent() const;
+  const std::unordered_map<std::string, Method>& GetMethods() const;
   void Print(std::ostream& os) override;
 
+  // Of the instances of the class, see metrics.h
+  Metrics::ClassCounters& GetCounters() const {
+    return counters;
+  }
+
 private:
   std::string name;
   std::unordered_map<std::string, Method> methods;
   const Class* parent;
+  Slots slots;
+  mutable Metrics::ClassCounters counters;
+
+  void ResolveSlots();
 };
 
 class ClassInstance : public Object {
 public:
+  // The fields of a destroyed instance are emptied and reused by the next
+  // instance created on the thread, without reallocating their buckets
   explicit ClassInstance(const Class& cls);
+  // A new instance with the fields of the other one
+  ClassInstance(const ClassInstance& other);
+  ~ClassInstance();
 
   void Print(std::ostream& os) override;
 
-  ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args);
+  // Throws if the method doesn't exist or takes another number of arguments
+  ObjectHolder Call(const std::string& method, Arguments actual_args);
+  // The method of the class of the instance or of its ancestors, e.g. a slot
+  ObjectHolder Call(const Method& method, Arguments actual_args);
   bool HasMethod(const std::string& method, size_t argument_count) const;
 
   Closure& Fields();
   const Closure& Fields() const;
 
+  const Class& GetClass() const;
+
+  // Distinguishes the instance from all others, including the instances
+  // later allocated at its address
+  uint64_t GetIdentity() const;
+
 private:
   const Class& cls;
   Closure fields;
+  mutable uint64_t identity = 0;
+  // Of the class, see metrics.h
+  Metrics::Instances* instances;
+
+  ObjectHolder Execute(const Method& method, Arguments actual_args);
 };
 
 void RunObjectsTests(TestRunner& test_runner);
@@ -1,58 +1,193 @@
 #pragma once
 
-#include <memory>
+#include "allocator.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
 #include <unordered_map>
+#include <utility>
 
 class TestRunner;
 
 namespace Runtime {
 
-class Object;
+class ObjectHolder;
+
+// Base of the runtime objects. The objects owned by ObjectHolder are counted
+// in the object itself and allocated from the slabs.
+//
+// An object is used by one thread at a time. It may be handed over to
+// another thread once the first one is done with it through a join or a
+// mutex, as the parallel parser does with the constants it creates and the
+// daemon with the programs its workers lease. Under that rule the counts
+// are updated with plain loads and stores. A process which runs programs on
+// several threads at once turns on ObjectHolder::SetThreadedCounts before
+// its threads start, then the counts are updated atomically.
+class Object {
+public:
+  Object() = default;
+
+  // A copy is a new object, it's not owned by the holders of the original
+  Object(const Object&) : ref_count(0) {
+  }
+
+  Object& operator=(const Object&) {
+    return *this;
+  }
+
+  virtual ~Object() = default;
+  virtual void Print(std::ostream& os) = 0;
 
+  static void* operator new(size_t size) {
+    return size <= kMaxSlabBlock ? SlabAllocate(size) : ::operator new(size);
+  }
+
+  static void operator delete(void* block, size_t size) {
+    if (size <= kMaxSlabBlock) {
+      SlabDeallocate(block, size);
+    } else {
+      ::operator delete(block);
+    }
+  }
+
+private:
+  friend class ObjectHolder;
+
+  std::atomic<uint32_t> ref_count = 0;
+};
+
+// Owning or borrowing pointer to an object. Pass it by const reference where
+// the callee doesn't keep it, copies update the count of an owned object.
 class ObjectHolder {
 public:
   ObjectHolder() = default;
 
+  ObjectHolder(const ObjectHolder& other) : data(other.data), owned(other.owned) {
+    Retain();
+  }
+
+  ObjectHolder(ObjectHolder&& other) noexcept : data(other.data), owned(other.owned) {
+    other.data = nullptr;
+    other.owned = false;
+  }
+
+  ObjectHolder& operator=(const ObjectHolder& other) {
+    ObjectHolder copy(other);
+    Swap(copy);
+    return *this;
+  }
+
+  ObjectHolder& operator=(ObjectHolder&& other) noexcept {
+    ObjectHolder moved(std::move(other));
+    Swap(moved);
+    return *this;
+  }
+
+  ~ObjectHolder() {
+    Release();
+  }
+
   template <typename T>
   static ObjectHolder Own(T&& object) {
-    return ObjectHolder(
-      std::make_shared<T>(std::forward<T>(object))
-    );
+    return ObjectHolder(new T(std::forward<T>(object)));
+  }
+
+  // Constructs the object in place
+  template <typename T, typename ...Args>
+  static ObjectHolder Make(Args&& ...args) {
+    return ObjectHolder(new T(std::forward<Args>(args)...));
   }
 
+  // The object must outlive the holder and its copies
   static ObjectHolder Share(Object& object);
   static ObjectHolder None();
 
-  Object& operator*();
-  const Object& operator*() const;
-  Object* operator->();
-  const Object* operator->() const;
+  // Whether the counts of objects are updated atomically, see Object. Set
+  // while no other thread uses objects.
+  static void SetThreadedCounts(bool threaded) {
+    threaded_counts.store(threaded, std::memory_order_relaxed);
+  }
 
-  Object* Get();
-  const Object* Get() const;
+  static bool HasThreadedCounts() {
+    return threaded_counts.load(std::memory_order_relaxed);
+  }
 
-  template <typename T>
-  T* TryAs() {
-    return dynamic_cast<T*>(this->Get());
+  Object& operator*() const {
+    return *data;
+  }
+
+  Object* operator->() const {
+    return data;
+  }
+
+  Object* Get() const {
+    return data;
   }
 
   template <typename T>
-  const T* TryAs() const {
-    return dynamic_cast<const T*>(this->Get());
+  T* TryAs() const {
+    return dynamic_cast<T*>(data);
   }
 
-  explicit operator bool() const;
+  explicit operator bool() const {
+    return data != nullptr;
+  }
 
 private:
-  ObjectHolder(std::shared_ptr<Object> data) : data(std::move(data)) {
+  explicit ObjectHolder(Object* owned_object) : data(owned_object), owned(true) {
+    Retain();
+  }
+
+  void Retain() const {
+    if (!owned) {
+      return;
+    }
+    std::atomic<uint32_t>& count = data->ref_count;
+    if (HasThreadedCounts()) {
+      count.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
   }
 
-  std::shared_ptr<Object> data;
+  void Release() {
+    if (!owned) {
+      return;
+    }
+    std::atomic<uint32_t>& count = data->ref_count;
+    uint32_t left;
+    if (HasThreadedCounts()) {
+      left = count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    } else {
+      left = count.load(std::memory_order_relaxed) - 1;
+      count.store(left, std::memory_order_relaxed);
+    }
+    if (left == 0) {
+      delete data;
+    }
+  }
+
+  void Swap(ObjectHolder& other) noexcept {
+    std::swap(data, other.data);
+    std::swap(owned, other.owned);
+  }
+
+  Object* data = nullptr;
+  bool owned = false;
+
+  static inline std::atomic<bool> threaded_counts = false;
 };
 
-using Closure = std::unordered_map<std::string, ObjectHolder>;
+using Closure = std::unordered_map<
+  std::string, ObjectHolder, std::hash<std::string>, std::equal_to<std::string>,
+  SlabAllocator<std::pair<const std::string, ObjectHolder>>
+>;
 
-bool IsTrue(ObjectHolder object);
+bool IsTrue(const ObjectHolder& object);
 
 void RunObjectHolderTests(TestRunner& tr);
 
@@ -4,6 +4,8 @@
 #include "test_runner.h"
 
 #include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -17,7 +19,7 @@ public:
     ++instance_count;
   }
 
-  Logger(const Logger& rhs) : id(rhs.id)
+  Logger(const Logger& rhs) : Object(rhs), id(rhs.id)
   {
     ++instance_count;
   }
@@ -110,11 +112,34 @@ void TestNullptr() {
   ASSERT(!oh.Get());
 }
 
+void TestThreadedCounts() {
+  ASSERT(!ObjectHolder::HasThreadedCounts());
+  ObjectHolder::SetThreadedCounts(true);
+  {
+    auto shared = ObjectHolder::Own(Logger(5));
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&shared] {
+        for (int j = 0; j < 100000; ++j) {
+          ObjectHolder copy = shared;
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    ASSERT_EQUAL(Logger::instance_count, 1);
+  }
+  ObjectHolder::SetThreadedCounts(false);
+  ASSERT_EQUAL(Logger::instance_count, 0);
+}
+
 void RunObjectHolderTests(TestRunner& tr) {
   RUN_TEST(tr, Runtime::TestNonowning);
   RUN_TEST(tr, Runtime::TestOwning);
   RUN_TEST(tr, Runtime::TestMove);
   RUN_TEST(tr, Runtime::TestNullptr);
+  RUN_TEST(tr, Runtime::TestThreadedCounts);
 }
 
 } /* namespace Runtime */
@@ -27,6 +27,74 @@ void TestString() {
   ASSERT_EQUAL(word.GetValue(), "hello!");
 }
 
+void TestStringConcatenation() {
+  String hello("hello");
+  String piece(", ");
+  String greeting = String::Concat(hello, piece);
+  String full = String::Concat(greeting, String("world"));
+  ASSERT_EQUAL(hello.GetValue(), "hello");
+  ASSERT_EQUAL(greeting.GetValue(), "hello, ");
+  ASSERT_EQUAL(full.GetValue(), "hello, world");
+
+  // A string in the middle of a buffer is copied before being extended
+  String other = String::Concat(greeting, String("there"));
+  ASSERT_EQUAL(other.GetValue(), "hello, there");
+  ASSERT_EQUAL(full.GetValue(), "hello, world");
+
+  String twice = String::Concat(full, full);
+  ASSERT_EQUAL(twice.GetValue(), "hello, worldhello, world");
+  ASSERT_EQUAL(full.GetValue(), "hello, world");
+
+  String built("");
+  string expected;
+  for (int i = 0; i < 1000; ++i) {
+    built = String::Concat(built, String(to_string(i)));
+    expected += to_string(i);
+  }
+  ASSERT_EQUAL(built.GetValue(), expected);
+}
+
+void TestStringViewsOutliveConcatenation() {
+  String base(string(20, 'a'));
+  String grown = String::Concat(base, String("b"));
+  const string_view view = grown.GetValue();
+
+  // Appended in the room the buffer has, the bytes don't move
+  String next = String::Concat(grown, String("c"));
+  ASSERT_EQUAL(next.GetValue().data(), view.data());
+
+  // Appends which don't fit copy, the view stays valid
+  String last = next;
+  for (int i = 0; i < 100; ++i) {
+    last = String::Concat(last, String(string(50, 'd')));
+  }
+  ASSERT_EQUAL(view, string(20, 'a') + "b");
+  ASSERT_EQUAL(grown.GetValue().data(), view.data());
+  ASSERT_EQUAL(next.GetValue(), string(20, 'a') + "bc");
+  ASSERT_EQUAL(last.Size(), 22u + 100 * 50);
+}
+
+void TestStringEquality() {
+  String interned = String::Intern("status: done");
+  ASSERT(interned.IsInterned());
+  ASSERT_EQUAL(interned.GetValue().data(), String::Intern("status: done").GetValue().data());
+  ASSERT(interned == String::Intern("status: done"));
+  ASSERT(!(interned == String::Intern("status: fail")));
+
+  String built = String::Concat(String("status: "), String("done"));
+  ASSERT(!built.IsInterned());
+  ASSERT(built == interned);
+  ASSERT(interned == built);
+  ASSERT_EQUAL(built.Hash(), interned.Hash());
+  ASSERT(!(built == String("status: dona")));
+
+  String long_string(string(100, 'x'));
+  ASSERT_EQUAL(long_string.Size(), 100u);
+  ASSERT(long_string == String::Intern(string(100, 'x')));
+  ASSERT(!(long_string == String(string(99, 'x'))));
+  ASSERT(String("") == String::Intern(""));
+}
+
 void TestFields() {
   vector<Method> methods;
 
@@ -69,6 +137,41 @@ void TestFields() {
   }
 }
 
+void TestCallArguments() {
+  vector<Method> methods;
+  methods.push_back({"Second", {"a", "b"}, make_unique<Ast::VariableValue>("b")});
+  Class cls("Pair", std::move(methods), nullptr);
+  ClassInstance inst(cls);
+
+  ArgumentFrame args(2);
+  args[0] = ObjectHolder::Own(Number(1));
+  args[1] = ObjectHolder::Own(Number(2));
+  ASSERT_EQUAL(inst.Call("Second", args.GetArguments()).TryAs<Number>()->GetValue(), 2);
+
+  ASSERT_THROWS(inst.Call("Second", {ObjectHolder::Own(Number(1))}), std::runtime_error);
+  ASSERT_THROWS(inst.Call("Third", {}), std::runtime_error);
+}
+
+void TestArgumentFrames() {
+  ArgumentFrame outer(3);
+  for (int i = 0; i < 3; ++i) {
+    outer[i] = ObjectHolder::Own(Number(i));
+  }
+  {
+    // Doesn't fit into the rest of the chunk
+    ArgumentFrame large(5000);
+    large[4999] = ObjectHolder::Own(Number(4999));
+    ArgumentFrame inner(1);
+    inner[0] = ObjectHolder::Own(Number(-1));
+    ASSERT_EQUAL(large.GetArguments()[4999].TryAs<Number>()->GetValue(), 4999);
+  }
+  ArgumentFrame next(1);
+  ASSERT(!next.GetArguments()[0]);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQUAL(outer.GetArguments()[i].TryAs<Number>()->GetValue(), i);
+  }
+}
+
 void TestBaseClass() {
   vector<Method> methods;
   methods.push_back({
@@ -145,7 +248,12 @@ void TestInheritance() {
 void RunObjectsTests(TestRunner& tr) {
   RUN_TEST(tr, Runtime::TestNumber);
   RUN_TEST(tr, Runtime::TestString);
+  RUN_TEST(tr, Runtime::TestStringConcatenation);
+  RUN_TEST(tr, Runtime::TestStringViewsOutliveConcatenation);
+  RUN_TEST(tr, Runtime::TestStringEquality);
   RUN_TEST(tr, Runtime::TestFields);
+  RUN_TEST(tr, Runtime::TestCallArguments);
+  RUN_TEST(tr, Runtime::TestArgumentFrames);
   RUN_TEST(tr, Runtime::TestBaseClass);
   RUN_TEST(tr, Runtime::TestInheritance);
 }
@@ -0,0 +1,146 @@
+#include "parallel_lexer.h"
+#include "scanner.h"
+
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Parse {
+
+namespace {
+
+// A non-blank line of a chunk: its number in the chunk, its indent and its
+// tokens in the chunk's stream, without Indent, Dedent and Newline
+struct ChunkLine {
+  int number;
+  int indent;
+  size_t begin;
+  size_t end;
+};
+
+struct Chunk {
+  string_view text;
+  TokenStream stream;
+  vector<ChunkLine> lines;
+  int line_count = 0;
+  exception_ptr error;
+};
+
+void LexChunk(Chunk& chunk) {
+  try {
+    istringstream input{string(chunk.text)};
+    chunk.stream = TokenStream(input);
+
+    const auto& stream = chunk.stream;
+    int indent = 0;
+    bool line_start = true;
+    for (size_t i = 0; i < stream.Size(); ++i) {
+      if (stream.Is<TokenType::Indent>(i)) {
+        ++indent;
+      } else if (stream.Is<TokenType::Dedent>(i)) {
+        --indent;
+      } else if (stream.Is<TokenType::Newline>(i)) {
+        chunk.lines.back().end = i;
+        line_start = true;
+      } else if (stream.Is<TokenType::Eof>(i)) {
+        chunk.line_count = stream.Line(i);
+      } else if (line_start) {
+        chunk.lines.push_back({stream.Line(i), indent, i, i});
+        line_start = false;
+      }
+    }
+  } catch (...) {
+    chunk.error = current_exception();
+  }
+}
+
+// Splits the source after the line ends closest to equal parts
+vector<Chunk> SplitSource(string_view source, size_t count) {
+  vector<Chunk> chunks;
+  const char* begin = source.data();
+  const char* end = begin + source.size();
+  for (size_t i = 1; i <= count && begin != end; ++i) {
+    const char* target = source.data() + source.size() / count * i;
+    const char* chunk_end = i == count ? end : Scan::FindLineEnd(max(begin, target), end);
+    if (chunk_end != end) {
+      ++chunk_end;
+    }
+    chunks.emplace_back().text = string_view(begin, chunk_end - begin);
+    begin = chunk_end;
+  }
+  return chunks;
+}
+
+} /* namespace */
+
+TokenStream LexParallel(string_view source, const ParallelLexOptions& options) {
+  const size_t threads = options.threads ? options.threads : max(thread::hardware_concurrency(), 1u);
+  const size_t chunk_count = min(threads, source.size() / max<size_t>(options.min_chunk_size, 1));
+  if (chunk_count <= 1) {
+    istringstream input{string(source)};
+    return TokenStream(input);
+  }
+
+  auto chunks = SplitSource(source, chunk_count);
+  vector<thread> workers;
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    workers.emplace_back(LexChunk, ref(chunks[i]));
+  }
+  LexChunk(chunks.front());
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // The first error in the source is the one the sequential lexer reports
+  size_t tokens = 0;
+  for (const auto& chunk : chunks) {
+    if (chunk.error) {
+      rethrow_exception(chunk.error);
+    }
+    tokens += chunk.stream.Size();
+  }
+
+  TokenStream result;
+  result.Reserve(tokens, source.size() / 2);
+
+  int indent = 0;
+  auto set_indent = [&result, &indent](int target, int line) {
+    for (; indent < target; ++indent) {
+      result.Append(TokenType::Indent{}, line);
+    }
+    for (; indent > target; --indent) {
+      result.Append(TokenType::Dedent{}, line);
+    }
+  };
+
+  // The lexer reads the next non-blank line before it returns a Newline, so
+  // Newline, Indent and Dedent tokens get the number of that line
+  int line_offset = 0;
+  bool newline_pending = false;
+  for (const auto& chunk : chunks) {
+    for (const auto& line : chunk.lines) {
+      const int number = line_offset + line.number;
+      if (newline_pending) {
+        result.Append(TokenType::Newline{}, number);
+      }
+      set_indent(line.indent, number);
+      result.AppendRange(chunk.stream, line.begin, line.end, number);
+      newline_pending = true;
+    }
+    line_offset += chunk.line_count;
+  }
+
+  if (newline_pending) {
+    result.Append(TokenType::Newline{}, line_offset);
+  }
+  set_indent(0, line_offset);
+  result.Append(TokenType::Eof{}, line_offset);
+  return result;
+}
+
+} /* namespace Parse */
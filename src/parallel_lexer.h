@@ -0,0 +1,29 @@
+#pragma once
+
+#include "lexer.h"
+
+#include <cstddef>
+#include <string_view>
+
+class TestRunner;
+
+namespace Parse {
+
+struct ParallelLexOptions {
+  // 0 for the number of hardware threads
+  size_t threads = 0;
+
+  // Smaller sources are lexed on the calling thread
+  size_t min_chunk_size = 1 << 16;
+};
+
+// Tokenizes the source into the same stream as TokenStream(istream&). The
+// source is split into chunks at line ends, which are lexed concurrently.
+// Indents only depend on the leading spaces of a line and strings can't span
+// lines, so the chunks are independent; the Indent and Dedent tokens and the
+// lines of Newline tokens are recomputed when the chunks are joined.
+TokenStream LexParallel(std::string_view source, const ParallelLexOptions& options = {});
+
+void RunParallelLexerTests(TestRunner& tr);
+
+} /* namespace Parse */
@@ -0,0 +1,152 @@
+#include "parallel_lexer.h"
+#include "test_runner.h"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Parse {
+
+namespace {
+
+// The inputs of lexer_test.cpp
+const vector<string> kLexerTestCorpus = {
+  "x = 42\n",
+  "class return if else def print or None and not True False",
+  "classes clas cl c ifs i If ret_urn not_ Nonee Tru e nor a_d printx def_ elsE _print",
+  "42 15 -53",
+  "x    _42 big_number   Return Class  dEf",
+  R"('word' "two words" 'long string with a double quote " inside' "another long string with single quote ' inside")",
+  "+-*/= > < != == <> <= >=",
+  R"(
+no_indent
+  indent_one
+    indent_two
+      indent_three
+      indent_three
+      indent_three
+    indent_two
+  indent_one
+    indent_two
+no_indent
+)",
+  R"(
+x = 1
+  y = 2
+
+  z = 3
+
+
+)",
+  R"(
+x = 4
+y = "hello"
+
+class Point:
+  def __init__(self, x, y):
+    self.x = x
+    self.y = y
+
+  def __str__(self):
+    return str(x) + ' ' + str(y)
+
+p = Point(1, 2)
+print str(p)
+)",
+  "bugaga",
+  "+ bugaga + def 52",
+  "a b",
+  "+",
+  "",
+};
+
+string LexSequentially(const string& source) {
+  ostringstream out;
+  try {
+    istringstream input(source);
+    TokenStream stream(input);
+    for (size_t i = 0; i < stream.Size(); ++i) {
+      out << stream.At(i) << '@' << stream.Line(i) << ' ';
+    }
+  } catch (const LexerError& e) {
+    out << "error: " << e.what();
+  }
+  return out.str();
+}
+
+string LexInParallel(const string& source, size_t threads) {
+  ostringstream out;
+  try {
+    ParallelLexOptions options;
+    options.threads = threads;
+    options.min_chunk_size = 1;
+    TokenStream stream = LexParallel(source, options);
+    for (size_t i = 0; i < stream.Size(); ++i) {
+      out << stream.At(i) << '@' << stream.Line(i) << ' ';
+    }
+  } catch (const LexerError& e) {
+    out << "error: " << e.what();
+  }
+  return out.str();
+}
+
+void CheckSameAsLexer(const string& source) {
+  const string expected = LexSequentially(source);
+  for (size_t threads : {1, 2, 3, 8, 64}) {
+    AssertEqual(LexInParallel(source, threads), expected, source + " with threads " + to_string(threads));
+  }
+}
+
+} /* namespace */
+
+void TestParallelLexerCorpus() {
+  for (const auto& source : kLexerTestCorpus) {
+    CheckSameAsLexer(source);
+  }
+}
+
+void TestParallelLexerRandomPrograms() {
+  const vector<string> lines = {
+    "class A:", "  def f(self, x):", "    return x + 'a\\'b'", "      deep = \"s\"",
+    "", "   ", "\t", "x = 1", "  y = x.f(2) <= 3", "print 'one', 2", "    if x:",
+    "  else:", "        z", "\"unbalanced", "   odd", "s = 'end'  ",
+  };
+  mt19937 generator(36);
+  for (int i = 0; i < 300; ++i) {
+    string source;
+    const size_t count = generator() % 40;
+    for (size_t j = 0; j < count; ++j) {
+      source += lines[generator() % lines.size()];
+      if (j + 1 < count || generator() % 2) {
+        source += '\n';
+      }
+    }
+    CheckSameAsLexer(source);
+  }
+}
+
+void TestParallelLexerLargeSource() {
+  string source;
+  for (int i = 0; i < 2000; ++i) {
+    source += "class C" + to_string(i) + ":\n  def f(self):\n    if self.x:\n      return 'a'\n    return " + to_string(i) + "\n\n";
+  }
+  TokenStream parallel = LexParallel(source, {4, 1024});
+  istringstream input(source);
+  TokenStream sequential(input);
+  ASSERT_EQUAL(parallel.Size(), sequential.Size());
+  for (size_t i = 0; i < sequential.Size(); ++i) {
+    ASSERT_EQUAL(parallel.At(i), sequential.At(i));
+    ASSERT_EQUAL(parallel.Line(i), sequential.Line(i));
+  }
+}
+
+void RunParallelLexerTests(TestRunner& tr) {
+  RUN_TEST(tr, Parse::TestParallelLexerCorpus);
+  RUN_TEST(tr, Parse::TestParallelLexerRandomPrograms);
+  RUN_TEST(tr, Parse::TestParallelLexerLargeSource);
+}
+
+} /* namespace Parse */
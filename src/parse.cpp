@@ -4,61 +4,164 @@
 #include "comparators.h"
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <cctype>
 #include <vector>
 #include <optional>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 
 using namespace std;
 
 namespace TokenType = Parse::TokenType;
 
-namespace {
-bool operator == (const Parse::Token& token, char c) {
-  auto p = token.TryAs<TokenType::Char>();
-  return p && p->value == c;
-}
-
-bool operator != (const Parse::Token& token, char c) {
-  return !(token == c);
-}
-
-}
+// Classes in the order of their declaration. Lazily parsed method bodies
+// share it with the parser of the program and see only the classes declared
+// before them, like the eager parser.
+struct DeclaredClasses {
+  vector<ObjectHolder> classes;
+  unordered_map<string, size_t> index;
+};
 
 class Parser {
 public:
-  explicit Parser(Parse::Lexer& lexer) : lexer(lexer) {
+  explicit Parser(Parse::Lexer& lexer, ParseOptions options = {})
+    : lexer(lexer)
+    , options(options)
+    , declared_classes(make_shared<DeclaredClasses>())
+  {
+  }
+
+  // Parser of a method body recorded by ParseMethods or of the methods of a
+  // class parsed by ParseClassesConcurrently
+  Parser(
+    Parse::Lexer& lexer, shared_ptr<DeclaredClasses> declared_classes, size_t visible_classes,
+    ParseOptions options = {}
+  )
+    : lexer(lexer)
+    , options(options)
+    , declared_classes(move(declared_classes))
+    , visible_classes(visible_classes)
+  {
+  }
+
+  unique_ptr<Ast::Statement> ParseMethodBody() {
+    auto result = ParseSuite();
+    lexer.Expect<TokenType::Eof>();
+    return result;
   }
 
   // Program -> eps
   //          | Statement \n Program
   unique_ptr<Ast::Statement> ParseProgram() {
     auto result = make_unique<Ast::Compound>();
-    while (!lexer.CurrentToken().Is<TokenType::Eof>()) {
-      result->AddStatement(ParseStatement());
+    ParseProgram([&result](unique_ptr<Ast::Statement> statement) {
+      result->AddStatement(move(statement));
+    });
+    return result;
+  }
+
+  void ParseProgram(const function<void(unique_ptr<Ast::Statement>)>& consume) {
+    if (options.threads != 1 && lexer.Stream()) {
+      ParseClassesConcurrently();
     }
 
-    return result;
+    while (!lexer.Is<TokenType::Eof>()) {
+      consume(ParseStatement());
+    }
   }
 
 private:
+  // A top-level class of the stream. Its methods are parsed ahead of the
+  // program; methods is empty if that failed and they are parsed again in
+  // order, which reports the error.
+  struct ParsedClass {
+    string name;
+    // Positions of the name, the first def and the closing Dedent
+    size_t name_position;
+    size_t methods_begin;
+    size_t methods_end;
+    optional<vector<Runtime::Method>> methods;
+  };
+
   Parse::Lexer& lexer;
-  Runtime::Closure declared_classes;
+  ParseOptions options;
+  shared_ptr<DeclaredClasses> declared_classes;
+  size_t visible_classes = numeric_limits<size_t>::max();
+  vector<ParsedClass> parsed_classes;
+  size_t next_parsed_class = 0;
+
+  const Runtime::Class* FindClass(const string& name) const {
+    auto it = declared_classes->index.find(name);
+    if (it == declared_classes->index.end() || it->second >= visible_classes) {
+      return nullptr;
+    }
+    return declared_classes->classes[it->second].TryAs<Runtime::Class>();
+  }
+
+  // Skips a suite up to its matching Dedent and returns a parser of it
+  function<unique_ptr<Ast::Statement>()> SkipSuite() {
+    lexer.Expect<TokenType::Newline>();
+    if (auto& stream = lexer.Stream()) {
+      // The body is a range of the stream the program is parsed from
+      const size_t begin = lexer.StreamPosition();
+      lexer.ExpectNext<TokenType::Indent>();
+      const size_t end = stream->SkipBlock(lexer.StreamPosition());
+      if (end == stream->Size()) {
+        throw ParseError("Unexpected end of file in a method body");
+      }
+      lexer.Seek(end);
+      return LazyMethodBody(stream, begin, end);
+    }
+
+    auto span = make_shared<Parse::TokenStream>();
+    span->Append(lexer.CurrentToken(), lexer.CurrentLineNumber());
+    lexer.ExpectNext<TokenType::Indent>();
+
+    int depth = 0;
+    do {
+      const auto& token = lexer.CurrentToken();
+      if (token.Is<TokenType::Indent>()) {
+        ++depth;
+      } else if (token.Is<TokenType::Dedent>()) {
+        --depth;
+      } else if (token.Is<TokenType::Eof>()) {
+        throw ParseError("Unexpected end of file in a method body");
+      }
+      span->Append(token, lexer.CurrentLineNumber());
+      lexer.Advance();
+    } while (depth > 0);
+    return LazyMethodBody(span, 0, span->Size());
+  }
+
+  function<unique_ptr<Ast::Statement>()> LazyMethodBody(
+    shared_ptr<const Parse::TokenStream> stream, size_t begin, size_t end
+  ) {
+    const size_t visible = min(visible_classes, declared_classes->classes.size());
+    return [stream, begin, end, classes = declared_classes, visible] {
+      Parse::Lexer lexer(stream, begin, end);
+      return Parser(lexer, classes, visible).ParseMethodBody();
+    };
+  }
 
   // Suite -> NEWLINE INDENT (Statement)+ DEDENT
   unique_ptr<Ast::Statement> ParseSuite() {
     lexer.Expect<TokenType::Newline>();
     lexer.ExpectNext<TokenType::Indent>();
 
-    lexer.NextToken();
+    lexer.Advance();
 
     auto result = make_unique<Ast::Compound>();
-    while (!lexer.CurrentToken().Is<TokenType::Dedent>()) {
+    while (!lexer.Is<TokenType::Dedent>()) {
       result->AddStatement(ParseStatement());
     }
 
     lexer.Expect<TokenType::Dedent>();
-    lexer.NextToken();
+    lexer.Advance();
 
     return result;
   }
@@ -67,46 +170,157 @@ private:
   vector<Runtime::Method> ParseMethods() {
     vector<Runtime::Method> result;
 
-    while (lexer.CurrentToken().Is<TokenType::Def>()) {
+    while (lexer.Is<TokenType::Def>()) {
       Runtime::Method m;
 
-      m.name = lexer.ExpectNext<TokenType::Id>().value;
+      m.name = lexer.ExpectNextValue<TokenType::Id>();
       lexer.ExpectNext<TokenType::Char>('(');
 
-      if (lexer.NextToken().Is<TokenType::Id>()) {
-        m.formal_params.push_back(lexer.Expect<TokenType::Id>().value);
-        while (lexer.NextToken() == ',') {
-          m.formal_params.push_back(lexer.ExpectNext<TokenType::Id>().value);
+      lexer.Advance();
+      if (lexer.Is<TokenType::Id>()) {
+        m.formal_params.emplace_back(lexer.Value<TokenType::Id>());
+        for (lexer.Advance(); lexer.IsChar(','); lexer.Advance()) {
+          m.formal_params.emplace_back(lexer.ExpectNextValue<TokenType::Id>());
         }
       }
 
       lexer.Expect<TokenType::Char>(')');
       lexer.ExpectNext<TokenType::Char>(':');
-      lexer.NextToken();
+      lexer.Advance();
 
-      m.body = ParseSuite();
+      if (options.lazy_methods && !options.validate) {
+        m.parse_body = SkipSuite();
+      } else {
+        m.body = ParseSuite();
+      }
 
       result.push_back(std::move(m));
     }
     return result;
   }
 
+  // Top-level classes of the stream, or nothing if there are classes in other
+  // places or a header is malformed, then the program is parsed in order
+  static vector<ParsedClass> FindTopLevelClasses(const Parse::TokenStream& stream) {
+    auto is_char = [&stream](size_t position, char c) {
+      return stream.Is<TokenType::Char>(position) && stream.Value(position) == c;
+    };
+    vector<ParsedClass> result;
+    int depth = 0;
+    bool statement_start = true;
+    for (size_t position = 0; position < stream.Size(); ++position) {
+      if (stream.Is<TokenType::Indent>(position)) {
+        ++depth;
+      } else if (stream.Is<TokenType::Dedent>(position)) {
+        --depth;
+      } else if (stream.Is<TokenType::Class>(position)) {
+        if (depth != 0 || !statement_start) {
+          return {};
+        }
+
+        // class Id ['(' Id ')'] : Newline Indent Def
+        size_t header = position + 1;
+        if (header >= stream.Size() || !stream.Is<TokenType::Id>(header)) {
+          return {};
+        }
+        ParsedClass cls{string(stream.Text(header)), header, 0, 0, nullopt};
+        ++header;
+        if (header + 2 < stream.Size() && is_char(header, '(')) {
+          header += 3;
+        }
+        if (header + 3 >= stream.Size() || !is_char(header, ':')
+            || !stream.Is<TokenType::Newline>(header + 1) || !stream.Is<TokenType::Indent>(header + 2)
+            || !stream.Is<TokenType::Def>(header + 3)) {
+          return {};
+        }
+        cls.methods_begin = header + 3;
+        const size_t end = stream.SkipBlock(header + 2);
+        if (end == stream.Size()) {
+          return {};
+        }
+        cls.methods_end = end - 1;
+        result.push_back(move(cls));
+
+        position = end - 1;
+        statement_start = true;
+        continue;
+      }
+      statement_start = stream.Is<TokenType::Newline>(position) || stream.Is<TokenType::Dedent>(position);
+    }
+    return result;
+  }
+
+  // Declares the top-level classes and parses their methods on several
+  // threads. A class body sees the classes before it, as in ParseClassDefinition,
+  // which then links the classes in program order.
+  void ParseClassesConcurrently() {
+    const auto& stream = lexer.Stream();
+    parsed_classes = FindTopLevelClasses(*stream);
+    if (parsed_classes.size() < 2) {
+      parsed_classes.clear();
+      return;
+    }
+
+    auto& classes = declared_classes->classes;
+    for (const auto& cls : parsed_classes) {
+      declared_classes->index.emplace(cls.name, classes.size());
+      classes.push_back(ObjectHolder::Own(Runtime::Class(cls.name)));
+    }
+    visible_classes = 0;
+
+    ParseOptions body_options = options;
+    body_options.threads = 1;
+    atomic<size_t> next_class = 0;
+    auto parse_classes = [&] {
+      for (size_t i; (i = next_class++) < parsed_classes.size(); ) {
+        auto& cls = parsed_classes[i];
+        try {
+          Parse::Lexer body(stream, cls.methods_begin, cls.methods_end);
+          Parser parser(body, declared_classes, i, body_options);
+          auto methods = parser.ParseMethods();
+          if (body.Is<TokenType::Eof>()) {
+            cls.methods = move(methods);
+          }
+        } catch (const exception&) {
+          // Reported when the class is parsed again in order
+        }
+      }
+    };
+
+    const size_t thread_count = min<size_t>(
+      options.threads ? options.threads : max(thread::hardware_concurrency(), 1u), parsed_classes.size()
+    );
+    vector<thread> workers;
+    for (size_t i = 1; i < thread_count; ++i) {
+      workers.emplace_back(parse_classes);
+    }
+    parse_classes();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
   // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
   unique_ptr<Ast::Statement> ParseClassDefinition() {
-    string class_name = lexer.Expect<TokenType::Id>().value;
+    ParsedClass* parsed = nullptr;
+    if (next_parsed_class < parsed_classes.size()
+        && parsed_classes[next_parsed_class].name_position == lexer.StreamPosition()) {
+      parsed = &parsed_classes[next_parsed_class++];
+    }
 
-    lexer.NextToken();
+    string class_name(lexer.ExpectValue<TokenType::Id>());
+
+    lexer.Advance();
 
     const Runtime::Class* base_class = nullptr;
-    if (lexer.CurrentToken() == '(') {
-      auto name = lexer.ExpectNext<TokenType::Id>().value;
+    if (lexer.IsChar('(')) {
+      string name(lexer.ExpectNextValue<TokenType::Id>());
       lexer.ExpectNext<TokenType::Char>(')');
-      lexer.NextToken();
+      lexer.Advance();
 
-      if (auto it = declared_classes.find(name); it == declared_classes.end()) {
+      base_class = FindClass(name);
+      if (!base_class) {
         throw ParseError("Base class " + name + " not found for class " + class_name);
-      } else {
-        base_class = static_cast<const Runtime::Class*>(it->second.Get());
       }
     }
 
@@ -114,28 +328,41 @@ private:
     lexer.ExpectNext<TokenType::Newline>();
     lexer.ExpectNext<TokenType::Indent>();
     lexer.ExpectNext<TokenType::Def>();
-    vector<Runtime::Method> methods = ParseMethods();
+    vector<Runtime::Method> methods;
+    if (parsed && parsed->methods) {
+      methods = move(*parsed->methods);
+      lexer.Seek(parsed->methods_end);
+    } else {
+      methods = ParseMethods();
+    }
 
     lexer.Expect<TokenType::Dedent>();
-    lexer.NextToken();
-
-    auto [it, inserted] = declared_classes.insert({
-      class_name,
-      ObjectHolder::Own(Runtime::Class(class_name, std::move(methods), base_class))
-    });
+    lexer.Advance();
+
+    auto& classes = declared_classes->classes;
+    if (parsed) {
+      // Declared by ParseClassesConcurrently, linked now
+      const size_t index = visible_classes++;
+      if (declared_classes->index.at(class_name) != index) {
+        throw ParseError("Class " + class_name + " already exists");
+      }
+      classes[index].TryAs<Runtime::Class>()->Define(std::move(methods), base_class);
+      return make_unique<Ast::ClassDefinition>(classes[index]);
+    }
 
-    if (!inserted) {
+    if (!declared_classes->index.emplace(class_name, classes.size()).second) {
       throw ParseError("Class " + class_name + " already exists");
     }
+    classes.push_back(ObjectHolder::Own(Runtime::Class(class_name, std::move(methods), base_class)));
 
-    return make_unique<Ast::ClassDefinition>(it->second);
+    return make_unique<Ast::ClassDefinition>(classes.back());
   }
 
   vector<string> ParseDottedIds() {
-    vector<string> result(1, lexer.Expect<TokenType::Id>().value);
+    vector<string> result(1, string(lexer.ExpectValue<TokenType::Id>()));
 
-    while (lexer.NextToken() == '.') {
-      result.push_back(lexer.ExpectNext<TokenType::Id>().value);
+    for (lexer.Advance(); lexer.IsChar('.'); lexer.Advance()) {
+      result.emplace_back(lexer.ExpectNextValue<TokenType::Id>());
     }
 
     return result;
@@ -150,8 +377,8 @@ private:
     string last_name = id_list.back();
     id_list.pop_back();
 
-    if (lexer.CurrentToken() == '=') {
-      lexer.NextToken();
+    if (lexer.IsChar('=')) {
+      lexer.Advance();
 
       if (id_list.empty()) {
         return make_unique<Ast::Assignment>(std::move(last_name), ParseTest());
@@ -162,7 +389,7 @@ private:
       }
     } else {
       lexer.Expect<TokenType::Char>('(');
-      lexer.NextToken();
+      lexer.Advance();
 
       if (id_list.empty()) {
         throw ParseError("Mython doesn't support functions, only methods: " + last_name);
@@ -170,11 +397,11 @@ private:
 
 
       vector<unique_ptr<Ast::Statement>> args;
-      if (lexer.CurrentToken() != ')') {
+      if (!lexer.IsChar(')')) {
         args = ParseTestList();
       }
       lexer.Expect<TokenType::Char>(')');
-      lexer.NextToken();
+      lexer.Advance();
 
       return make_unique<Ast::MethodCall>(
         make_unique<Ast::VariableValue>(std::move(id_list)),
@@ -187,9 +414,9 @@ private:
   // Expr -> Adder ['+'/'-' Adder]*
   unique_ptr<Ast::Statement> ParseExpression() {
     unique_ptr<Ast::Statement> result = ParseAdder();
-    while (lexer.CurrentToken() == '+' || lexer.CurrentToken() == '-') {
-      char op = lexer.CurrentToken().As<TokenType::Char>().value;
-      lexer.NextToken();
+    while (lexer.IsChar('+') || lexer.IsChar('-')) {
+      char op = lexer.Value<TokenType::Char>();
+      lexer.Advance();
 
       if (op == '+') {
         result = make_unique<Ast::Add>(std::move(result), ParseAdder());
@@ -203,9 +430,9 @@ private:
   // Adder -> Mult ['*'/'/' Mult]*
   unique_ptr<Ast::Statement> ParseAdder() {
     unique_ptr<Ast::Statement> result = ParseMult();
-    while (lexer.CurrentToken() == '*' || lexer.CurrentToken() == '/') {
-      char op = lexer.CurrentToken().As<TokenType::Char>().value;
-      lexer.NextToken();
+    while (lexer.IsChar('*') || lexer.IsChar('/')) {
+      char op = lexer.Value<TokenType::Char>();
+      lexer.Advance();
 
       if (op == '*') {
         result = make_unique<Ast::Mult>(std::move(result), ParseMult());
@@ -226,46 +453,47 @@ private:
   //       | DottedIds '(' ExprList ')'
   //       | DottedIds
   unique_ptr<Ast::Statement> ParseMult() {
-    if (lexer.CurrentToken() == '(') {
-      lexer.NextToken();
+    if (lexer.IsChar('(')) {
+      lexer.Advance();
       auto result = ParseTest();
       lexer.Expect<TokenType::Char>(')');
-      lexer.NextToken();
+      lexer.Advance();
       return result;
-    } else if (lexer.CurrentToken() == '-') {
-      lexer.NextToken();
+    } else if (lexer.IsChar('-')) {
+      lexer.Advance();
       return make_unique<Ast::Mult>(
         ParseMult(),
         make_unique<Ast::NumericConst>(-1)
       );
-    } else if (auto num = lexer.CurrentToken().TryAs<TokenType::Number>()) {
-      int result = num->value;
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::Number>()) {
+      int result = lexer.Value<TokenType::Number>();
+      lexer.Advance();
       return make_unique<Ast::NumericConst>(result);
-    } else if (auto str = lexer.CurrentToken().TryAs<TokenType::String>()) {
-      string result = str->value;
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::String>()) {
+      auto result = Runtime::String::Intern(lexer.Value<TokenType::String>());
+      lexer.Advance();
       return make_unique<Ast::StringConst>(std::move(result));
-    } else if (lexer.CurrentToken().Is<TokenType::True>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::True>()) {
+      lexer.Advance();
       return make_unique<Ast::BoolConst>(Runtime::Bool(true));
-    } else if (lexer.CurrentToken().Is<TokenType::False>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::False>()) {
+      lexer.Advance();
       return make_unique<Ast::BoolConst>(Runtime::Bool(false));
-    } else if (lexer.CurrentToken().Is<TokenType::None>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::None>()) {
+      lexer.Advance();
       return make_unique<Ast::None>();
     } else {
       vector<string> names = ParseDottedIds();
 
-      if (lexer.CurrentToken() == '(') {
+      if (lexer.IsChar('(')) {
         // various calls
         vector<unique_ptr<Ast::Statement>> args;
-        if (lexer.NextToken() != ')') {
+        lexer.Advance();
+        if (!lexer.IsChar(')')) {
           args = ParseTestList();
         }
         lexer.Expect<TokenType::Char>(')');
-        lexer.NextToken();
+        lexer.Advance();
 
         auto method_name = names.back();
         names.pop_back();
@@ -276,10 +504,8 @@ private:
             std::move(method_name),
             std::move(args)
           );
-        } else if (auto it = declared_classes.find(method_name); it != end(declared_classes)) {
-          return make_unique<Ast::NewInstance>(
-            static_cast<const Runtime::Class&>(*it->second), std::move(args)
-          );
+        } else if (auto cls = FindClass(method_name)) {
+          return make_unique<Ast::NewInstance>(*cls, std::move(args));
         } else if (method_name == "str") {
           if (args.size() != 1) {
             throw ParseError("Function str takes exactly one argument");
@@ -298,8 +524,8 @@ private:
     vector<unique_ptr<Ast::Statement>> result;
     result.push_back(ParseTest());
 
-    while (lexer.CurrentToken() == ',') {
-      lexer.NextToken();
+    while (lexer.IsChar(',')) {
+      lexer.Advance();
       result.push_back(ParseTest());
     }
     return result;
@@ -308,19 +534,19 @@ private:
   // Condition -> if LogicalExpr: Suite [else: Suite]
   unique_ptr<Ast::Statement> ParseCondition() {
     lexer.Expect<TokenType::If>();
-    lexer.NextToken();
+    lexer.Advance();
 
     auto condition = ParseTest();
 
     lexer.Expect<TokenType::Char>(':');
-    lexer.NextToken();
+    lexer.Advance();
 
     auto if_body = ParseSuite();
 
     unique_ptr<Ast::Statement> else_body;
-    if (lexer.CurrentToken().Is<TokenType::Else>()) {
+    if (lexer.Is<TokenType::Else>()) {
       lexer.ExpectNext<TokenType::Char>(':');
-      lexer.NextToken();
+      lexer.Advance();
       else_body = ParseSuite();
     }
 
@@ -333,8 +559,8 @@ private:
   //          | Comparison
   unique_ptr<Ast::Statement> ParseTest() {
     auto result = ParseAndTest();
-    while (lexer.CurrentToken().Is<TokenType::Or>()) {
-      lexer.NextToken();
+    while (lexer.Is<TokenType::Or>()) {
+      lexer.Advance();
       result = make_unique<Ast::Or>(std::move(result), ParseAndTest());
     }
     return result;
@@ -342,16 +568,16 @@ private:
 
   unique_ptr<Ast::Statement> ParseAndTest() {
     auto result = ParseNotTest();
-    while (lexer.CurrentToken().Is<TokenType::And>()) {
-      lexer.NextToken();
+    while (lexer.Is<TokenType::And>()) {
+      lexer.Advance();
       result = make_unique<Ast::And>(std::move(result), ParseNotTest());
     }
     return result;
   }
 
   unique_ptr<Ast::Statement> ParseNotTest() {
-    if (lexer.CurrentToken().Is<TokenType::Not>()) {
-      lexer.NextToken();
+    if (lexer.Is<TokenType::Not>()) {
+      lexer.Advance();
       return make_unique<Ast::Not>(ParseNotTest());
     } else {
       return ParseComparison();
@@ -362,25 +588,23 @@ private:
   unique_ptr<Ast::Statement> ParseComparison() {
     auto result = ParseExpression();
 
-    const auto tok = lexer.CurrentToken();
-
-    if (tok == '<') {
-      lexer.NextToken();
+    if (lexer.IsChar('<')) {
+      lexer.Advance();
       return make_unique<Ast::Comparison>(Runtime::Less, std::move(result), ParseExpression());
-    } else if (tok == '>') {
-      lexer.NextToken();
+    } else if (lexer.IsChar('>')) {
+      lexer.Advance();
       return make_unique<Ast::Comparison>(Runtime::Greater, std::move(result), ParseExpression());
-    } else if (tok.Is<TokenType::Eq>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::Eq>()) {
+      lexer.Advance();
       return make_unique<Ast::Comparison>(Runtime::Equal, std::move(result), ParseExpression());
-    } else if (tok.Is<TokenType::NotEq>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::NotEq>()) {
+      lexer.Advance();
       return make_unique<Ast::Comparison>(Runtime::NotEqual, std::move(result), ParseExpression());
-    } else if (tok.Is<TokenType::LessOrEq>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::LessOrEq>()) {
+      lexer.Advance();
       return make_unique<Ast::Comparison>(Runtime::LessOrEqual, std::move(result), ParseExpression());
-    } else if (tok.Is<TokenType::GreaterOrEq>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::GreaterOrEq>()) {
+      lexer.Advance();
       return make_unique<Ast::Comparison>(Runtime::GreaterOrEqual, std::move(result), ParseExpression());
     } else {
       return result;
@@ -391,34 +615,34 @@ private:
   //           | class ClassDefinition
   //           | if Condition
   unique_ptr<Ast::Statement> ParseStatement() {
-    const auto& tok = lexer.CurrentToken();
-
-    if (tok.Is<TokenType::Class>()) {
-      lexer.NextToken();
-      return ParseClassDefinition();
-    } else if (tok.Is<TokenType::If>()) {
-      return ParseCondition();
+    const int line = lexer.CurrentLineNumber();
+
+    unique_ptr<Ast::Statement> result;
+    if (lexer.Is<TokenType::Class>()) {
+      lexer.Advance();
+      result = ParseClassDefinition();
+    } else if (lexer.Is<TokenType::If>()) {
+      result = ParseCondition();
     } else {
-      auto result = ParseSimpleStatement();
+      result = ParseSimpleStatement();
       lexer.Expect<TokenType::Newline>();
-      lexer.NextToken();
-      return result;
+      lexer.Advance();
     }
+    result->line = line;
+    return result;
   }
 
   //StatementBody -> return Expression
   //               | print ExpressionList
   //               | AssignmentOrCall
   unique_ptr<Ast::Statement> ParseSimpleStatement() {
-    const auto& tok = lexer.CurrentToken();
-
-    if (tok.Is<TokenType::Return>()) {
-      lexer.NextToken();
+    if (lexer.Is<TokenType::Return>()) {
+      lexer.Advance();
       return make_unique<Ast::Return>(ParseTest());
-    } else if (tok.Is<TokenType::Print>()) {
-      lexer.NextToken();
+    } else if (lexer.Is<TokenType::Print>()) {
+      lexer.Advance();
       vector<unique_ptr<Ast::Statement>> args;
-      if (!lexer.CurrentToken().Is<TokenType::Newline>()) {
+      if (!lexer.Is<TokenType::Newline>()) {
         args = ParseTestList();
       }
       return make_unique<Ast::Print>(std::move(args));
@@ -431,3 +655,14 @@ private:
 unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer) {
   return Parser{lexer}.ParseProgram();
 }
+
+unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer, const ParseOptions& options) {
+  return Parser{lexer, options}.ParseProgram();
+}
+
+void ParseProgram(
+  Parse::Lexer& lexer, const ParseOptions& options,
+  const function<void(unique_ptr<Ast::Statement>)>& consume
+) {
+  Parser{lexer, options}.ParseProgram(consume);
+}
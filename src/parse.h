@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <stdexcept>
 
@@ -17,6 +19,31 @@ struct ParseError : std::runtime_error {
   using std::runtime_error::runtime_error;
 };
 
+struct ParseOptions {
+  // Method bodies are only checked for balanced indentation and kept as
+  // tokens, they are parsed on the first call of the method
+  bool lazy_methods = false;
+
+  // Parses method bodies at load time even with lazy_methods, so that all
+  // syntax errors are reported before the program runs
+  bool validate = false;
+
+  // Threads which parse the methods of top-level classes concurrently, 0 for
+  // all cores. Needs a lexer over a Parse::TokenStream; the classes are then
+  // linked to their bases in program order, with the errors of the
+  // sequential parser.
+  size_t threads = 1;
+};
+
 std::unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer);
+std::unique_ptr<Ast::Statement> ParseProgram(Parse::Lexer& lexer, const ParseOptions& options);
+
+// Passes each top-level statement to the consumer as soon as it is parsed, so
+// that it can be executed and dropped before the rest of the program is read.
+// The classes of the program live until the function returns.
+void ParseProgram(
+  Parse::Lexer& lexer, const ParseOptions& options,
+  const std::function<void(std::unique_ptr<Ast::Statement>)>& consume
+);
 
 void TestParseProgram(TestRunner& tr);
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
 
 using namespace std;
 
@@ -500,6 +501,187 @@ Add 100 operation
 )");
 }
 
+void TestLazyMethods() {
+  const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+
+class Factory:
+  def make(x):
+    if x > 0:
+      if x > 10:
+        return Point(x, 10)
+      return Point(x, x)
+    return None
+
+  def broken():
+    return Factory()
+
+  def unused():
+    return 1 +
+
+f = Factory()
+print f.make(3), f.make(20), f.make(-1)
+)";
+
+  ParseOptions options;
+  options.lazy_methods = true;
+
+  istringstream is(program);
+  Parse::Lexer lexer(is);
+  auto tree = ParseProgram(lexer, options);
+
+  ostringstream os;
+  Ast::Print::SetOutputStream(os);
+  Runtime::Closure closure;
+  tree->Execute(closure);
+  ASSERT_EQUAL(os.str(), "(3, 3) (20, 10) None\n");
+
+  // A body is parsed with the classes declared before it, like in eager mode
+  Runtime::Closure call_closure;
+  ASSERT_THROWS(ParseProgramFromString(program + "f.broken()\n"), ParseError);
+  istringstream broken_input(program + "f.broken()\n");
+  Parse::Lexer broken_lexer(broken_input);
+  auto broken = ParseProgram(broken_lexer, options);
+  ASSERT_THROWS(broken->Execute(call_closure), ParseError);
+
+  // Over a token stream the bodies are ranges of the program's stream
+  istringstream stream_input(program);
+  Parse::Lexer stream_lexer(make_shared<const TokenStream>(stream_input));
+  auto streamed = ParseProgram(stream_lexer, options);
+  os.str({});
+  Runtime::Closure stream_closure;
+  streamed->Execute(stream_closure);
+  ASSERT_EQUAL(os.str(), "(3, 3) (20, 10) None\n");
+
+  // Eager validation reports errors in bodies which are never called
+  options.validate = true;
+  istringstream validated_input(program);
+  Parse::Lexer validated_lexer(validated_input);
+  ASSERT_THROWS(ParseProgram(validated_lexer, options), std::exception);
+}
+
+void TestLazyMethodsUnbalancedBody() {
+  ParseOptions options;
+  options.lazy_methods = true;
+
+  istringstream is("class A:\n  def f():\n  return 1\n");
+  Parse::Lexer lexer(is);
+  ASSERT_THROWS(ParseProgram(lexer, options), LexerError);
+
+  istringstream stream_input("class A:\n  def f():\n  return 1\n");
+  Parse::Lexer stream_lexer(make_shared<const TokenStream>(stream_input));
+  ASSERT_THROWS(ParseProgram(stream_lexer, options), LexerError);
+}
+
+
+namespace {
+
+// The output of the program or the error of the parser
+string ParseAndRun(const string& program, size_t threads, bool lazy_methods = false) {
+  ParseOptions options;
+  options.threads = threads;
+  options.lazy_methods = lazy_methods;
+
+  ostringstream os;
+  try {
+    istringstream is(program);
+    Parse::Lexer lexer(make_shared<const TokenStream>(is));
+    auto tree = ParseProgram(lexer, options);
+    Ast::Print::SetOutputStream(os);
+    Runtime::Closure closure;
+    tree->Execute(closure);
+  } catch (const exception& e) {
+    os << "error: " << e.what();
+  }
+  return os.str();
+}
+
+}
+
+void TestParallelClasses() {
+  const string program = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def __str__():
+    return self.name + ' ' + str(self.area())
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'rect'
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+count = 0
+
+class Square(Rect):
+  def __init__(a):
+    self.name = 'square'
+    self.w = a
+    self.h = a
+
+  def bigger():
+    return Rect(self.w + 1, self.h + 1)
+
+class Factory:
+  def make(n):
+    if n > 2:
+      return Square(n)
+    else:
+      return Rect(n, 2)
+
+f = Factory()
+s = f.make(5)
+print f.make(3), f.make(1), s.bigger()
+)";
+
+  const string expected = "square 9 rect 2 rect 36\n";
+  ASSERT_EQUAL(ParseAndRun(program, 1), expected);
+  for (size_t threads : {2, 4, 16}) {
+    ASSERT_EQUAL(ParseAndRun(program, threads), expected);
+    ASSERT_EQUAL(ParseAndRun(program, threads, true), expected);
+  }
+}
+
+void TestParallelClassesErrors() {
+  const string a = "class A:\n  def f():\n    return 1\n";
+  const string b = "class B(A):\n  def g():\n    return A()\n";
+  const vector<string> programs = {
+    // Base declared later
+    b + a,
+    // Duplicates
+    a + b + a,
+    a + "class A(A):\n  def f():\n    return 2\n",
+    // A class used before its declaration
+    "class C:\n  def f():\n    return D()\n" + a + "class D:\n  def f():\n    return 1\n",
+    // Syntax errors in bodies, the first one in program order wins
+    a + "class E:\n  def f():\n    return 1 +\n" + "class F:\n  def f(:\n    return 1\n",
+    a + "class E:\n  def f():\n    return 1\n  x = 1\n" + b,
+    // A statement before the errors
+    a + "print A().f(\n" + b + b,
+    // Nested class, parsed in order
+    a + "if True:\n  class G:\n    def f():\n      return 1\n" + b + "x = B()\nprint x.f()\n",
+    a + b + "x = B()\ny = x.g()\nprint y.f(), x.f()\n",
+  };
+  for (const auto& program : programs) {
+    const string expected = ParseAndRun(program, 1);
+    AssertEqual(ParseAndRun(program, 4), expected, program);
+    AssertEqual(ParseAndRun(program, 4, true), ParseAndRun(program, 1, true), program);
+  }
+  ASSERT_EQUAL(ParseAndRun(programs[0], 4), "error: Base class A not found for class B");
+  ASSERT_EQUAL(ParseAndRun(programs[1], 4), "error: Class A already exists");
+  ASSERT_EQUAL(ParseAndRun(programs.back(), 4), "1 1\n");
+}
 }
 
 void TestParseProgram(TestRunner& tr) {
@@ -516,4 +698,8 @@ void TestParseProgram(TestRunner& tr) {
   RUN_TEST(tr, Parse::TestInheritance2);
   RUN_TEST(tr, Parse::TestInheritance3);
   RUN_TEST(tr, Parse::TestInheritance4);
+  RUN_TEST(tr, Parse::TestLazyMethods);
+  RUN_TEST(tr, Parse::TestLazyMethodsUnbalancedBody);
+  RUN_TEST(tr, Parse::TestParallelClasses);
+  RUN_TEST(tr, Parse::TestParallelClassesErrors);
 }
@@ -0,0 +1,219 @@
+#include "profile.h"
+#include "object.h"
+#include "statement.h"
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Profile {
+
+// A counter and how many of its nodes are executing
+struct Active {
+  Counter counter;
+  size_t depth = 0;
+};
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct LocationKey {
+  int line;
+  type_index kind;
+
+  bool operator==(const LocationKey& other) const {
+    return line == other.line && kind == other.kind;
+  }
+};
+
+struct LocationHash {
+  size_t operator()(const LocationKey& key) const {
+    return hash<type_index>{}(key.kind) * 31 + key.line;
+  }
+};
+
+// Active entries are referred to by the samples, the maps keep their
+// addresses while they grow
+struct Data {
+  unordered_map<type_index, Active> kinds;
+  unordered_map<LocationKey, Active, LocationHash> locations;
+  // Keyed on the names joined by '\0'
+  unordered_map<string, Operands> operands;
+  string operand_key;
+};
+
+thread_local Data data;
+thread_local Sample* current = nullptr;
+
+string KindName(type_index kind) {
+  // Named by their aliases rather than the template
+  if (kind == typeid(Ast::NumericConst)) {
+    return "NumericConst";
+  } else if (kind == typeid(Ast::StringConst)) {
+    return "StringConst";
+  } else if (kind == typeid(Ast::BoolConst)) {
+    return "BoolConst";
+  }
+
+  int status = 0;
+  unique_ptr<char, void (*)(void*)> demangled(
+    abi::__cxa_demangle(kind.name(), nullptr, nullptr, &status), free
+  );
+  string name = status == 0 ? demangled.get() : kind.name();
+  for (const string_view prefix : {"Ast::", "Runtime::"}) {
+    for (size_t position; (position = name.find(prefix)) != string::npos; ) {
+      name.erase(position, prefix.size());
+    }
+  }
+  return name;
+}
+
+void WriteString(ostream& out, string_view value) {
+  out << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+void WriteEntries(ostream& out, const char* name, const vector<Entry>& entries, bool lines) {
+  out << "  \"" << name << "\": [";
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const Entry& entry = entries[i];
+    out << (i ? ",\n    " : "\n    ") << "{\"kind\": ";
+    WriteString(out, entry.kind);
+    if (lines) {
+      out << ", \"line\": " << entry.line;
+    }
+    out << ", \"executions\": " << entry.counter.executions
+        << ", \"self_ns\": " << entry.counter.self.count()
+        << ", \"total_ns\": " << entry.counter.total.count()
+        << ", \"allocations\": " << entry.counter.allocations << '}';
+  }
+  out << (entries.empty() ? "]" : "\n  ]");
+}
+
+} /* namespace */
+
+Sample::Sample(const type_info& kind_type, int line_)
+  : outer(current)
+  , line(line_ ? line_ : outer ? outer->line : 0)
+  , kind(&data.kinds[kind_type])
+  , location(&data.locations[LocationKey{line, kind_type}])
+{
+  for (Active* active : {kind, location}) {
+    ++active->counter.executions;
+    ++active->depth;
+  }
+  current = this;
+  start = Clock::now();
+}
+
+Sample::~Sample() {
+  const chrono::nanoseconds elapsed = Clock::now() - start;
+  for (Active* active : {kind, location}) {
+    active->counter.self += elapsed - nested;
+    if (--active->depth == 0) {
+      active->counter.total += elapsed;
+    }
+  }
+  if (outer) {
+    outer->nested += elapsed;
+  }
+  current = outer;
+}
+
+void CountAllocation() {
+  if (current) {
+    ++current->kind->counter.allocations;
+    ++current->location->counter.allocations;
+  }
+}
+
+void RecordOperands(const char* node, string_view left, string_view right) {
+  string& key = data.operand_key;
+  key.assign(node).append(1, '\0').append(left).append(1, '\0').append(right);
+  auto it = data.operands.find(key);
+  if (it == data.operands.end()) {
+    it = data.operands.emplace(key, Operands{node, string(left), string(right)}).first;
+  }
+  ++it->second.count;
+}
+
+string_view TypeName(const ObjectHolder& object) {
+  if (!object) {
+    return "None";
+  } else if (auto instance = object.TryAs<Runtime::ClassInstance>()) {
+    return instance->GetClass().GetName();
+  } else if (object.TryAs<Runtime::Number>()) {
+    return "Number";
+  } else if (object.TryAs<Runtime::String>()) {
+    return "String";
+  } else if (object.TryAs<Runtime::Bool>()) {
+    return "Bool";
+  } else if (object.TryAs<Runtime::Class>()) {
+    return "Class";
+  }
+  return "Object";
+}
+
+Report GetReport() {
+  Report report;
+  for (const auto& [kind, active] : data.kinds) {
+    report.kinds.push_back(Entry{KindName(kind), 0, active.counter});
+  }
+  for (const auto& [key, active] : data.locations) {
+    report.locations.push_back(Entry{KindName(key.kind), key.line, active.counter});
+  }
+  for (const auto& [key, operands] : data.operands) {
+    report.operands.push_back(operands);
+  }
+
+  auto hotter = [](const Entry& lhs, const Entry& rhs) {
+    return tie(rhs.counter.self, lhs.line, lhs.kind) < tie(lhs.counter.self, rhs.line, rhs.kind);
+  };
+  sort(report.kinds.begin(), report.kinds.end(), hotter);
+  sort(report.locations.begin(), report.locations.end(), hotter);
+  sort(report.operands.begin(), report.operands.end(), [](const Operands& lhs, const Operands& rhs) {
+    return tie(rhs.count, lhs.node, lhs.left, lhs.right) < tie(lhs.count, rhs.node, rhs.left, rhs.right);
+  });
+  return report;
+}
+
+void Reset() {
+  data = {};
+}
+
+void WriteJson(const Report& report, ostream& out) {
+  out << "{\n";
+  WriteEntries(out, "kinds", report.kinds, false);
+  out << ",\n";
+  WriteEntries(out, "locations", report.locations, true);
+  out << ",\n  \"operands\": [";
+  for (size_t i = 0; i < report.operands.size(); ++i) {
+    const Operands& operands = report.operands[i];
+    out << (i ? ",\n    " : "\n    ") << "{\"node\": ";
+    WriteString(out, operands.node);
+    out << ", \"left\": ";
+    WriteString(out, operands.left);
+    out << ", \"right\": ";
+    WriteString(out, operands.right);
+    out << ", \"count\": " << operands.count << '}';
+  }
+  out << (report.operands.empty() ? "]" : "\n  ]") << "\n}\n";
+}
+
+} /* namespace Profile */
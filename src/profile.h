@@ -0,0 +1,98 @@
+#pragma once
+
+#include "object_holder.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+
+class TestRunner;
+
+namespace Profile {
+
+// Execution profile of the tree-walking interpreter. A program run with
+// Ast::ExecuteProfiled records every node it executes here: the executions
+// and time per node kind and per source line, the objects the nodes own and
+// the operand types seen by additions, comparisons and method calls.
+// Profiling is a separate execute path of the nodes, so unprofiled runs
+// don't pay for it. Methods run by the JIT or traces aren't recorded.
+
+struct Counter {
+  size_t executions = 0;
+  // Time in the nodes themselves, without the nodes they execute
+  std::chrono::nanoseconds self{};
+  // Time including the nested nodes, a recursive node is counted once
+  std::chrono::nanoseconds total{};
+  // Objects created by the nodes with ObjectHolder::Own or Make
+  size_t allocations = 0;
+};
+
+struct Active;
+
+// Records the execution of a node while it's alive. Nodes without a line,
+// which are expressions, are located at the line of the enclosing node.
+class Sample {
+public:
+  Sample(const std::type_info& kind, int line);
+  ~Sample();
+
+  Sample(const Sample&) = delete;
+  Sample& operator=(const Sample&) = delete;
+
+private:
+  friend void CountAllocation();
+
+  Sample* outer;
+  int line;
+  Active* kind;
+  Active* location;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::nanoseconds nested{};
+};
+
+// An object owned by the node executing on the thread
+void CountAllocation();
+
+// The types of the operands of a node, or the receiver type and the method
+// of a call
+void RecordOperands(const char* node, std::string_view left, std::string_view right);
+
+// Name of the class of an instance, otherwise of the type of the object
+std::string_view TypeName(const ObjectHolder& object);
+
+struct Entry {
+  // Kind of the node without the namespace, like "MethodCall"
+  std::string kind;
+  // 0 in the totals per kind
+  int line = 0;
+  Counter counter;
+};
+
+struct Operands {
+  std::string node;
+  std::string left;
+  std::string right;
+  size_t count = 0;
+};
+
+// Kinds and locations are sorted by self time, the hottest first, operands
+// by count
+struct Report {
+  std::vector<Entry> kinds;
+  std::vector<Entry> locations;
+  std::vector<Operands> operands;
+};
+
+// The profile of the thread
+Report GetReport();
+void Reset();
+
+void WriteJson(const Report& report, std::ostream& out);
+
+void RunProfileTests(TestRunner& tr);
+
+} /* namespace Profile */
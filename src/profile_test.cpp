@@ -0,0 +1,165 @@
+#include "profile.h"
+#include "interpreter.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Profile {
+
+namespace {
+
+const string kProgram = R"(
+class Counter:
+  def __init__():
+    self.n = 0
+  def add(k):
+    self.n = self.n + k
+    return self.n
+
+c = Counter()
+s = 'a'
+if c.add(1) < 2:
+  s = s + 'b'
+c.add(2)
+print c.add(3), s
+)";
+
+// Runs the program profiled, returns its output and the profile
+string RunProfiled(const string& program, string& profile) {
+  // Methods run by the JIT or traces aren't profiled
+  EngineScope engine("interpreter");
+  istringstream input(program);
+  ostringstream output;
+  ostringstream json;
+  RunOptions options;
+  options.profile = &json;
+  RunMythonProgram(input, output, options, nullptr);
+  profile = json.str();
+  return output.str();
+}
+
+const Entry* FindEntry(const vector<Entry>& entries, const string& kind, int line = 0) {
+  auto it = find_if(begin(entries), end(entries), [&](const Entry& entry) {
+    return entry.kind == kind && entry.line == line;
+  });
+  return it == end(entries) ? nullptr : &*it;
+}
+
+size_t OperandCount(const Report& report, const string& node, const string& left, const string& right) {
+  for (const Operands& operands : report.operands) {
+    if (operands.node == node && operands.left == left && operands.right == right) {
+      return operands.count;
+    }
+  }
+  return 0;
+}
+
+}
+
+void TestNodeCounters() {
+  string json;
+  ASSERT_EQUAL(RunProfiled(kProgram, json), "6 ab\n");
+  const Report report = GetReport();
+
+  const Entry* calls = FindEntry(report.kinds, "MethodCall");
+  ASSERT(calls);
+  ASSERT_EQUAL(calls->counter.executions, 3u);
+  // The bodies of methods are executed with the program
+  const Entry* field_assignments = FindEntry(report.kinds, "FieldAssignment");
+  ASSERT(field_assignments);
+  ASSERT_EQUAL(field_assignments->counter.executions, 4u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "Return")->counter.executions, 3u);
+  ASSERT(!FindEntry(report.kinds, "Stringify"));
+
+  // The Compound of the program includes everything
+  const Entry* compound = FindEntry(report.kinds, "Compound");
+  ASSERT(compound);
+  for (const Entry& entry : report.kinds) {
+    ASSERT(entry.counter.total <= compound->counter.total);
+    ASSERT(entry.counter.self <= entry.counter.total);
+  }
+
+  // Statements are located at their lines, expressions at the line of
+  // their statement
+  ASSERT_EQUAL(FindEntry(report.locations, "MethodCall", 13)->counter.executions, 1u);
+  ASSERT_EQUAL(FindEntry(report.locations, "MethodCall", 14)->counter.executions, 1u);
+  ASSERT_EQUAL(FindEntry(report.locations, "FieldAssignment", 6)->counter.executions, 3u);
+  ASSERT_EQUAL(FindEntry(report.locations, "Add", 6)->counter.executions, 3u);
+  ASSERT_EQUAL(FindEntry(report.locations, "IfElse", 11)->counter.executions, 1u);
+  ASSERT_EQUAL(FindEntry(report.locations, "Comparison", 11)->counter.executions, 1u);
+  ASSERT(!FindEntry(report.locations, "MethodCall", 0));
+
+  // Sums and the results of comparisons are owned by their nodes
+  ASSERT_EQUAL(FindEntry(report.kinds, "Add")->counter.allocations, 4u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "Comparison")->counter.allocations, 1u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "NewInstance")->counter.allocations, 1u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "Assignment")->counter.allocations, 0u);
+
+  ASSERT_EQUAL(OperandCount(report, "Add", "Number", "Number"), 3u);
+  ASSERT_EQUAL(OperandCount(report, "Add", "String", "String"), 1u);
+  ASSERT_EQUAL(OperandCount(report, "Comparison", "Number", "Number"), 1u);
+  ASSERT_EQUAL(OperandCount(report, "MethodCall", "Counter", "add"), 3u);
+}
+
+void TestIntExpressions() {
+  string json;
+  // Nested arithmetic is computed without boxing, only its result is owned
+  ASSERT_EQUAL(RunProfiled("x = 4\nprint (2 + 3) * x - 1\n", json), "19\n");
+  const Report report = GetReport();
+  ASSERT_EQUAL(FindEntry(report.kinds, "Add")->counter.executions, 1u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "Add")->counter.allocations, 0u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "Sub")->counter.allocations, 1u);
+  ASSERT_EQUAL(FindEntry(report.locations, "VariableValue", 2)->counter.executions, 1u);
+  ASSERT_EQUAL(OperandCount(report, "Add", "Number", "Number"), 1u);
+  ASSERT_EQUAL(FindEntry(report.kinds, "NumericConst")->counter.executions, 4u);
+}
+
+void TestJson() {
+  string json;
+  RunProfiled("x = 1\nprint x\n", json);
+  ASSERT_EQUAL(json.substr(0, 13), "{\n  \"kinds\": ");
+  ASSERT(json.find("{\"kind\": \"Print\", \"line\": 2, \"executions\": 1, ") != string::npos);
+  ASSERT(json.find("\"operands\": []") != string::npos);
+
+  Report report;
+  report.kinds.push_back(Entry{"Add", 0, Counter{2, chrono::nanoseconds(5), chrono::nanoseconds(7), 1}});
+  report.operands.push_back(Operands{"MethodCall", "A\"", "f", 2});
+  ostringstream out;
+  WriteJson(report, out);
+  ASSERT_EQUAL(out.str(),
+    "{\n"
+    "  \"kinds\": [\n"
+    "    {\"kind\": \"Add\", \"executions\": 2, \"self_ns\": 5, \"total_ns\": 7, \"allocations\": 1}\n"
+    "  ],\n"
+    "  \"locations\": [],\n"
+    "  \"operands\": [\n"
+    "    {\"node\": \"MethodCall\", \"left\": \"A\\\"\", \"right\": \"f\", \"count\": 2}\n"
+    "  ]\n"
+    "}\n"
+  );
+}
+
+void TestUnprofiledRun() {
+  Reset();
+  istringstream input(kProgram);
+  ostringstream output;
+  RunMythonProgram(input, output, RunOptions{}, nullptr);
+  ASSERT_EQUAL(output.str(), "6 ab\n");
+  ASSERT(GetReport().kinds.empty());
+  ASSERT(GetReport().operands.empty());
+}
+
+void RunProfileTests(TestRunner& tr) {
+  RUN_TEST(tr, Profile::TestNodeCounters);
+  RUN_TEST(tr, Profile::TestIntExpressions);
+  RUN_TEST(tr, Profile::TestJson);
+  RUN_TEST(tr, Profile::TestUnprofiledRun);
+}
+
+} /* namespace Profile */
@@ -0,0 +1,216 @@
+#include "scanner.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Parse::Scan {
+
+namespace {
+
+bool IsSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool IsIdentifier(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) || c == '_';
+}
+
+#if defined(__AVX2__)
+
+#define MYTHON_SCAN_VECTOR 1
+using Vector = __m256i;
+const size_t kWidth = 32;
+const uint32_t kAllBytes = 0xFFFFFFFFu;
+
+Vector Load(const char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+Vector Splat(char c) {
+  return _mm256_set1_epi8(c);
+}
+
+Vector Equal(Vector lhs, Vector rhs) {
+  return _mm256_cmpeq_epi8(lhs, rhs);
+}
+
+Vector Greater(Vector lhs, Vector rhs) {
+  return _mm256_cmpgt_epi8(lhs, rhs);
+}
+
+Vector Or(Vector lhs, Vector rhs) {
+  return _mm256_or_si256(lhs, rhs);
+}
+
+Vector And(Vector lhs, Vector rhs) {
+  return _mm256_and_si256(lhs, rhs);
+}
+
+uint32_t Mask(Vector v) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+
+#elif defined(__SSE2__)
+
+#define MYTHON_SCAN_VECTOR 1
+using Vector = __m128i;
+const size_t kWidth = 16;
+const uint32_t kAllBytes = 0xFFFFu;
+
+Vector Load(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+Vector Splat(char c) {
+  return _mm_set1_epi8(c);
+}
+
+Vector Equal(Vector lhs, Vector rhs) {
+  return _mm_cmpeq_epi8(lhs, rhs);
+}
+
+Vector Greater(Vector lhs, Vector rhs) {
+  return _mm_cmpgt_epi8(lhs, rhs);
+}
+
+Vector Or(Vector lhs, Vector rhs) {
+  return _mm_or_si128(lhs, rhs);
+}
+
+Vector And(Vector lhs, Vector rhs) {
+  return _mm_and_si128(lhs, rhs);
+}
+
+uint32_t Mask(Vector v) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+
+#endif
+
+#ifdef MYTHON_SCAN_VECTOR
+
+// Bytes are compared as signed, so bytes from 0x80 are below every ASCII range
+Vector InRange(Vector v, char low, char high) {
+  return And(Greater(v, Splat(low - 1)), Greater(Splat(high + 1), v));
+}
+
+Vector Spaces(Vector v) {
+  return Or(Equal(v, Splat(' ')), InRange(v, '\t', '\r'));
+}
+
+Vector Digits(Vector v) {
+  return InRange(v, '0', '9');
+}
+
+Vector Identifiers(Vector v) {
+  // Setting bit 5 maps upper case letters to lower case ones
+  Vector letters = InRange(Or(v, Splat(0x20)), 'a', 'z');
+  return Or(Or(letters, Digits(v)), Equal(v, Splat('_')));
+}
+
+#endif
+
+// StopMask returns the mask of the bytes of a block which end the run
+template <typename StopMask, typename IsStop>
+const char* Scan(const char* begin, const char* end, [[maybe_unused]] StopMask stop_mask, IsStop is_stop) {
+#ifdef MYTHON_SCAN_VECTOR
+  while (static_cast<size_t>(end - begin) >= kWidth) {
+    if (uint32_t mask = stop_mask(Load(begin))) {
+      return begin + __builtin_ctz(mask);
+    }
+    begin += kWidth;
+  }
+#endif
+  while (begin != end && !is_stop(*begin)) {
+    ++begin;
+  }
+  return begin;
+}
+
+} /* namespace */
+
+#ifdef MYTHON_SCAN_VECTOR
+
+const char* FindLineEnd(const char* begin, const char* end) {
+  return Scan(begin, end, [](Vector v) {
+    return Mask(Equal(v, Splat('\n')));
+  }, [](char c) {
+    return c == '\n';
+  });
+}
+
+const char* SkipSpaces(const char* begin, const char* end) {
+  return Scan(begin, end, [](Vector v) {
+    return ~Mask(Spaces(v)) & kAllBytes;
+  }, [](char c) {
+    return !IsSpace(c);
+  });
+}
+
+const char* SkipIdentifier(const char* begin, const char* end) {
+  return Scan(begin, end, [](Vector v) {
+    return ~Mask(Identifiers(v)) & kAllBytes;
+  }, [](char c) {
+    return !IsIdentifier(c);
+  });
+}
+
+const char* SkipDigits(const char* begin, const char* end) {
+  return Scan(begin, end, [](Vector v) {
+    return ~Mask(Digits(v)) & kAllBytes;
+  }, [](char c) {
+    return !IsDigit(c);
+  });
+}
+
+const char* FindQuoteOrLineEnd(const char* begin, const char* end, char quote) {
+  return Scan(begin, end, [quote](Vector v) {
+    return Mask(Or(Equal(v, Splat(quote)), Equal(v, Splat('\n'))));
+  }, [quote](char c) {
+    return c == quote || c == '\n';
+  });
+}
+
+#else
+
+const char* FindLineEnd(const char* begin, const char* end) {
+  return Scan(begin, end, nullptr, [](char c) { return c == '\n'; });
+}
+
+const char* SkipSpaces(const char* begin, const char* end) {
+  return Scan(begin, end, nullptr, [](char c) { return !IsSpace(c); });
+}
+
+const char* SkipIdentifier(const char* begin, const char* end) {
+  return Scan(begin, end, nullptr, [](char c) { return !IsIdentifier(c); });
+}
+
+const char* SkipDigits(const char* begin, const char* end) {
+  return Scan(begin, end, nullptr, [](char c) { return !IsDigit(c); });
+}
+
+const char* FindQuoteOrLineEnd(const char* begin, const char* end, char quote) {
+  return Scan(begin, end, nullptr, [quote](char c) { return c == quote || c == '\n'; });
+}
+
+#endif
+
+const char* Implementation() {
+#if defined(__AVX2__)
+  return "avx2";
+#elif defined(__SSE2__)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+} /* namespace Parse::Scan */
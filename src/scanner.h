@@ -0,0 +1,32 @@
+#pragma once
+
+class TestRunner;
+
+// Character class scans over a contiguous source buffer, used by the lexer.
+// Each function looks at [begin, end) and returns a pointer to the first byte
+// which ends the run, or end. The buffer is processed 32 bytes at a time with
+// AVX2 (when compiled with -mavx2), 16 bytes at a time with SSE2, and one byte
+// at a time on other targets and for the tails.
+namespace Parse::Scan {
+
+// '\n'
+const char* FindLineEnd(const char* begin, const char* end);
+
+// The first byte which isn't whitespace in the sense of isspace
+const char* SkipSpaces(const char* begin, const char* end);
+
+// The first byte which isn't [A-Za-z0-9_]
+const char* SkipIdentifier(const char* begin, const char* end);
+
+// The first byte which isn't [0-9]
+const char* SkipDigits(const char* begin, const char* end);
+
+// The first quote or '\n'
+const char* FindQuoteOrLineEnd(const char* begin, const char* end, char quote);
+
+// "avx2", "sse2" or "scalar"
+const char* Implementation();
+
+void RunScannerTests(TestRunner& tr);
+
+} /* namespace Parse::Scan */
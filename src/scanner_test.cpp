@@ -0,0 +1,123 @@
+#include "scanner.h"
+#include "lexer.h"
+#include "test_runner.h"
+
+#include <cctype>
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Parse::Scan {
+
+namespace {
+
+template <typename IsStop>
+ptrdiff_t Reference(const string& s, size_t from, IsStop is_stop) {
+  while (from < s.size() && !is_stop(static_cast<unsigned char>(s[from]))) {
+    ++from;
+  }
+  return static_cast<ptrdiff_t>(from);
+}
+
+// Checks every scan from every position of s against a byte by byte loop
+void CheckAllPositions(const string& s) {
+  const char* begin = s.data();
+  const char* end = begin + s.size();
+  for (size_t i = 0; i <= s.size(); ++i) {
+    const string hint = "position " + to_string(i) + " of " + to_string(s.size());
+    AssertEqual(FindLineEnd(begin + i, end) - begin,
+                Reference(s, i, [](int c) { return c == '\n'; }), hint);
+    AssertEqual(SkipSpaces(begin + i, end) - begin,
+                Reference(s, i, [](int c) { return !isspace(c); }), hint);
+    AssertEqual(SkipIdentifier(begin + i, end) - begin,
+                Reference(s, i, [](int c) { return !isalnum(c) && c != '_'; }), hint);
+    AssertEqual(SkipDigits(begin + i, end) - begin,
+                Reference(s, i, [](int c) { return !isdigit(c); }), hint);
+    AssertEqual(FindQuoteOrLineEnd(begin + i, end, '"') - begin,
+                Reference(s, i, [](int c) { return c == '"' || c == '\n'; }), hint);
+    AssertEqual(FindQuoteOrLineEnd(begin + i, end, '\'') - begin,
+                Reference(s, i, [](int c) { return c == '\'' || c == '\n'; }), hint);
+  }
+}
+
+} /* namespace */
+
+void TestRunsAcrossBlocks() {
+  // Runs ending in the first block, at block boundaries and in the tail
+  for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100}) {
+    CheckAllPositions(string(length, 'a') + " 1");
+    CheckAllPositions(string(length, ' ') + "x");
+    CheckAllPositions(string(length, '7') + "\"\n");
+  }
+}
+
+void TestCharacterClassBoundaries() {
+  // Every byte value, including the ones around the ranges and the ones from 0x80
+  string s;
+  for (int c = 0; c < 256; ++c) {
+    s += string(20, 'b');
+    s += static_cast<char>(c);
+  }
+  CheckAllPositions(s);
+}
+
+void TestRandomBuffers() {
+  mt19937 generator(33);
+  const string alphabet = "aZz_09 \t\r\n\"'\\\x0b\x0c@`[{/:\x80\xff";
+  for (int i = 0; i < 200; ++i) {
+    string s(uniform_int_distribution<size_t>(0, 150)(generator), ' ');
+    // Long runs of one class make the vector paths skip whole blocks
+    const size_t run = uniform_int_distribution<size_t>(1, 40)(generator);
+    for (size_t j = 0; j < s.size(); ++j) {
+      if (j % run == 0 || generator() % 8 == 0) {
+        s[j] = alphabet[generator() % alphabet.size()];
+      } else {
+        s[j] = s[j - 1];
+      }
+    }
+    CheckAllPositions(s);
+  }
+}
+
+void TestLexerOverLongLines() {
+  // Tokens longer than a block and lines which cross several blocks
+  const string id(70, 'x');
+  const string digits = "000000000000000000000000000000000000123";
+  const string text(40, 'q');
+  istringstream input(
+    "class A:\n"
+    "  def f():\n"
+    "    " + id + " = " + digits + string(50, ' ') + "+ 'a\\'" + text + "'\n"
+    "    print \"" + text + "\\\"\"\n"
+  );
+  Lexer lexer(input);
+  while (!lexer.NextToken().Is<TokenType::Def>()) {
+  }
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Id{"f"}));
+  while (!lexer.NextToken().Is<TokenType::Indent>()) {
+  }
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Id{id}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Char{'='}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Number{123}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Char{'+'}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::String{"a\\'" + text}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Newline{}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Print{}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::String{text + "\\\""}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Newline{}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Dedent{}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Dedent{}));
+  ASSERT_EQUAL(lexer.NextToken(), Token(TokenType::Eof{}));
+}
+
+void RunScannerTests(TestRunner& tr) {
+  RUN_TEST(tr, Parse::Scan::TestRunsAcrossBlocks);
+  RUN_TEST(tr, Parse::Scan::TestCharacterClassBoundaries);
+  RUN_TEST(tr, Parse::Scan::TestRandomBuffers);
+  RUN_TEST(tr, Parse::Scan::TestLexerOverLongLines);
+}
+
+} /* namespace Parse::Scan */
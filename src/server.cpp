@@ -0,0 +1,286 @@
+#include "server.h"
+#include "server_protocol.h"
+#include "cache.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <unordered_map>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Server {
+
+using namespace Protocol;
+
+namespace {
+
+const uint32_t kMaxScriptSize = 256u << 20;
+
+// Idle copies of a program kept for later requests
+const size_t kMaxIdlePrograms = 8;
+
+// Sends everything written to it as output frames
+class OutputBuffer : public streambuf {
+public:
+  explicit OutputBuffer(int fd) : fd(fd) {
+    setp(buffer, buffer + sizeof(buffer));
+  }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (sync() != 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  int sync() override {
+    if (pptr() == pbase()) {
+      return 0;
+    }
+    try {
+      SendFrame(fd, 'O', string_view(pbase(), pptr() - pbase()));
+    } catch (const ServerError&) {
+      return -1;
+    }
+    setp(buffer, buffer + sizeof(buffer));
+    return 0;
+  }
+
+private:
+  int fd;
+  char buffer[4096];
+};
+
+} /* namespace */
+
+class ProgramCache {
+public:
+  struct Entry {
+    string source;
+    string compiled;
+    mutex idle_mutex;
+    vector<unique_ptr<Ast::Statement>> idle;
+  };
+
+  // Returns the program to the cache when the request is done with it
+  class Lease {
+  public:
+    Lease(shared_ptr<Entry> entry, unique_ptr<Ast::Statement> program)
+      : entry(move(entry))
+      , program(move(program))
+    {
+    }
+
+    Lease(Lease&&) = default;
+
+    ~Lease() {
+      if (!entry || !program) {
+        return;
+      }
+      lock_guard guard(entry->idle_mutex);
+      if (entry->idle.size() < kMaxIdlePrograms) {
+        entry->idle.push_back(move(program));
+      }
+    }
+
+    Ast::Statement& operator*() const {
+      return *program;
+    }
+
+  private:
+    shared_ptr<Entry> entry;
+    unique_ptr<Ast::Statement> program;
+  };
+
+  Lease Acquire(const string& source) {
+    const uint64_t hash = Cache::HashSource(source);
+
+    shared_ptr<Entry> entry;
+    {
+      lock_guard guard(entries_mutex);
+      if (auto it = entries.find(hash); it != entries.end()) {
+        entry = it->second;
+      }
+    }
+
+    if (entry && entry->source == source) {
+      {
+        lock_guard guard(entry->idle_mutex);
+        if (!entry->idle.empty()) {
+          auto program = move(entry->idle.back());
+          entry->idle.pop_back();
+          return {entry, move(program)};
+        }
+      }
+      return {entry, Cache::Read(entry->compiled, source)};
+    } else if (entry) {
+      // Hash collision, the program isn't cached
+      return {nullptr, Parse(source)};
+    }
+
+    auto program = Parse(source);
+    entry = make_shared<Entry>();
+    entry->source = source;
+    ostringstream compiled;
+    Cache::Write(*program, source, compiled);
+    entry->compiled = compiled.str();
+    {
+      lock_guard guard(entries_mutex);
+      entry = entries.emplace(hash, entry).first->second;
+    }
+    return {entry, move(program)};
+  }
+
+private:
+  mutex entries_mutex;
+  unordered_map<uint64_t, shared_ptr<Entry>> entries;
+
+  static unique_ptr<Ast::Statement> Parse(const string& source) {
+    Parse::Lexer lexer(source);
+    return ParseProgram(lexer);
+  }
+};
+
+Daemon::Daemon(string socket_path, size_t worker_count)
+  : socket_path(move(socket_path))
+  , programs(make_unique<ProgramCache>())
+{
+  sockaddr_un address = SocketAddress(this->socket_path);
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    throw ServerError(ErrorText("socket"));
+  }
+
+  unlink(this->socket_path.c_str());
+  if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+      || listen(listen_fd, SOMAXCONN) != 0) {
+    string error = ErrorText("Can't listen on " + this->socket_path);
+    close(listen_fd);
+    throw ServerError(error);
+  }
+
+  had_threaded_counts = ObjectHolder::HasThreadedCounts();
+  if (worker_count > 1) {
+    ObjectHolder::SetThreadedCounts(true);
+  }
+  for (size_t i = 0; i < max<size_t>(worker_count, 1); ++i) {
+    workers.emplace_back([this] { Work(); });
+  }
+}
+
+Daemon::~Daemon() {
+  Stop();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  ObjectHolder::SetThreadedCounts(had_threaded_counts);
+  for (int fd : connections) {
+    close(fd);
+  }
+  close(listen_fd);
+  unlink(socket_path.c_str());
+}
+
+void Daemon::Run() {
+  while (!stopping) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+
+    lock_guard guard(mutex);
+    connections.push_back(fd);
+    has_connections.notify_one();
+  }
+}
+
+void Daemon::Stop() {
+  {
+    lock_guard guard(mutex);
+    stopping = true;
+  }
+  // Wakes up accept in Run
+  shutdown(listen_fd, SHUT_RDWR);
+  has_connections.notify_all();
+}
+
+void Daemon::Work() {
+  while (true) {
+    int fd;
+    {
+      unique_lock lock(mutex);
+      has_connections.wait(lock, [this] {
+        return stopping || !connections.empty();
+      });
+      if (connections.empty()) {
+        return;
+      }
+      fd = connections.front();
+      connections.pop_front();
+    }
+
+    try {
+      Serve(fd);
+    } catch (const ServerError&) {
+      // The client went away
+    }
+    close(fd);
+  }
+}
+
+void Daemon::Serve(int fd) {
+  uint32_t size;
+  if (!ReceiveAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > kMaxScriptSize) {
+    return;
+  }
+  string script(size, '\0');
+  if (!ReceiveAll(fd, script.data(), size)) {
+    return;
+  }
+
+  OutputBuffer buffer(fd);
+  ostream output(&buffer);
+  Ast::Print::SetOutputStream(output);
+
+  string error;
+  try {
+    auto program = programs->Acquire(script);
+    Runtime::Closure closure;
+    (*program).Execute(closure);
+  } catch (const exception& e) {
+    error = e.what();
+    if (error.empty()) {
+      error = "Error";
+    }
+  } catch (...) {
+    error = "Unknown error";
+  }
+
+  output.flush();
+  Ast::Print::SetOutputStream(cout);
+  if (!error.empty()) {
+    SendFrame(fd, 'E', error);
+  }
+  SendFrame(fd, 'X', {});
+}
+
+} /* namespace Server */
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class TestRunner;
+
+namespace Server {
+
+// Warm interpreter daemon. Clients connect to a Unix domain socket and send a
+// script; a worker thread runs it in a fresh closure and streams its output
+// back. Parsed programs are kept per source hash and reused by later requests
+// of the same script, together with the JIT code and traces attached to their
+// methods; a program is run by one request at a time, concurrent requests of
+// the same script get copies decoded from its compiled form. With several
+// workers the counts of objects are atomic while the daemon exists, see
+// Runtime::Object.
+//
+// Protocol: the request is a 4-byte length and the script. Mython programs
+// have no way to read input, so nothing else is sent; the client sends its
+// stdin as the script when it isn't given a file. The response is a
+// sequence of frames, a one-byte type and a 4-byte length followed by the
+// payload: 'O' for output, 'E' for the error message of a failed script and
+// 'X', without payload, at the end.
+const char kDefaultSocket[] = "/tmp/mython.sock";
+
+struct ServerError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+class ProgramCache;
+
+class Daemon {
+public:
+  Daemon(std::string socket_path, size_t workers);
+  ~Daemon();
+
+  // Accepts connections until Stop is called
+  void Run();
+  void Stop();
+
+private:
+  std::string socket_path;
+  int listen_fd = -1;
+  std::unique_ptr<ProgramCache> programs;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable has_connections;
+  std::deque<int> connections;
+  std::atomic<bool> stopping = false;
+  bool had_threaded_counts;
+
+  void Work();
+  void Serve(int fd);
+};
+
+// Runs the script on the daemon, its output goes to out. Returns false and
+// writes the error to err if the script failed.
+bool Execute(const std::string& socket_path, std::string_view script, std::ostream& out, std::ostream& err);
+
+void RunServerTests(TestRunner& tr);
+
+} /* namespace Server */
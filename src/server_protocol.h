@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <sys/un.h>
+
+// Socket helpers shared by the daemon and the client
+namespace Server::Protocol {
+
+// Prefixes the message with the description of errno
+std::string ErrorText(const std::string& what);
+
+// Throws ServerError if the peer has gone away
+void SendAll(int fd, const char* data, size_t size);
+void SendFrame(int fd, char type, std::string_view payload);
+
+// Returns false if the connection was closed first
+bool ReceiveAll(int fd, char* data, size_t size);
+
+sockaddr_un SocketAddress(const std::string& path);
+
+} /* namespace Server::Protocol */
@@ -0,0 +1,100 @@
+#include "server.h"
+#include "object_holder.h"
+
+#include "test_runner.h"
+
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Server {
+
+const string kProgram = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    if n > 0:
+      self.value = self.value + n
+      self.add(n - 1)
+    return self.value
+
+c = Counter()
+print c.add(10)
+print 'done'
+)";
+
+string SocketPath() {
+  return (filesystem::temp_directory_path() / ("mython-test-" + to_string(getpid()) + ".sock")).string();
+}
+
+void TestExecute() {
+  const string path = SocketPath();
+  Daemon daemon(path, 2);
+  thread server([&daemon] { daemon.Run(); });
+
+  for (int i = 0; i < 3; ++i) {
+    ostringstream out, err;
+    ASSERT(Execute(path, kProgram, out, err));
+    ASSERT_EQUAL(out.str(), "55\ndone\n");
+    ASSERT_EQUAL(err.str(), "");
+  }
+
+  ostringstream out, err;
+  ASSERT(!Execute(path, "print 1\nprint x\n", out, err));
+  ASSERT_EQUAL(out.str(), "1\n");
+  ASSERT_EQUAL(err.str(), "Not found: x\n");
+
+  daemon.Stop();
+  server.join();
+}
+
+void TestConcurrentClients() {
+  const string path = SocketPath();
+  auto daemon = make_unique<Daemon>(path, 4);
+  ASSERT(ObjectHolder::HasThreadedCounts());
+  thread server([&daemon] { daemon->Run(); });
+
+  vector<string> outputs(8);
+  vector<thread> clients;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    clients.emplace_back([&, i] {
+      string program = i % 2 ? kProgram : "print " + to_string(i) + "\n";
+      for (int j = 0; j < 5; ++j) {
+        ostringstream out, err;
+        Execute(path, program, out, err);
+        outputs[i] += out.str();
+      }
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    string expected = i % 2 ? "55\ndone\n" : to_string(i) + "\n";
+    string repeated;
+    for (int j = 0; j < 5; ++j) {
+      repeated += expected;
+    }
+    ASSERT_EQUAL(outputs[i], repeated);
+  }
+
+  daemon->Stop();
+  server.join();
+  daemon.reset();
+  ASSERT(!ObjectHolder::HasThreadedCounts());
+}
+
+void RunServerTests(TestRunner& tr) {
+  RUN_TEST(tr, Server::TestExecute);
+  RUN_TEST(tr, Server::TestConcurrentClients);
+}
+
+} /* namespace Server */
@@ -1,5 +1,8 @@
 #include "statement.h"
 #include "object.h"
+#include "comparators.h"
+#include "profile.h"
+#include "trace.h"
 
 #include <iostream>
 #include <sstream>
@@ -11,11 +14,128 @@ namespace Ast {
 
 using Runtime::Closure;
 
-ObjectHolder Assignment::Execute(Closure& closure) {
-	closure[var_name] = right_value->Execute(closure);
+namespace {
+
+// How a node executes its children and creates objects. Execute runs with
+// Plain, which compiles to the calls it wraps, ExecuteProfiled with Profiled,
+// which also records them in the profile of the thread.
+struct Plain {
+	static ObjectHolder Execute(Statement& statement, Closure& closure) {
+		return statement.Execute(closure);
+	}
+
+	static int ExecuteInt(Statement& statement, Closure& closure) {
+		return statement.ExecuteInt(closure);
+	}
+
+	template <typename T>
+	static ObjectHolder Own(T&& object) {
+		return ObjectHolder::Own(forward<T>(object));
+	}
+
+	static ObjectHolder MakeInstance(const Runtime::Class& cls) {
+		return ObjectHolder::Make<Runtime::ClassInstance>(cls);
+	}
+
+	static void Operands(const char*, const ObjectHolder&, const ObjectHolder&) {
+	}
+
+	static void NumberOperands(const char*) {
+	}
+
+	static void Call(const ObjectHolder&, const string&) {
+	}
+};
+
+struct Profiled {
+	static ObjectHolder Execute(Statement& statement, Closure& closure) {
+		Profile::Sample sample(typeid(statement), statement.line);
+		return statement.ExecuteProfiled(closure);
+	}
+
+	static int ExecuteInt(Statement& statement, Closure& closure) {
+		Profile::Sample sample(typeid(statement), statement.line);
+		return statement.ExecuteIntProfiled(closure);
+	}
+
+	template <typename T>
+	static ObjectHolder Own(T&& object) {
+		Profile::CountAllocation();
+		return ObjectHolder::Own(forward<T>(object));
+	}
+
+	static ObjectHolder MakeInstance(const Runtime::Class& cls) {
+		Profile::CountAllocation();
+		return ObjectHolder::Make<Runtime::ClassInstance>(cls);
+	}
+
+	static void Operands(const char* node, const ObjectHolder& left, const ObjectHolder& right) {
+		Profile::RecordOperands(node, Profile::TypeName(left), Profile::TypeName(right));
+	}
+
+	static void NumberOperands(const char* node) {
+		Profile::RecordOperands(node, "Number", "Number");
+	}
+
+	static void Call(const ObjectHolder& receiver, const string& method) {
+		Profile::RecordOperands("MethodCall", Profile::TypeName(receiver), method);
+	}
+};
+
+// Whether the program executing on the thread is profiled, so that method
+// bodies are executed with Profiled too
+thread_local bool profiling = false;
+
+int ToInt(const ObjectHolder& object) {
+	if (auto number = object.TryAs<Runtime::Number>()) {
+		return number->GetValue();
+	}
+	throw runtime_error("Not number");
+}
+
+}
+
+// Execute and ExecuteProfiled declared by MYTHON_EXECUTE_WITH_POLICY
+#define MYTHON_DEFINE_EXECUTE(Node) \
+	ObjectHolder Node::Execute(Closure& closure) { \
+		return Run<Plain>(closure); \
+	} \
+	\
+	ObjectHolder Node::ExecuteProfiled(Closure& closure) { \
+		return Run<Profiled>(closure); \
+	}
+
+int Statement::ExecuteInt(Closure& closure) {
+	return ToInt(Execute(closure));
+}
+
+int Statement::ExecuteIntProfiled(Closure& closure) {
+	return ToInt(ExecuteProfiled(closure));
+}
+
+ObjectHolder ExecuteProfiled(Statement& program, Closure& closure) {
+	struct Scope {
+		bool outer = profiling;
+
+		Scope() {
+			profiling = true;
+		}
+		~Scope() {
+			profiling = outer;
+		}
+	} scope;
+
+	return Profiled::Execute(program, closure);
+}
+
+template <typename Policy>
+ObjectHolder Assignment::Run(Closure& closure) {
+	closure[var_name] = Policy::Execute(*right_value, closure);
 	return closure[var_name];
 }
 
+MYTHON_DEFINE_EXECUTE(Assignment)
+
 Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
 	: var_name(move(var)),
 		right_value(move(rv)) {}
@@ -55,7 +175,8 @@ Print::Print(unique_ptr<Statement> argument) {
 Print::Print(vector<unique_ptr<Statement>> args)
 	: args(move(args)) {}
 
-ObjectHolder Print::Execute(Closure& closure) {
+template <typename Policy>
+ObjectHolder Print::Run(Closure& closure) {
 	bool first = true;
 	for (auto& arg : args) {
 		if (!first) {
@@ -63,14 +184,19 @@ ObjectHolder Print::Execute(Closure& closure) {
 		}
 		first = false;
 
-		arg = make_unique<Stringify>(move(arg));
-		arg->Execute(closure)->Print(*output);
+		if (ObjectHolder object = Policy::Execute(*arg, closure)) {
+			object->Print(*output);
+		} else {
+			*output << "None";
+		}
 	}
 	*output << '\n';
 	return ObjectHolder::None();
 }
 
-ostream* Print::output = &cout;
+MYTHON_DEFINE_EXECUTE(Print)
+
+thread_local ostream* Print::output = &cout;
 
 void Print::SetOutputStream(ostream& output_stream) {
   output = &output_stream;
@@ -84,56 +210,187 @@ MethodCall::MethodCall(
 		method(move(method)),
 		args(move(args)) {}
 
-ObjectHolder MethodCall::Execute(Closure& closure) {
-	vector<ObjectHolder> actual_args;
-	actual_args.reserve(args.size());
-	for (const auto& arg : args) {
-		actual_args.push_back(arg->Execute(closure));
+namespace {
+
+thread_local InlineStats inline_stats;
+
+// The expression a method body returns if that's all it does
+Statement* ReturnedExpression(Statement* body) {
+	if (auto compound = dynamic_cast<Compound*>(body)) {
+		if (compound->GetStatements().size() != 1) {
+			return nullptr;
+		}
+		body = compound->GetStatements().front().get();
+		if (auto ret = dynamic_cast<Return*>(body)) {
+			return ret->GetStatement();
+		}
+		return nullptr;
+	}
+	if (auto ret = dynamic_cast<Return*>(body)) {
+		return ret->GetStatement();
 	}
+	return body;
+}
 
-	ObjectHolder holder = object->Execute(closure).TryAs<Runtime::ClassInstance>()->Call(method, actual_args);
-	return holder;
+bool IsSelf(const VariableValue& variable) {
+	return variable.dotted_ids.size() == 1 && variable.dotted_ids[0] == "self";
+}
+
+}
+
+void MethodCall::ResolveAccessor(const Runtime::Class& cls) {
+	inline_class = &cls;
+	accessor = Accessor::None;
+
+	const Runtime::Method* target = cls.GetMethod(method);
+	if (!target || target->native || target->memo || target->formal_params.size() != args.size()) {
+		return;
+	}
+	target->ParseBody();
+
+	if (Statement* returned = ReturnedExpression(target->body.get())) {
+		auto variable = dynamic_cast<VariableValue*>(returned);
+		if (args.empty() && variable && variable->dotted_ids.size() == 2 && variable->dotted_ids[0] == "self") {
+			accessor = Accessor::Getter;
+			field = &variable->dotted_ids[1];
+		} else if (args.empty() && (
+			dynamic_cast<NumericConst*>(returned) || dynamic_cast<StringConst*>(returned)
+			|| dynamic_cast<BoolConst*>(returned) || dynamic_cast<None*>(returned)
+		)) {
+			accessor = Accessor::Constant;
+			constant = returned;
+		}
+	} else if (auto compound = dynamic_cast<Compound*>(target->body.get());
+		compound && compound->GetStatements().size() == 1 && args.size() == 1) {
+		auto assignment = dynamic_cast<FieldAssignment*>(compound->GetStatements().front().get());
+		auto value = assignment ? dynamic_cast<VariableValue*>(assignment->right_value.get()) : nullptr;
+		if (value && IsSelf(assignment->object)
+			&& value->dotted_ids.size() == 1 && value->dotted_ids[0] == target->formal_params[0]) {
+			accessor = Accessor::Setter;
+			field = &assignment->field_name;
+		}
+	}
+
+	if (accessor != Accessor::None && !inlined) {
+		inlined = true;
+		++inline_stats.sites;
+	}
+}
+
+ObjectHolder MethodCall::ExecuteAccessor(
+	Runtime::ClassInstance& instance, Runtime::Arguments actual_args, Closure& closure
+) {
+	++inline_stats.calls;
+	switch (accessor) {
+		case Accessor::Getter: {
+			Closure& fields = instance.Fields();
+			if (auto it = fields.find(*field); it != fields.end()) {
+				return it->second;
+			}
+			throw runtime_error("Not found: " + *field);
+		}
+		case Accessor::Setter:
+			instance.Fields()[*field] = actual_args[0];
+			return ObjectHolder::None();
+		case Accessor::Constant:
+			return constant->Execute(closure);
+		case Accessor::None:
+			break;
+	}
+	throw runtime_error("Not an accessor: " + method);
+}
+
+template <typename Policy>
+ObjectHolder MethodCall::Run(Closure& closure) {
+	Runtime::ArgumentFrame actual_args(args.size());
+	for (size_t i = 0; i < args.size(); ++i) {
+		actual_args[i] = Policy::Execute(*args[i], closure);
+	}
+
+	ObjectHolder holder = Policy::Execute(*object, closure);
+	Policy::Call(holder, method);
+	Runtime::ClassInstance* instance = holder.TryAs<Runtime::ClassInstance>();
+	if (instance && &instance->GetClass() != inline_class) {
+		ResolveAccessor(instance->GetClass());
+	}
+	if (instance && accessor != Accessor::None) {
+		return ExecuteAccessor(*instance, actual_args.GetArguments(), closure);
+	}
+	if (Trace::IsEnabled() && executions++ >= Trace::GetThreshold()) {
+		return Trace::Call(*instance, method, actual_args.GetArguments());
+	}
+	return instance->Call(method, actual_args.GetArguments());
+}
+
+MYTHON_DEFINE_EXECUTE(MethodCall)
+
+const InlineStats& GetInlineStats() {
+	return inline_stats;
+}
+
+void ResetInlineStats() {
+	inline_stats = {};
 }
 
-ObjectHolder Stringify::Execute(Closure& closure) {
-	ObjectHolder object = argument->Execute(closure);
+template <typename Policy>
+ObjectHolder Stringify::Run(Closure& closure) {
+	ObjectHolder object = Policy::Execute(*argument, closure);
 	ostringstream out;
 	if (object) {
 		object->Print(out);
 	} else {
 		out << "None";
 	}
-	return ObjectHolder::Own(Runtime::String(out.str()));
+	return Policy::Own(Runtime::String(out.str()));
 }
 
-ObjectHolder Add::Execute(Closure& closure) {
+MYTHON_DEFINE_EXECUTE(Stringify)
+
+Add::Add(unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
+	: BinaryOperation(move(lhs), move(rhs))
+	, int_operands(this->lhs->IsIntExpression() && this->rhs->IsIntExpression())
+{
+}
+
+template <typename Policy>
+ObjectHolder Add::Run(Closure& closure) {
+	if (int_operands) {
+		return Policy::Own(Runtime::Number(RunInt<Policy>(closure)));
+	}
+	ObjectHolder left = Policy::Execute(*lhs, closure);
+	ObjectHolder right = Policy::Execute(*rhs, closure);
+	Policy::Operands("Add", left, right);
+	return Sum<Policy>(left, right);
+}
+
+MYTHON_DEFINE_EXECUTE(Add)
+
+ObjectHolder Add::Evaluate(const ObjectHolder& left, const ObjectHolder& right) {
+	return Sum<Plain>(left, right);
+}
+
+template <typename Policy>
+ObjectHolder Add::Sum(const ObjectHolder& left, const ObjectHolder& right) {
 	using Runtime::Number;
 	using Runtime::String;
 	using Runtime::ClassInstance;
 
-	ObjectHolder left = lhs->Execute(closure);
-	ObjectHolder right = rhs->Execute(closure);
-
 	if (!left || !right) {
 		throw runtime_error("Add None");
 	}
 
-	if (left.TryAs<ClassInstance>()) {
-		ClassInstance* object = left.TryAs<ClassInstance>();
-		if (object->HasMethod("__add__", 1)) {
-			return object->Call("__add__", {right});
-		} else {
-			throw runtime_error("Not found __add__");
+	if (ClassInstance* object = left.TryAs<ClassInstance>()) {
+		if (const Runtime::Method* add = object->GetClass().GetSlots().add) {
+			return object->Call(*add, {right});
 		}
+		throw runtime_error("Not found __add__");
 	}
 
-	if (right.TryAs<ClassInstance>()) {
-		ClassInstance* object = right.TryAs<ClassInstance>();
-		if (object->HasMethod("__add__", 1)) {
-			return object->Call("__add__", {left});
-		} else {
-			throw runtime_error("Not found __add__");
+	if (ClassInstance* object = right.TryAs<ClassInstance>()) {
+		if (const Runtime::Method* add = object->GetClass().GetSlots().add) {
+			return object->Call(*add, {left});
 		}
+		throw runtime_error("Not found __add__");
 	}
 
 	if (left.TryAs<Number>()) {
@@ -142,54 +399,208 @@ ObjectHolder Add::Execute(Closure& closure) {
 		}
 		int l = left.TryAs<Number>()->GetValue();
 		int r = right.TryAs<Number>()->GetValue();
-		return ObjectHolder::Own(Number(l + r));
+		return Policy::Own(Number(l + r));
 	}
 
 	if (left.TryAs<String>()) {
 		if (!right.TryAs<String>()) {
 			throw runtime_error("Not string");
 		}
-		string l = left.TryAs<String>()->GetValue();
-		string r = right.TryAs<String>()->GetValue();
-		return ObjectHolder::Own(String(l + r));
+		return Policy::Own(String::Concat(*left.TryAs<String>(), *right.TryAs<String>()));
 	}
 
 	throw runtime_error("Error add operation");
 }
 
-ObjectHolder Sub::Execute(Closure& closure) {
-	using Runtime::Number;
+template <typename Policy>
+int Add::RunInt(Closure& closure) {
+	if (!int_operands) {
+		return ToInt(Run<Policy>(closure));
+	}
+	Policy::NumberOperands("Add");
+	int left = Policy::ExecuteInt(*lhs, closure);
+	return left + Policy::ExecuteInt(*rhs, closure);
+}
 
-	int left = lhs->Execute(closure).TryAs<Number>()->GetValue();
-	int right = rhs->Execute(closure).TryAs<Number>()->GetValue();
-	return ObjectHolder::Own(Number(left - right));
+int Add::ExecuteInt(Closure& closure) {
+	return RunInt<Plain>(closure);
 }
 
-ObjectHolder Mult::Execute(Runtime::Closure& closure) {
-	using Runtime::Number;
+int Add::ExecuteIntProfiled(Closure& closure) {
+	return RunInt<Profiled>(closure);
+}
 
-	int left = lhs->Execute(closure).TryAs<Number>()->GetValue();
-	int right = rhs->Execute(closure).TryAs<Number>()->GetValue();
-	return ObjectHolder::Own(Number(left * right));
+ObjectHolder IntOperation::Execute(Closure& closure) {
+	return Plain::Own(Runtime::Number(ExecuteInt(closure)));
 }
 
-ObjectHolder Div::Execute(Runtime::Closure& closure) {
-	using Runtime::Number;
+ObjectHolder IntOperation::ExecuteProfiled(Closure& closure) {
+	return Profiled::Own(Runtime::Number(ExecuteIntProfiled(closure)));
+}
+
+int IntOperation::Operand(const ObjectHolder& object) {
+	return ToInt(object);
+}
 
-	int left = lhs->Execute(closure).TryAs<Number>()->GetValue();
-	int right = rhs->Execute(closure).TryAs<Number>()->GetValue();
-	return ObjectHolder::Own(Number(left / right));
+template <typename Policy>
+int Sub::RunInt(Closure& closure) {
+	int left = Policy::ExecuteInt(*lhs, closure);
+	return left - Policy::ExecuteInt(*rhs, closure);
 }
 
-ObjectHolder Compound::Execute(Closure& closure) {
+int Sub::ExecuteInt(Closure& closure) {
+	return RunInt<Plain>(closure);
+}
+
+int Sub::ExecuteIntProfiled(Closure& closure) {
+	return RunInt<Profiled>(closure);
+}
+
+template <typename Policy>
+int Mult::RunInt(Closure& closure) {
+	int left = Policy::ExecuteInt(*lhs, closure);
+	return left * Policy::ExecuteInt(*rhs, closure);
+}
+
+int Mult::ExecuteInt(Closure& closure) {
+	return RunInt<Plain>(closure);
+}
+
+int Mult::ExecuteIntProfiled(Closure& closure) {
+	return RunInt<Profiled>(closure);
+}
+
+template <typename Policy>
+int Div::RunInt(Closure& closure) {
+	int left = Policy::ExecuteInt(*lhs, closure);
+	return Evaluate(left, Policy::ExecuteInt(*rhs, closure));
+}
+
+int Div::ExecuteInt(Closure& closure) {
+	return RunInt<Plain>(closure);
+}
+
+int Div::ExecuteIntProfiled(Closure& closure) {
+	return RunInt<Profiled>(closure);
+}
+
+int Div::Evaluate(int left, int right) {
+	if (right == 0) {
+		throw runtime_error("Division by zero");
+	}
+	return left / right;
+}
+
+namespace {
+
+// The method whose body is being executed on the thread, whether its body
+// has executed a Return which its statements haven't passed up yet, and the
+// receiver and arguments if that was a tail call
+thread_local const Runtime::Method* current_method = nullptr;
+thread_local bool return_pending = false;
+thread_local bool tail_call_pending = false;
+thread_local ObjectHolder tail_call_self;
+thread_local vector<ObjectHolder> tail_call_args;
+
+}
+
+template <typename Policy>
+ObjectHolder Compound::Run(Closure& closure) {
 	for (const auto& stmt : statements) {
-		stmt->Execute(closure);
+		ObjectHolder result = Policy::Execute(*stmt, closure);
+		if (return_pending) {
+			return result;
+		}
 	}
 	return ObjectHolder::None();
 }
 
-ObjectHolder Return::Execute(Closure& closure) {
-	throw statement->Execute(closure);
+MYTHON_DEFINE_EXECUTE(Compound)
+
+Return::Return(std::unique_ptr<Statement> statement_) : statement(move(statement_)) {
+	if (auto call = dynamic_cast<MethodCall*>(statement.get())) {
+		auto receiver = dynamic_cast<VariableValue*>(call->object.get());
+		if (receiver && receiver->dotted_ids.size() == 1 && receiver->dotted_ids[0] == "self") {
+			self_call = call;
+		}
+	}
+}
+
+template <typename Policy>
+ObjectHolder Return::Run(Closure& closure) {
+	if (!current_method) {
+		throw runtime_error("Return outside of a method");
+	}
+	const Runtime::Method& method = *current_method;
+	const bool tail_call = self_call
+		&& self_call->method == method.name
+		&& self_call->args.size() == method.formal_params.size()
+		&& !method.memo;
+	ObjectHolder result = tail_call ? ExecuteTailCall<Policy>(closure) : Policy::Execute(*statement, closure);
+	return_pending = true;
+	return result;
+}
+
+MYTHON_DEFINE_EXECUTE(Return)
+
+template <typename Policy>
+ObjectHolder Return::ExecuteTailCall(Closure& closure) {
+	// Evaluated in the order of MethodCall::Execute
+	Runtime::ArgumentFrame actual_args(self_call->args.size());
+	for (size_t i = 0; i < self_call->args.size(); ++i) {
+		actual_args[i] = Policy::Execute(*self_call->args[i], closure);
+	}
+	ObjectHolder receiver = Policy::Execute(*self_call->object, closure);
+	Policy::Call(receiver, self_call->method);
+	auto instance = receiver.TryAs<Runtime::ClassInstance>();
+	if (!instance) {
+		throw runtime_error("Not a class instance: self");
+	}
+	if (instance->GetClass().GetMethod(self_call->method) != current_method) {
+		// Overridden by the class of self
+		return instance->Call(self_call->method, actual_args.GetArguments());
+	}
+
+	tail_call_pending = true;
+	tail_call_self = move(receiver);
+	tail_call_args.clear();
+	for (size_t i = 0; i < self_call->args.size(); ++i) {
+		tail_call_args.push_back(move(actual_args[i]));
+	}
+	return ObjectHolder::None();
+}
+
+ObjectHolder Return::ExecuteBody(const Runtime::Method& method, Closure& closure) {
+	struct Scope {
+		const Runtime::Method* outer_method = current_method;
+
+		explicit Scope(const Runtime::Method& method) {
+			current_method = &method;
+		}
+		~Scope() {
+			current_method = outer_method;
+			return_pending = false;
+			tail_call_pending = false;
+		}
+	} scope(method);
+
+	while (true) {
+		ObjectHolder result = profiling
+			? Profiled::Execute(*method.body, closure)
+			: method.body->Execute(closure);
+		if (!tail_call_pending) {
+			return result;
+		}
+		return_pending = false;
+		tail_call_pending = false;
+
+		closure.clear();
+		closure.emplace("self", move(tail_call_self));
+		for (size_t i = 0; i < tail_call_args.size(); ++i) {
+			closure.emplace(method.formal_params[i], move(tail_call_args[i]));
+		}
+		tail_call_args.clear();
+	}
 }
 
 ClassDefinition::ClassDefinition(ObjectHolder class_)
@@ -209,13 +620,16 @@ FieldAssignment::FieldAssignment(
 {
 }
 
-ObjectHolder FieldAssignment::Execute(Runtime::Closure& closure) {
-	ObjectHolder holder = object.Execute(closure);
+template <typename Policy>
+ObjectHolder FieldAssignment::Run(Runtime::Closure& closure) {
+	ObjectHolder holder = Policy::Execute(object, closure);
 	auto object_instance = holder.TryAs<Runtime::ClassInstance>();
-	object_instance->Fields()[field_name] = right_value->Execute(closure);
+	object_instance->Fields()[field_name] = Policy::Execute(*right_value, closure);
 	return object_instance->Fields()[field_name];
 }
 
+MYTHON_DEFINE_EXECUTE(FieldAssignment)
+
 IfElse::IfElse(
   std::unique_ptr<Statement> condition,
   std::unique_ptr<Statement> if_body,
@@ -227,48 +641,93 @@ IfElse::IfElse(
 {
 }
 
-ObjectHolder IfElse::Execute(Runtime::Closure& closure) {
-	if (Runtime::IsTrue(condition->Execute(closure))) {
-		return if_body->Execute(closure);
+template <typename Policy>
+ObjectHolder IfElse::Run(Runtime::Closure& closure) {
+	if (Runtime::IsTrue(Policy::Execute(*condition, closure))) {
+		return Policy::Execute(*if_body, closure);
 	} else {
 		if (else_body) {
-			return else_body->Execute(closure);
+			return Policy::Execute(*else_body, closure);
 		} else {
 			return ObjectHolder::None();
 		}
 	}
 }
 
-ObjectHolder Or::Execute(Runtime::Closure& closure) {
-	bool left = Runtime::IsTrue(lhs->Execute(closure));
-	bool right = Runtime::IsTrue(rhs->Execute(closure));
-	return ObjectHolder::Own(Runtime::Bool(left || right));
+MYTHON_DEFINE_EXECUTE(IfElse)
+
+template <typename Policy>
+ObjectHolder Or::Run(Runtime::Closure& closure) {
+	bool left = Runtime::IsTrue(Policy::Execute(*lhs, closure));
+	bool right = Runtime::IsTrue(Policy::Execute(*rhs, closure));
+	return Policy::Own(Runtime::Bool(left || right));
 }
 
-ObjectHolder And::Execute(Runtime::Closure& closure) {
-	bool left = Runtime::IsTrue(lhs->Execute(closure));
-	bool right = Runtime::IsTrue(rhs->Execute(closure));
-	return ObjectHolder::Own(Runtime::Bool(left && right));
+MYTHON_DEFINE_EXECUTE(Or)
+
+template <typename Policy>
+ObjectHolder And::Run(Runtime::Closure& closure) {
+	bool left = Runtime::IsTrue(Policy::Execute(*lhs, closure));
+	bool right = Runtime::IsTrue(Policy::Execute(*rhs, closure));
+	return Policy::Own(Runtime::Bool(left && right));
+}
+
+MYTHON_DEFINE_EXECUTE(And)
+
+template <typename Policy>
+ObjectHolder Not::Run(Runtime::Closure& closure) {
+	bool arg = Runtime::IsTrue(Policy::Execute(*argument, closure));
+	return Policy::Own(Runtime::Bool(!arg));
+}
+
+MYTHON_DEFINE_EXECUTE(Not)
+
+namespace {
+
+Comparison::Kind ClassifyComparator(const Comparison::Comparator& comparator) {
+	using Function = bool (*)(const ObjectHolder&, const ObjectHolder&);
+
+	auto function = comparator.target<Function>();
+	if (!function) {
+		return Comparison::Kind::Custom;
+	}
+	if (*function == Runtime::Equal) {
+		return Comparison::Kind::Equal;
+	} else if (*function == Runtime::NotEqual) {
+		return Comparison::Kind::NotEqual;
+	} else if (*function == Runtime::Less) {
+		return Comparison::Kind::Less;
+	} else if (*function == Runtime::Greater) {
+		return Comparison::Kind::Greater;
+	} else if (*function == Runtime::LessOrEqual) {
+		return Comparison::Kind::LessOrEqual;
+	} else if (*function == Runtime::GreaterOrEqual) {
+		return Comparison::Kind::GreaterOrEqual;
+	}
+	return Comparison::Kind::Custom;
 }
 
-ObjectHolder Not::Execute(Runtime::Closure& closure) {
-	bool arg = Runtime::IsTrue(argument->Execute(closure));
-	return ObjectHolder::Own(Runtime::Bool(!arg));
 }
 
 Comparison::Comparison(
   Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
 	: comparator(move(cmp)),
+		kind(ClassifyComparator(comparator)),
 		left(move(lhs)),
 		right(move(rhs))
 {
 }
 
-ObjectHolder Comparison::Execute(Runtime::Closure& closure) {
-	bool result = comparator(left->Execute(closure), right->Execute(closure));
-	return ObjectHolder::Own<Runtime::Bool>(move(result));
+template <typename Policy>
+ObjectHolder Comparison::Run(Runtime::Closure& closure) {
+	ObjectHolder lhs = Policy::Execute(*left, closure);
+	ObjectHolder rhs = Policy::Execute(*right, closure);
+	Policy::Operands("Comparison", lhs, rhs);
+	return Policy::Own(Runtime::Bool(comparator(lhs, rhs)));
 }
 
+MYTHON_DEFINE_EXECUTE(Comparison)
+
 NewInstance::NewInstance(
   const Runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args
 )
@@ -281,22 +740,25 @@ NewInstance::NewInstance(const Runtime::Class& class_) : NewInstance(class_, {})
 
 }
 
-ObjectHolder NewInstance::Execute(Runtime::Closure& closure) {
-	ObjectHolder holder = ObjectHolder::Own(Runtime::ClassInstance(class_));
+template <typename Policy>
+ObjectHolder NewInstance::Run(Runtime::Closure& closure) {
+	ObjectHolder holder = Policy::MakeInstance(class_);
 	Runtime::ClassInstance* object = holder.TryAs<Runtime::ClassInstance>();
 
-	if (object->HasMethod("__init__", args.size())) {
-		vector<ObjectHolder> actual_args;
-		actual_args.reserve(args.size());
-		for (const auto& arg : args) {
-			actual_args.push_back(arg->Execute(closure));
+	const Runtime::Method* init = class_.GetSlots().init;
+	if (init && init->formal_params.size() == args.size()) {
+		Runtime::ArgumentFrame actual_args(args.size());
+		for (size_t i = 0; i < args.size(); ++i) {
+			actual_args[i] = Policy::Execute(*args[i], closure);
 		}
 
-		object->Call("__init__", actual_args);
+		object->Call(*init, actual_args.GetArguments());
 	}
 
 	return holder;
 }
 
+MYTHON_DEFINE_EXECUTE(NewInstance)
+
 
 } /* namespace Ast */
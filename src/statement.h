@@ -7,6 +7,7 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 
@@ -14,20 +15,71 @@ class TestRunner;
 
 namespace Ast {
 
+// Declares Execute and ExecuteProfiled of a node, which statement.cpp defines
+// with MYTHON_DEFINE_EXECUTE as its Run with the Plain and Profiled policies.
+// Leaves the class in its private section.
+#define MYTHON_EXECUTE_WITH_POLICY \
+public: \
+  ObjectHolder Execute(Runtime::Closure& closure) override; \
+  ObjectHolder ExecuteProfiled(Runtime::Closure& closure) override; \
+  \
+private: \
+  template <typename Policy> \
+  ObjectHolder Run(Runtime::Closure& closure)
+
 struct Statement {
   virtual ~Statement() = default;
   virtual ObjectHolder Execute(Runtime::Closure& closure) = 0;
+
+  // Value of an expression which must be a Number. Arithmetic overrides it
+  // to compute nested operations without boxing the intermediate results.
+  virtual int ExecuteInt(Runtime::Closure& closure);
+
+  // Execute and ExecuteInt recording the nodes executed in the profile of
+  // the thread, see ExecuteProfiled below. Nodes with children share one
+  // template for both paths, parameterized by how they execute the children.
+  virtual ObjectHolder ExecuteProfiled(Runtime::Closure& closure) {
+    return Execute(closure);
+  }
+
+  virtual int ExecuteIntProfiled(Runtime::Closure& closure);
+
+  // Whether ExecuteInt is the value of Execute for any operands
+  virtual bool IsIntExpression() const {
+    return false;
+  }
+
+  // Line of a statement in the source, 0 for an expression
+  int line = 0;
 };
 
+// The value is owned by the node and the holders it returns, so it outlives
+// the node, e.g. a top-level statement dropped after streaming execution
 template <typename T>
 struct ValueStatement : Statement {
-  T value;
+  ObjectHolder holder;
+  T& value;
 
-  explicit ValueStatement(T v) : value(std::move(v)) {
+  explicit ValueStatement(T v)
+    : holder(ObjectHolder::Own(std::move(v)))
+    , value(static_cast<T&>(*holder))
+  {
   }
 
   ObjectHolder Execute(Runtime::Closure&) override {
-    return ObjectHolder::Share(value);
+    return holder;
+  }
+
+  int ExecuteInt(Runtime::Closure& closure) override {
+    if constexpr (std::is_same_v<T, Runtime::Number>) {
+      return value.GetValue();
+    } else {
+      return Statement::ExecuteInt(closure);
+    }
+  }
+
+  bool IsIntExpression() const override {
+    return std::is_same_v<T, Runtime::Number>;
   }
 };
 
@@ -48,7 +100,8 @@ struct Assignment : Statement {
   std::unique_ptr<Statement> right_value;
 
   Assignment(std::string var, std::unique_ptr<Statement> rv);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 struct FieldAssignment : Statement {
@@ -57,7 +110,8 @@ struct FieldAssignment : Statement {
   std::unique_ptr<Statement> right_value;
 
   FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 struct None : Statement {
@@ -73,19 +127,25 @@ public:
 
   static std::unique_ptr<Print> Variable(std::string name);
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
-
   static void SetOutputStream(std::ostream& output_stream);
 
+  const std::vector<std::unique_ptr<Statement>>& GetArgs() const {
+    return args;
+  }
+
 private:
   std::vector<std::unique_ptr<Statement>> args;
-  static std::ostream* output;
+  // Per thread, so that concurrently running programs write to their own streams
+  static thread_local std::ostream* output;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 struct MethodCall : Statement {
   std::unique_ptr<Statement> object;
   std::string method;
   std::vector<std::unique_ptr<Statement>> args;
+  size_t executions = 0;
 
   MethodCall(
     std::unique_ptr<Statement> object,
@@ -93,16 +153,48 @@ struct MethodCall : Statement {
     std::vector<std::unique_ptr<Statement>> args
   );
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+private:
+  enum class Accessor {
+    None,
+    Getter,
+    Setter,
+    Constant,
+  };
+
+  const Runtime::Class* inline_class = nullptr;
+  Accessor accessor = Accessor::None;
+  const std::string* field = nullptr;
+  Statement* constant = nullptr;
+  bool inlined = false;
+
+  // A method whose body only returns a field of self, assigns its argument
+  // to a field of self or returns a constant is executed without a call,
+  // while the receiver has the class it was resolved for
+  MYTHON_EXECUTE_WITH_POLICY;
+
+  void ResolveAccessor(const Runtime::Class& cls);
+  ObjectHolder ExecuteAccessor(
+    Runtime::ClassInstance& instance, Runtime::Arguments actual_args, Runtime::Closure& closure
+  );
 };
 
+// Calls of accessors executed by MethodCall without a call, counted per thread
+struct InlineStats {
+  size_t sites = 0;
+  size_t calls = 0;
+};
+
+const InlineStats& GetInlineStats();
+void ResetInlineStats();
+
 struct NewInstance : Statement {
   const Runtime::Class& class_;
   std::vector<std::unique_ptr<Statement>> args;
 
   NewInstance(const Runtime::Class& class_);
   NewInstance(const Runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class UnaryOperation : public Statement {
@@ -110,6 +202,10 @@ public:
   UnaryOperation(std::unique_ptr<Statement> argument) : argument(std::move(argument)) {
   }
 
+  Statement* GetArgument() const {
+    return argument.get();
+  }
+
 protected:
   std::unique_ptr<Statement> argument;
 };
@@ -117,7 +213,8 @@ protected:
 class Stringify : public UnaryOperation {
 public:
   using UnaryOperation::UnaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class BinaryOperation : public Statement {
@@ -128,50 +225,113 @@ public:
   {
   }
 
+  Statement* GetLhs() const {
+    return lhs.get();
+  }
+
+  Statement* GetRhs() const {
+    return rhs.get();
+  }
+
 protected:
   std::unique_ptr<Statement> lhs, rhs;
 };
 
 class Add : public BinaryOperation {
 public:
-  using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  Add(std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+  int ExecuteInt(Runtime::Closure& closure) override;
+  int ExecuteIntProfiled(Runtime::Closure& closure) override;
+
+  bool IsIntExpression() const override {
+    return int_operands;
+  }
+
+  static ObjectHolder Evaluate(const ObjectHolder& left, const ObjectHolder& right);
+
+private:
+  // Both operands are numbers, so no __add__ or strings are involved
+  bool int_operands;
+
+  MYTHON_EXECUTE_WITH_POLICY;
+
+  template <typename Policy>
+  int RunInt(Runtime::Closure& closure);
+
+  template <typename Policy>
+  static ObjectHolder Sum(const ObjectHolder& left, const ObjectHolder& right);
 };
 
-class Sub : public BinaryOperation {
+// Sub, Mult and Div only accept numbers
+class IntOperation : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
   ObjectHolder Execute(Runtime::Closure& closure) override;
+  ObjectHolder ExecuteProfiled(Runtime::Closure& closure) override;
+
+  bool IsIntExpression() const override {
+    return true;
+  }
+
+  // The value of an operand, throws if it's not a number
+  static int Operand(const ObjectHolder& object);
 };
 
-class Mult : public BinaryOperation {
+class Sub : public IntOperation {
 public:
-  using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  using IntOperation::IntOperation;
+  int ExecuteInt(Runtime::Closure& closure) override;
+  int ExecuteIntProfiled(Runtime::Closure& closure) override;
+
+private:
+  template <typename Policy>
+  int RunInt(Runtime::Closure& closure);
 };
 
-class Div : public BinaryOperation {
+class Mult : public IntOperation {
 public:
-  using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  using IntOperation::IntOperation;
+  int ExecuteInt(Runtime::Closure& closure) override;
+  int ExecuteIntProfiled(Runtime::Closure& closure) override;
+
+private:
+  template <typename Policy>
+  int RunInt(Runtime::Closure& closure);
+};
+
+class Div : public IntOperation {
+public:
+  using IntOperation::IntOperation;
+  int ExecuteInt(Runtime::Closure& closure) override;
+  int ExecuteIntProfiled(Runtime::Closure& closure) override;
+
+  // Throws on division by zero
+  static int Evaluate(int left, int right);
+
+private:
+  template <typename Policy>
+  int RunInt(Runtime::Closure& closure);
 };
 
 class Or : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class And : public BinaryOperation {
 public:
   using BinaryOperation::BinaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class Not : public UnaryOperation {
 public:
   using UnaryOperation::UnaryOperation;
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class Compound : public Statement {
@@ -189,23 +349,41 @@ public:
   	return statements;
   }
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
-
 private:
   std::vector<std::unique_ptr<Statement>> statements;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class Return : public Statement {
 public:
-  explicit Return(std::unique_ptr<Statement> statement)
-    : statement(std::move(statement))
-  {
+  explicit Return(std::unique_ptr<Statement> statement);
+
+  Statement* GetStatement() const {
+    return statement.get();
   }
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  // The returned expression if it's a call of a method of self
+  MethodCall* GetSelfCall() const {
+    return self_call;
+  }
+
+  // The body is executed with the policy of the program, see ExecuteProfiled
+  static ObjectHolder ExecuteBody(const Runtime::Method& method, Runtime::Closure& closure);
 
 private:
   std::unique_ptr<Statement> statement;
+  MethodCall* self_call = nullptr;
+
+  // Executing a Return doesn't throw: the enclosing statements stop and pass
+  // its value up to the method call, which runs the body with ExecuteBody.
+  // A self call of the executing method in tail position isn't nested: its
+  // arguments are passed up instead, and ExecuteBody runs the body again
+  // with a new closure.
+  MYTHON_EXECUTE_WITH_POLICY;
+
+  template <typename Policy>
+  ObjectHolder ExecuteTailCall(Runtime::Closure& closure);
 };
 
 class ClassDefinition : public Statement {
@@ -214,6 +392,10 @@ public:
 
   ObjectHolder Execute(Runtime::Closure& closure) override;
 
+  const Runtime::Class& GetClass() const {
+    return *cls.TryAs<Runtime::Class>();
+  }
+
 private:
   ObjectHolder cls;
   const std::string& class_name;
@@ -227,29 +409,73 @@ public:
     std::unique_ptr<Statement> else_body
   );
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  Statement* GetCondition() const {
+    return condition.get();
+  }
+
+  Statement* GetIfBody() const {
+    return if_body.get();
+  }
+
+  Statement* GetElseBody() const {
+    return else_body.get();
+  }
 
 private:
   std::unique_ptr<Statement> condition, if_body, else_body;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
 class Comparison : public Statement {
 public:
   using Comparator = std::function<bool(const ObjectHolder&, const ObjectHolder&)>;
 
+  // Which of the comparators from comparators.h is used, if any
+  enum class Kind {
+    Custom,
+    Equal,
+    NotEqual,
+    Less,
+    Greater,
+    LessOrEqual,
+    GreaterOrEqual,
+  };
+
   Comparison(
     Comparator cmp,
     std::unique_ptr<Statement> lhs,
     std::unique_ptr<Statement> rhs
   );
 
-  ObjectHolder Execute(Runtime::Closure& closure) override;
+  const Comparator& GetComparator() const {
+    return comparator;
+  }
+
+  Kind GetKind() const {
+    return kind;
+  }
+
+  Statement* GetLeft() const {
+    return left.get();
+  }
+
+  Statement* GetRight() const {
+    return right.get();
+  }
 
 private:
   Comparator comparator;
+  Kind kind;
   std::unique_ptr<Statement> left, right;
+
+  MYTHON_EXECUTE_WITH_POLICY;
 };
 
+// Executes a program recording its nodes and the bodies of the methods it
+// calls in the profile of the thread, see profile.h
+ObjectHolder ExecuteProfiled(Statement& program, Runtime::Closure& closure);
+
 void RunUnitTests(TestRunner& tr);
 
 }
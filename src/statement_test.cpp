@@ -1,4 +1,5 @@
 #include "statement.h"
+#include "comparators.h"
 
 #include "test_runner.h"
 
@@ -265,6 +266,82 @@ void TestClassInstanceAddWithoutMethod() {
   ASSERT_THROWS(addition.Execute(empty), std::runtime_error);
 }
 
+void TestClassInstanceComparison() {
+  // Instances of Base equal 1 and are less than 2, Derived inherits that
+  auto compare_to = [](int value) {
+    return make_unique<Comparison>(
+      Runtime::Equal, make_unique<VariableValue>("other"), make_unique<NumericConst>(value)
+    );
+  };
+  vector<Runtime::Method> methods;
+  methods.push_back({"__eq__", {"other"}, compare_to(1)});
+  methods.push_back({"__lt__", {"other"}, compare_to(2)});
+  Runtime::Class base("Base", std::move(methods), nullptr);
+  Runtime::Class derived("Derived", {}, &base);
+  ASSERT(derived.GetSlots().eq == base.GetSlots().eq);
+
+  Closure empty;
+  auto compare = [&empty](Comparison::Comparator cmp, const Runtime::Class& cls, int value) {
+    return Runtime::IsTrue(
+      Comparison(std::move(cmp), make_unique<NewInstance>(cls), make_unique<NumericConst>(value)).Execute(empty)
+    );
+  };
+  ASSERT(compare(Runtime::Equal, derived, 1));
+  ASSERT(!compare(Runtime::Equal, derived, 2));
+  ASSERT(compare(Runtime::NotEqual, base, 2));
+  ASSERT(compare(Runtime::Less, base, 2));
+  ASSERT(!compare(Runtime::Less, base, 3));
+  ASSERT(compare(Runtime::Greater, derived, 3));
+  ASSERT(compare(Runtime::LessOrEqual, derived, 1));
+
+  // Methods with other arities are not slots
+  vector<Runtime::Method> unary;
+  unary.push_back({"__eq__", {}, make_unique<BoolConst>(Runtime::Bool(true))});
+  Runtime::Class other("Other", std::move(unary), nullptr);
+  ASSERT(!other.GetSlots().eq);
+  ASSERT(!compare(Runtime::Equal, other, 1));
+}
+
+void TestIntArithmetic() {
+  // a * b + c * d - e / f
+  auto mult = [](const char* l, const char* r) {
+    return make_unique<Mult>(make_unique<VariableValue>(l), make_unique<VariableValue>(r));
+  };
+  Sub expression(
+    make_unique<Add>(mult("a", "b"), mult("c", "d")),
+    make_unique<Div>(make_unique<VariableValue>("e"), make_unique<VariableValue>("f"))
+  );
+
+  Closure closure;
+  int value = 2;
+  for (const char* name : {"a", "b", "c", "d", "e", "f"}) {
+    closure[name] = ObjectHolder::Own(Runtime::Number(value++));
+  }
+
+  ASSERT(expression.IsIntExpression());
+  ASSERT_EQUAL(expression.ExecuteInt(closure), 2 * 3 + 4 * 5 - 6 / 7);
+  ASSERT_OBJECT_VALUE_EQUAL(expression.Execute(closure), 26);
+
+  Add strings(make_unique<StringConst>("a"s), make_unique<StringConst>("b"s));
+  ASSERT(!strings.IsIntExpression());
+  ASSERT_THROWS(strings.ExecuteInt(closure), std::runtime_error);
+  ASSERT_THROWS(
+    Sub(make_unique<StringConst>("4"s), make_unique<NumericConst>(1)).Execute(closure),
+    std::runtime_error
+  );
+}
+
+void TestDivisionByZero() {
+  Closure closure;
+  closure["zero"] = ObjectHolder::Own(Runtime::Number(0));
+  ASSERT_THROWS(
+    Div(make_unique<NumericConst>(1), make_unique<VariableValue>("zero")).Execute(closure),
+    std::runtime_error
+  );
+  ASSERT_THROWS(Div::Evaluate(5, 0), std::runtime_error);
+  ASSERT_EQUAL(Div::Evaluate(-7, 2), -3);
+}
+
 void TestCompound() {
   Compound cpd{
     make_unique<Assignment>("x", make_unique<StringConst>("one"s)),
@@ -296,6 +373,9 @@ void RunUnitTests(TestRunner& tr) {
   RUN_TEST(tr, Ast::TestBadAddition);
   RUN_TEST(tr, Ast::TestSuccessfullClassInstanceAdd);
   RUN_TEST(tr, Ast::TestClassInstanceAddWithoutMethod);
+  RUN_TEST(tr, Ast::TestClassInstanceComparison);
+  RUN_TEST(tr, Ast::TestIntArithmetic);
+  RUN_TEST(tr, Ast::TestDivisionByZero);
   RUN_TEST(tr, Ast::TestCompound);
 }
 
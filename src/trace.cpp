@@ -0,0 +1,854 @@
+#include "trace.h"
+#include "metrics.h"
+#include "object.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+namespace Trace {
+
+namespace {
+
+bool enabled = false;
+size_t threshold = 100;
+ostream* dump = nullptr;
+thread_local Stats stats;
+
+const size_t kMaxTracesPerMethod = 4;
+const size_t kMaxAbortsPerMethod = 3;
+const size_t kMaxInlineDepth = 8;
+
+using Runtime::ClassInstance;
+using Runtime::Number;
+using CompareKind = Ast::Comparison::Kind;
+
+enum class Op {
+  LoadObject,
+  LoadNone,
+  LoadInt,
+  Field,
+  Box,
+  BoxBool,
+  GuardNumber,
+  GuardTrue,
+  GuardFalse,
+  GuardClass,
+  Unbox,
+  IntAdd,
+  IntSub,
+  IntMult,
+  IntDiv,
+  IntCompare,
+  Truth,
+  IntTruth,
+  Not,
+  And,
+  Or,
+  AddObjects,
+  Compare,
+  SetField,
+  Call,
+  Interpret,
+  Return,
+};
+
+// Where a value lives during trace execution. Ints and Bools are unboxed
+// in the integer register file.
+enum class Kind {
+  Object,
+  Int,
+  Bool,
+};
+
+struct Operand {
+  Kind kind = Kind::Object;
+  int reg = 0;
+};
+
+struct Instr {
+  Op op;
+  int dst = 0;
+  int a = 0;
+  int b = 0;
+  int imm = 0;
+  Runtime::Object* object = nullptr;
+  const Runtime::Class* cls = nullptr;
+  const string* name = nullptr;
+  Ast::Statement* node = nullptr;
+  const Ast::Comparison* comparison = nullptr;
+  vector<int> args = {};
+  vector<pair<string, Operand>> bindings = {};
+  string observed = {};
+};
+
+struct TraceCode {
+  string name;
+  vector<Instr> code;
+  int object_registers = 0;
+  int int_registers = 0;
+  // Method bodies the trace runs, its own and the inlined ones, and how
+  // deep they nest, for Metrics
+  size_t calls = 0;
+  size_t depth = 0;
+};
+
+} /* namespace */
+
+class Tree {
+public:
+  vector<shared_ptr<const TraceCode>> traces;
+  bool recording = false;
+  size_t aborts = 0;
+  // The interpreter runs the self calls in tail position in a loop, which
+  // traces would nest
+  bool tail_calls = false;
+};
+
+namespace {
+
+bool HasTailCall(const Ast::Statement* statement, const Runtime::Method& method) {
+  if (auto compound = dynamic_cast<const Ast::Compound*>(statement)) {
+    for (const auto& stmt : compound->GetStatements()) {
+      if (HasTailCall(stmt.get(), method)) {
+        return true;
+      }
+    }
+  } else if (auto if_else = dynamic_cast<const Ast::IfElse*>(statement)) {
+    return HasTailCall(if_else->GetIfBody(), method) || HasTailCall(if_else->GetElseBody(), method);
+  } else if (auto ret = dynamic_cast<const Ast::Return*>(statement)) {
+    return ret->GetSelfCall() && ret->GetSelfCall()->method == method.name;
+  }
+  return false;
+}
+
+string TypeName(const ObjectHolder& object) {
+  if (!object) {
+    return "None";
+  } else if (object.TryAs<Number>()) {
+    return "Number";
+  } else if (object.TryAs<Runtime::String>()) {
+    return "String";
+  } else if (object.TryAs<Runtime::Bool>()) {
+    return "Bool";
+  } else if (auto instance = object.TryAs<ClassInstance>()) {
+    return instance->GetClass().GetName();
+  }
+  return "Object";
+}
+
+bool CompareInts(CompareKind kind, int lhs, int rhs) {
+  switch (kind) {
+    case CompareKind::Equal: return lhs == rhs;
+    case CompareKind::NotEqual: return lhs != rhs;
+    case CompareKind::Less: return lhs < rhs;
+    case CompareKind::Greater: return lhs > rhs;
+    case CompareKind::LessOrEqual: return lhs <= rhs;
+    case CompareKind::GreaterOrEqual: return lhs >= rhs;
+    case CompareKind::Custom: break;
+  }
+  throw logic_error("Unknown integer comparison");
+}
+
+// Follows the dotted ids after the first one through the fields of
+// instances, nothing if a receiver isn't an instance
+optional<ObjectHolder> ReadFields(ObjectHolder object, const vector<string>& ids) {
+  for (size_t i = 1; i < ids.size(); ++i) {
+    auto instance = object.TryAs<ClassInstance>();
+    if (!instance) {
+      return nullopt;
+    }
+    Runtime::Closure& fields = instance->Fields();
+    auto it = fields.find(ids[i]);
+    if (it == fields.end()) {
+      throw runtime_error("Not found: " + ids[i]);
+    }
+    object = it->second;
+  }
+  return object;
+}
+
+// Registers of a running trace and the closure for the nodes it runs in
+// the interpreter, which keeps its buckets from one node to the next
+struct Registers {
+  ObjectHolder* objects;
+  int* ints;
+  Runtime::Closure closure;
+};
+
+// Runs the node of the instruction in the interpreter over the closure
+// rebuilt from the registers
+ObjectHolder Interpret(const Instr& instr, Registers& registers) {
+  const ObjectHolder* objects = registers.objects;
+  const int* ints = registers.ints;
+  Runtime::Closure& closure = registers.closure;
+  closure.clear();
+  for (const auto& [name, operand] : instr.bindings) {
+    switch (operand.kind) {
+      case Kind::Object:
+        closure[name] = objects[operand.reg];
+        break;
+      case Kind::Int:
+        closure[name] = ObjectHolder::Own(Number(ints[operand.reg]));
+        break;
+      case Kind::Bool:
+        closure[name] = ObjectHolder::Own(Runtime::Bool(ints[operand.reg] != 0));
+        break;
+    }
+  }
+  return instr.node->Execute(closure);
+}
+
+ClassInstance& AsInstance(ObjectHolder& object) {
+  if (auto instance = object.TryAs<ClassInstance>()) {
+    return *instance;
+  }
+  throw runtime_error("Not a class instance");
+}
+
+// Returns nothing on a side exit
+optional<ObjectHolder> Run(const TraceCode& trace, ClassInstance& self, Runtime::Arguments actual_args) {
+  // Registers come from stacks of the thread rather than the heap
+  Runtime::ArgumentFrame object_frame(trace.object_registers);
+  Runtime::IntFrame int_frame(trace.int_registers);
+  Registers registers{&object_frame[0], int_frame.Get(), {}};
+  ObjectHolder* objects = registers.objects;
+  int* ints = registers.ints;
+  copy(begin(actual_args), end(actual_args), objects);
+  objects[actual_args.size()] = ObjectHolder::Share(self);
+
+  for (const Instr& instr : trace.code) {
+    switch (instr.op) {
+      case Op::LoadObject:
+        objects[instr.dst] = ObjectHolder::Share(*instr.object);
+        break;
+      case Op::LoadNone:
+        objects[instr.dst] = ObjectHolder::None();
+        break;
+      case Op::LoadInt:
+        ints[instr.dst] = instr.imm;
+        break;
+      case Op::Field: {
+        // A receiver which isn't an instance any more exits the trace, or
+        // after an effect, gets the interpreter rules for the whole variable
+        const auto& ids = static_cast<const Ast::VariableValue*>(instr.node)->dotted_ids;
+        if (auto value = ReadFields(objects[instr.a], ids)) {
+          objects[instr.dst] = move(*value);
+        } else if (instr.imm) {
+          objects[instr.dst] = Interpret(instr, registers);
+        } else {
+          return nullopt;
+        }
+        break;
+      }
+      case Op::Box:
+        objects[instr.dst] = ObjectHolder::Own(Number(ints[instr.a]));
+        break;
+      case Op::BoxBool:
+        objects[instr.dst] = ObjectHolder::Own(Runtime::Bool(ints[instr.a] != 0));
+        break;
+      case Op::GuardNumber:
+        if (auto number = objects[instr.a].TryAs<Number>()) {
+          ints[instr.dst] = number->GetValue();
+          break;
+        }
+        return nullopt;
+      case Op::GuardTrue:
+        if (!ints[instr.a]) {
+          return nullopt;
+        }
+        break;
+      case Op::GuardFalse:
+        if (ints[instr.a]) {
+          return nullopt;
+        }
+        break;
+      case Op::GuardClass: {
+        auto instance = objects[instr.a].TryAs<ClassInstance>();
+        if (!instance || &instance->GetClass() != instr.cls) {
+          return nullopt;
+        }
+        break;
+      }
+      case Op::Unbox:
+        if (auto number = objects[instr.a].TryAs<Number>()) {
+          ints[instr.dst] = number->GetValue();
+          break;
+        }
+        throw runtime_error("Not number");
+      case Op::IntAdd:
+        ints[instr.dst] = ints[instr.a] + ints[instr.b];
+        break;
+      case Op::IntSub:
+        ints[instr.dst] = ints[instr.a] - ints[instr.b];
+        break;
+      case Op::IntMult:
+        ints[instr.dst] = ints[instr.a] * ints[instr.b];
+        break;
+      case Op::IntDiv:
+        ints[instr.dst] = Ast::Div::Evaluate(ints[instr.a], ints[instr.b]);
+        break;
+      case Op::IntCompare:
+        ints[instr.dst] = CompareInts(instr.comparison->GetKind(), ints[instr.a], ints[instr.b]);
+        break;
+      case Op::Truth:
+        ints[instr.dst] = Runtime::IsTrue(objects[instr.a]);
+        break;
+      case Op::IntTruth:
+        ints[instr.dst] = ints[instr.a] != 0;
+        break;
+      case Op::Not:
+        ints[instr.dst] = !ints[instr.a];
+        break;
+      case Op::And:
+        ints[instr.dst] = ints[instr.a] && ints[instr.b];
+        break;
+      case Op::Or:
+        ints[instr.dst] = ints[instr.a] || ints[instr.b];
+        break;
+      case Op::AddObjects:
+        objects[instr.dst] = Ast::Add::Evaluate(objects[instr.a], objects[instr.b]);
+        break;
+      case Op::Compare:
+        ints[instr.dst] = instr.comparison->GetComparator()(objects[instr.a], objects[instr.b]);
+        break;
+      case Op::SetField:
+        AsInstance(objects[instr.a]).Fields()[*instr.name] = objects[instr.b];
+        break;
+      case Op::Call: {
+        Runtime::ArgumentFrame call_args(instr.args.size());
+        for (size_t i = 0; i < instr.args.size(); ++i) {
+          call_args[i] = objects[instr.args[i]];
+        }
+        objects[instr.dst] = Call(AsInstance(objects[instr.a]), *instr.name, call_args.GetArguments());
+        break;
+      }
+      case Op::Interpret:
+        objects[instr.dst] = Interpret(instr, registers);
+        break;
+      case Op::Return:
+        return objects[instr.a];
+    }
+  }
+  return ObjectHolder::None();
+}
+
+const char* OpName(Op op) {
+  switch (op) {
+    case Op::LoadObject: return "load_object";
+    case Op::LoadNone: return "load_none";
+    case Op::LoadInt: return "load_int";
+    case Op::Field: return "field";
+    case Op::Box: return "box";
+    case Op::BoxBool: return "box_bool";
+    case Op::GuardNumber: return "guard_number";
+    case Op::GuardTrue: return "guard_true";
+    case Op::GuardFalse: return "guard_false";
+    case Op::GuardClass: return "guard_class";
+    case Op::Unbox: return "unbox";
+    case Op::IntAdd: return "int_add";
+    case Op::IntSub: return "int_sub";
+    case Op::IntMult: return "int_mult";
+    case Op::IntDiv: return "int_div";
+    case Op::IntCompare: return "int_compare";
+    case Op::Truth: return "truth";
+    case Op::IntTruth: return "int_truth";
+    case Op::Not: return "not";
+    case Op::And: return "and";
+    case Op::Or: return "or";
+    case Op::AddObjects: return "add";
+    case Op::Compare: return "compare";
+    case Op::SetField: return "set_field";
+    case Op::Call: return "call";
+    case Op::Interpret: return "interpret";
+    case Op::Return: return "return";
+  }
+  return "?";
+}
+
+void Dump(const TraceCode& trace, ostream& out) {
+  out << "trace " << trace.name << ": " << trace.code.size() << " instructions, "
+      << trace.object_registers << " object and " << trace.int_registers << " int registers\n";
+  for (size_t i = 0; i < trace.code.size(); ++i) {
+    const Instr& instr = trace.code[i];
+    out << "  " << i << ": " << OpName(instr.op) << " dst=" << instr.dst << " a=" << instr.a << " b=" << instr.b;
+    if (instr.op == Op::LoadInt) {
+      out << " imm=" << instr.imm;
+    }
+    if (instr.name) {
+      out << " name=" << *instr.name;
+    }
+    if (instr.cls) {
+      out << " class=" << instr.cls->GetName();
+    }
+    if (!instr.observed.empty()) {
+      out << "  ; " << instr.observed;
+    }
+    out << '\n';
+  }
+}
+
+// Executes a call like the interpreter does while recording what happens
+class Recorder {
+public:
+  ObjectHolder Record(ClassInstance& self, const Runtime::Method& method, Runtime::Arguments actual_args) {
+    trace.name = self.GetClass().GetName() + "." + method.name;
+
+    Frame frame;
+    for (size_t i = 0; i < actual_args.size(); ++i) {
+      Bind(frame, method.formal_params[i], {actual_args[i], {Kind::Object, static_cast<int>(i)}});
+    }
+    Bind(frame, "self", {ObjectHolder::Share(self), {Kind::Object, static_cast<int>(actual_args.size())}});
+    trace.object_registers = actual_args.size() + 1;
+
+    Value result = RunBody(frame, method);
+    if (recording) {
+      Instr instr{Op::Return};
+      instr.a = AsObject(result);
+      Emit(move(instr));
+    }
+    return result.object;
+  }
+
+  bool Succeeded() const {
+    return recording;
+  }
+
+  TraceCode TakeTrace() {
+    return move(trace);
+  }
+
+private:
+  struct Value {
+    ObjectHolder object;
+    Operand operand;
+  };
+
+  struct Frame {
+    Runtime::Closure closure;
+    unordered_map<string, Value> locals;
+    bool returned = false;
+    Value result;
+  };
+
+  TraceCode trace;
+  bool recording = true;
+  bool effects = false;
+  vector<const Runtime::Method*> inline_stack;
+
+  void Abort() {
+    recording = false;
+  }
+
+  int Emit(Instr instr) {
+    int dst = instr.dst;
+    if (recording) {
+      trace.code.push_back(move(instr));
+    }
+    return dst;
+  }
+
+  int NewObjectRegister() {
+    return trace.object_registers++;
+  }
+
+  int NewIntRegister() {
+    return trace.int_registers++;
+  }
+
+  static void Bind(Frame& frame, const string& name, Value value) {
+    frame.closure[name] = value.object;
+    frame.locals[name] = move(value);
+  }
+
+  int AsObject(const Value& value) {
+    if (value.operand.kind == Kind::Object) {
+      return value.operand.reg;
+    }
+    Instr instr{value.operand.kind == Kind::Int ? Op::Box : Op::BoxBool, NewObjectRegister(), value.operand.reg};
+    return Emit(move(instr));
+  }
+
+  // Speculates that the value is a number before the first effect, checks it after
+  int AsInt(const Value& value) {
+    if (value.operand.kind == Kind::Int) {
+      return value.operand.reg;
+    }
+    if (!value.object.TryAs<Number>()) {
+      throw runtime_error("Not number");
+    }
+    Instr instr{effects ? Op::Unbox : Op::GuardNumber, NewIntRegister(), AsObject(value)};
+    instr.observed = "Number";
+    return Emit(move(instr));
+  }
+
+  int AsBool(const Value& value) {
+    if (value.operand.kind == Kind::Bool) {
+      return value.operand.reg;
+    }
+    Op op = value.operand.kind == Kind::Int ? Op::IntTruth : Op::Truth;
+    return Emit(Instr{op, NewIntRegister(), value.operand.reg});
+  }
+
+  Value MakeInt(int result, Instr instr) {
+    instr.dst = NewIntRegister();
+    return {ObjectHolder::Own(Number(result)), {Kind::Int, Emit(move(instr))}};
+  }
+
+  Value MakeBool(bool result, Instr instr) {
+    instr.dst = NewIntRegister();
+    return {ObjectHolder::Own(Runtime::Bool(result)), {Kind::Bool, Emit(move(instr))}};
+  }
+
+  Value MakeObject(ObjectHolder result, Instr instr) {
+    instr.dst = NewObjectRegister();
+    instr.observed = TypeName(result);
+    return {move(result), {Kind::Object, Emit(move(instr))}};
+  }
+
+  Value RunBody(Frame& frame, const Runtime::Method& method) {
+    Metrics::CallFrame call;
+    method.ParseBody();
+    inline_stack.push_back(&method);
+    ++trace.calls;
+    trace.depth = max(trace.depth, inline_stack.size());
+    Value result;
+    if (dynamic_cast<Ast::Compound*>(method.body.get()) || dynamic_cast<Ast::Return*>(method.body.get())) {
+      Execute(*method.body, frame);
+      result = frame.returned ? frame.result : MakeObject(ObjectHolder::None(), Instr{Op::LoadNone});
+    } else {
+      result = Evaluate(*method.body, frame);
+    }
+    inline_stack.pop_back();
+    return result;
+  }
+
+  void Execute(Ast::Statement& statement, Frame& frame) {
+    if (auto compound = dynamic_cast<Ast::Compound*>(&statement)) {
+      for (const auto& stmt : compound->GetStatements()) {
+        Execute(*stmt, frame);
+        if (frame.returned) {
+          break;
+        }
+      }
+    } else if (auto if_else = dynamic_cast<Ast::IfElse*>(&statement)) {
+      Value condition = Evaluate(*if_else->GetCondition(), frame);
+      bool taken = Runtime::IsTrue(condition.object);
+      if (effects) {
+        // A guard here couldn't restart the call, the trace ends
+        Abort();
+      } else {
+        Emit(Instr{taken ? Op::GuardTrue : Op::GuardFalse, 0, AsBool(condition)});
+      }
+      if (taken) {
+        Execute(*if_else->GetIfBody(), frame);
+      } else if (if_else->GetElseBody()) {
+        Execute(*if_else->GetElseBody(), frame);
+      }
+    } else if (auto ret = dynamic_cast<Ast::Return*>(&statement)) {
+      frame.result = Evaluate(*ret->GetStatement(), frame);
+      frame.returned = true;
+    } else if (auto assignment = dynamic_cast<Ast::Assignment*>(&statement)) {
+      Bind(frame, assignment->var_name, Evaluate(*assignment->right_value, frame));
+    } else if (auto field_assignment = dynamic_cast<Ast::FieldAssignment*>(&statement)) {
+      Value object = Evaluate(field_assignment->object, frame);
+      Value value = Evaluate(*field_assignment->right_value, frame);
+      AsInstance(object.object).Fields()[field_assignment->field_name] = value.object;
+
+      Instr instr{Op::SetField, 0, AsObject(object), AsObject(value)};
+      instr.name = &field_assignment->field_name;
+      Emit(move(instr));
+      effects = true;
+    } else {
+      Evaluate(statement, frame);
+    }
+  }
+
+  Value Evaluate(Ast::Statement& expression, Frame& frame) {
+    if (auto number = dynamic_cast<Ast::NumericConst*>(&expression)) {
+      Instr instr{Op::LoadInt, NewIntRegister()};
+      instr.imm = number->value.GetValue();
+      return {ObjectHolder::Share(number->value), {Kind::Int, Emit(move(instr))}};
+    } else if (auto str = dynamic_cast<Ast::StringConst*>(&expression)) {
+      Instr instr{Op::LoadObject};
+      instr.object = &str->value;
+      return MakeObject(ObjectHolder::Share(str->value), move(instr));
+    } else if (auto boolean = dynamic_cast<Ast::BoolConst*>(&expression)) {
+      Instr instr{Op::LoadInt, NewIntRegister()};
+      instr.imm = boolean->value.GetValue();
+      return {ObjectHolder::Share(boolean->value), {Kind::Bool, Emit(move(instr))}};
+    } else if (dynamic_cast<Ast::None*>(&expression)) {
+      return MakeObject(ObjectHolder::None(), Instr{Op::LoadNone});
+    } else if (auto variable = dynamic_cast<Ast::VariableValue*>(&expression)) {
+      return EvaluateVariable(*variable, frame);
+    } else if (auto add = dynamic_cast<Ast::Add*>(&expression)) {
+      return EvaluateAdd(*add, frame);
+    } else if (auto sub = dynamic_cast<Ast::Sub*>(&expression)) {
+      return EvaluateArithmetic(Op::IntSub, *sub, frame);
+    } else if (auto mult = dynamic_cast<Ast::Mult*>(&expression)) {
+      return EvaluateArithmetic(Op::IntMult, *mult, frame);
+    } else if (auto div = dynamic_cast<Ast::Div*>(&expression)) {
+      return EvaluateArithmetic(Op::IntDiv, *div, frame);
+    } else if (auto comparison = dynamic_cast<Ast::Comparison*>(&expression)) {
+      return EvaluateComparison(*comparison, frame);
+    } else if (auto negation = dynamic_cast<Ast::Not*>(&expression)) {
+      Value value = Evaluate(*negation->GetArgument(), frame);
+      return MakeBool(!Runtime::IsTrue(value.object), Instr{Op::Not, 0, AsBool(value)});
+    } else if (auto conjunction = dynamic_cast<Ast::And*>(&expression)) {
+      Value lhs = Evaluate(*conjunction->GetLhs(), frame);
+      Value rhs = Evaluate(*conjunction->GetRhs(), frame);
+      bool result = Runtime::IsTrue(lhs.object) && Runtime::IsTrue(rhs.object);
+      return MakeBool(result, Instr{Op::And, 0, AsBool(lhs), AsBool(rhs)});
+    } else if (auto disjunction = dynamic_cast<Ast::Or*>(&expression)) {
+      Value lhs = Evaluate(*disjunction->GetLhs(), frame);
+      Value rhs = Evaluate(*disjunction->GetRhs(), frame);
+      bool result = Runtime::IsTrue(lhs.object) || Runtime::IsTrue(rhs.object);
+      return MakeBool(result, Instr{Op::Or, 0, AsBool(lhs), AsBool(rhs)});
+    } else if (auto call = dynamic_cast<Ast::MethodCall*>(&expression)) {
+      return EvaluateCall(*call, frame);
+    }
+    return Interpret(expression, frame);
+  }
+
+  Value EvaluateVariable(Ast::VariableValue& variable, Frame& frame) {
+    const auto& ids = variable.dotted_ids;
+    auto it = frame.locals.find(ids.front());
+    if (it == frame.locals.end()) {
+      throw runtime_error("Not found: " + ids.front());
+    }
+
+    // Dotted access through something which isn't an instance follows odd
+    // interpreter rules, leave it to the interpreter
+    ObjectHolder object = it->second.object;
+    for (size_t i = 1; i < ids.size(); ++i) {
+      auto instance = object.TryAs<ClassInstance>();
+      if (!instance) {
+        return Interpret(variable, frame);
+      }
+      if (auto field = instance->Fields().find(ids[i]); field != instance->Fields().end()) {
+        object = field->second;
+      } else {
+        break;
+      }
+    }
+
+    const Value& value = it->second;
+    if (ids.size() == 1) {
+      return value;
+    }
+    ObjectHolder field = *ReadFields(value.object, ids);
+    Instr instr{Op::Field, 0, AsObject(value)};
+    instr.name = &ids.back();
+    instr.node = &variable;
+    if (effects) {
+      instr.imm = 1;
+      AddBindings(instr, frame);
+    }
+    return MakeObject(move(field), move(instr));
+  }
+
+  Value EvaluateArithmetic(Op op, Ast::BinaryOperation& operation, Frame& frame) {
+    Value lhs = Evaluate(*operation.GetLhs(), frame);
+    int l = AsInt(lhs);
+    Value rhs = Evaluate(*operation.GetRhs(), frame);
+    int r = AsInt(rhs);
+
+    int left = lhs.object.TryAs<Number>()->GetValue();
+    int right = rhs.object.TryAs<Number>()->GetValue();
+    int result = op == Op::IntSub ? left - right : op == Op::IntMult ? left * right : Ast::Div::Evaluate(left, right);
+    return MakeInt(result, Instr{op, 0, l, r});
+  }
+
+  Value EvaluateAdd(Ast::Add& add, Frame& frame) {
+    Value lhs = Evaluate(*add.GetLhs(), frame);
+    Value rhs = Evaluate(*add.GetRhs(), frame);
+
+    auto left = lhs.object.TryAs<Number>();
+    auto right = rhs.object.TryAs<Number>();
+    bool unboxed = lhs.operand.kind == Kind::Int && rhs.operand.kind == Kind::Int;
+    if (left && right && (!effects || unboxed)) {
+      int result = left->GetValue() + right->GetValue();
+      return MakeInt(result, Instr{Op::IntAdd, 0, AsInt(lhs), AsInt(rhs)});
+    }
+
+    // Generic addition may call __add__
+    Instr instr{Op::AddObjects, 0, AsObject(lhs), AsObject(rhs)};
+    Value result = MakeObject(Ast::Add::Evaluate(lhs.object, rhs.object), move(instr));
+    effects = true;
+    return result;
+  }
+
+  Value EvaluateComparison(Ast::Comparison& comparison, Frame& frame) {
+    Value lhs = Evaluate(*comparison.GetLeft(), frame);
+    Value rhs = Evaluate(*comparison.GetRight(), frame);
+
+    auto left = lhs.object.TryAs<Number>();
+    auto right = rhs.object.TryAs<Number>();
+    bool unboxed = lhs.operand.kind == Kind::Int && rhs.operand.kind == Kind::Int;
+    if (comparison.GetKind() != CompareKind::Custom && left && right && (!effects || unboxed)) {
+      bool result = CompareInts(comparison.GetKind(), left->GetValue(), right->GetValue());
+      Instr instr{Op::IntCompare, 0, AsInt(lhs), AsInt(rhs)};
+      instr.comparison = &comparison;
+      return MakeBool(result, move(instr));
+    }
+
+    bool result = comparison.GetComparator()(lhs.object, rhs.object);
+    Instr instr{Op::Compare, 0, AsObject(lhs), AsObject(rhs)};
+    instr.comparison = &comparison;
+    Value value = MakeBool(result, move(instr));
+    effects = true;
+    return value;
+  }
+
+  Value EvaluateCall(Ast::MethodCall& call, Frame& frame) {
+    vector<Value> args;
+    for (const auto& arg : call.args) {
+      args.push_back(Evaluate(*arg, frame));
+    }
+    Value receiver = Evaluate(*call.object, frame);
+    ClassInstance& instance = AsInstance(receiver.object);
+
+    const Runtime::Method* target = instance.GetClass().GetMethod(call.method);
+    bool inline_call = recording && !effects && target && !target->native && !target->memo
+      && target->formal_params.size() == args.size()
+      && inline_stack.size() < kMaxInlineDepth
+      && find(begin(inline_stack), end(inline_stack), target) == end(inline_stack);
+
+    if (inline_call) {
+      Instr guard{Op::GuardClass, 0, AsObject(receiver)};
+      guard.cls = &instance.GetClass();
+      Emit(move(guard));
+
+      Frame callee;
+      for (size_t i = 0; i < args.size(); ++i) {
+        Bind(callee, target->formal_params[i], args[i]);
+      }
+      Bind(callee, "self", {receiver.object, {Kind::Object, AsObject(receiver)}});
+      return RunBody(callee, *target);
+    }
+
+    vector<ObjectHolder> actual_args;
+    Instr instr{Op::Call, 0, AsObject(receiver)};
+    for (const auto& arg : args) {
+      actual_args.push_back(arg.object);
+      instr.args.push_back(AsObject(arg));
+    }
+    instr.name = &call.method;
+    Value result = MakeObject(Call(instance, call.method, actual_args), move(instr));
+    effects = true;
+    return result;
+  }
+
+  static void AddBindings(Instr& instr, const Frame& frame) {
+    for (const auto& [name, value] : frame.locals) {
+      instr.bindings.emplace_back(name, value.operand);
+    }
+  }
+
+  // Nodes without a specialized form run in the interpreter over a closure
+  // rebuilt from the registers
+  Value Interpret(Ast::Statement& node, Frame& frame) {
+    Instr instr{Op::Interpret};
+    instr.node = &node;
+    AddBindings(instr, frame);
+    Value result = MakeObject(node.Execute(frame.closure), move(instr));
+    effects = true;
+    return result;
+  }
+};
+
+} /* namespace */
+
+void SetEnabled(bool value) {
+  enabled = value;
+}
+
+bool IsEnabled() {
+  return enabled;
+}
+
+void SetThreshold(size_t executions) {
+  threshold = executions;
+}
+
+size_t GetThreshold() {
+  return threshold;
+}
+
+void SetDumpStream(ostream* out) {
+  dump = out;
+}
+
+ObjectHolder Call(ClassInstance& object, const string& method, Runtime::Arguments actual_args) {
+  const Runtime::Method* mtd = object.GetClass().GetMethod(method);
+  if (!mtd || mtd->native || mtd->memo || mtd->formal_params.size() != actual_args.size()) {
+    return object.Call(method, actual_args);
+  }
+  if (!mtd->traces) {
+    mtd->ParseBody();
+    mtd->traces = make_shared<Tree>();
+    mtd->traces->tail_calls = HasTailCall(mtd->body.get(), *mtd);
+  }
+  shared_ptr<Tree> tree = mtd->traces;
+  if (tree->tail_calls) {
+    return object.Call(*mtd, actual_args);
+  }
+
+  // Traces may be added by nested calls while one of them runs
+  for (size_t i = 0; i < tree->traces.size(); ++i) {
+    shared_ptr<const TraceCode> trace = tree->traces[i];
+    Metrics::CallFrame call;
+    if (auto result = Run(*trace, object, actual_args)) {
+      Metrics::CallsInlined(trace->calls - 1, trace->depth - 1);
+      ++stats.hits;
+      return *result;
+    }
+    call.Cancel();
+    ++stats.side_exits;
+  }
+
+  if (tree->recording || tree->traces.size() >= kMaxTracesPerMethod || tree->aborts >= kMaxAbortsPerMethod) {
+    return object.Call(method, actual_args);
+  }
+
+  Recorder recorder;
+  ObjectHolder result;
+  tree->recording = true;
+  try {
+    result = recorder.Record(object, *mtd, actual_args);
+  } catch (...) {
+    tree->recording = false;
+    throw;
+  }
+  tree->recording = false;
+
+  if (recorder.Succeeded()) {
+    ++stats.recorded;
+    auto trace = make_shared<const TraceCode>(recorder.TakeTrace());
+    if (dump) {
+      Dump(*trace, *dump);
+    }
+    tree->traces.push_back(move(trace));
+  } else {
+    ++stats.aborted;
+    ++tree->aborts;
+  }
+  return result;
+}
+
+const Stats& GetStats() {
+  return stats;
+}
+
+void ResetStats() {
+  stats = {};
+}
+
+} /* namespace Trace */
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "object_holder.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class TestRunner;
+
+namespace Runtime {
+  class Arguments;
+  class ClassInstance;
+}
+
+namespace Trace {
+
+// Tracing JIT for hot call sites. Once an Ast::MethodCall site has executed
+// more than the threshold number of times, its calls go through Trace::Call.
+// The first such call of a method is executed by a recorder which follows the
+// AST nodes actually executed, inlining callees that aren't on the recording
+// stack, notes the observed type of every value and emits a linear IR with
+// guards on those types and on the branches taken. Later calls execute the IR.
+//
+// A guard failing is a side exit: the call is restarted in the interpreter.
+// That's only sound while nothing observable has happened, so guards are
+// emitted only before the first instruction with effects; after it the trace
+// uses generic operations and recording stops at the next branch.
+class Tree;
+
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// The number of executions of a call site before it switches to traces
+void SetThreshold(size_t executions);
+size_t GetThreshold();
+
+// Compiled traces are printed to the stream, nullptr disables the dump
+void SetDumpStream(std::ostream* out);
+
+ObjectHolder Call(
+  Runtime::ClassInstance& object, const std::string& method, Runtime::Arguments actual_args
+);
+
+struct Stats {
+  size_t recorded = 0;
+  size_t aborted = 0;
+  size_t hits = 0;
+  size_t side_exits = 0;
+};
+
+// Counted per thread
+const Stats& GetStats();
+void ResetStats();
+
+void RunTraceTests(TestRunner& tr);
+
+} /* namespace Trace */
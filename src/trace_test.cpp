@@ -0,0 +1,176 @@
+#include "trace.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace Trace {
+
+string RunProgram(const string& program, bool trace, ostream* dump = nullptr) {
+  bool was_enabled = IsEnabled();
+  size_t old_threshold = GetThreshold();
+  SetEnabled(trace);
+  SetThreshold(0);
+  SetDumpStream(dump);
+
+  istringstream input(program);
+  ostringstream output;
+  Ast::Print::SetOutputStream(output);
+
+  Parse::Lexer lexer(input);
+  auto tree = ParseProgram(lexer);
+  Runtime::Closure closure;
+  tree->Execute(closure);
+
+  SetEnabled(was_enabled);
+  SetThreshold(old_threshold);
+  SetDumpStream(nullptr);
+  return output.str();
+}
+
+void AssertSameOutput(const string& program, const string& expected) {
+  ASSERT_EQUAL(RunProgram(program, false), expected);
+  ASSERT_EQUAL(RunProgram(program, true), expected);
+}
+
+void TestRecursion() {
+  ResetStats();
+  AssertSameOutput(R"(
+class Fib:
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+f = Fib()
+print f.fib(18), f.fib(5), f.fib(1)
+)", "2584 5 1\n");
+  ASSERT(GetStats().recorded > 0);
+  ASSERT(GetStats().hits > 0);
+  ASSERT(GetStats().side_exits > 0);
+}
+
+void TestInlinedCallsAndSideExits() {
+  ResetStats();
+  AssertSameOutput(R"(
+class Square:
+  def __init__(side):
+    self.side = side
+
+  def area():
+    return self.side * self.side
+
+class Rect:
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+class Sum:
+  def add(total, shape):
+    return total + shape.area()
+
+s = Sum()
+sq = Square(3)
+r = Rect(2, 5)
+t = s.add(0, sq)
+t = s.add(t, sq)
+t = s.add(t, r)
+t = s.add(t, r)
+t = s.add(t, sq)
+print t
+)", "47\n");
+  ASSERT(GetStats().hits > 0);
+  ASSERT(GetStats().side_exits > 0);
+}
+
+void TestEffectsAndGenericValues() {
+  AssertSameOutput(R"(
+class Log:
+  def __init__():
+    self.count = 0
+
+  def note(what):
+    self.count = self.count + 1
+    print 'note', self.count, what
+    if self.count > 2:
+      return 'many'
+    return 'few'
+
+  def greet(name):
+    return 'hi ' + name
+
+l = Log()
+print l.note(1), l.note('x'), l.note(None), l.greet('bob'), l.greet('ann')
+)", "note 1 1\nfew note 2 x\nfew note 3 None\nmany hi bob hi ann\n");
+}
+
+void TestFieldsWhichStopBeingInstances() {
+  ResetStats();
+  AssertSameOutput(R"(
+class Node:
+  def __init__(v):
+    self.v = v
+
+class Holder:
+  def __init__():
+    self.v = 'own'
+    self.next = Node(1)
+
+  def read():
+    x = 0
+    return self.next.v
+
+  def read_after(n):
+    print 'reading', n
+    return self.next.v
+
+  def set(value):
+    self.next = value
+
+h = Holder()
+a = h.read()
+b = h.read_after(1)
+print a, b
+h.set(5)
+a = h.read()
+b = h.read_after(2)
+print a, b
+)", "reading 1\n1 1\nreading 2\nown own\n");
+  ASSERT(GetStats().side_exits > 0);
+}
+
+void TestDump() {
+  ostringstream dump;
+  RunProgram(R"(
+class Abs:
+  def abs(n):
+    if n < 0:
+      return -n
+    return n
+
+a = Abs()
+print a.abs(-3), a.abs(3)
+)", true, &dump);
+  ASSERT(dump.str().find("trace Abs.abs") != string::npos);
+  ASSERT(dump.str().find("guard_number") != string::npos);
+  ASSERT(dump.str().find("guard_true") != string::npos);
+}
+
+void RunTraceTests(TestRunner& tr) {
+  RUN_TEST(tr, Trace::TestRecursion);
+  RUN_TEST(tr, Trace::TestInlinedCallsAndSideExits);
+  RUN_TEST(tr, Trace::TestEffectsAndGenericValues);
+  RUN_TEST(tr, Trace::TestFieldsWhichStopBeingInstances);
+  RUN_TEST(tr, Trace::TestDump);
+}
+
+} /* namespace Trace */